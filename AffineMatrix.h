@@ -0,0 +1,145 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cmath>
+
+// --------------------------------------------------------
+// A world (or local) matrix without its last column, which
+// for anything made of scale, rotation and translation is
+// always 0, 0, 0, 1
+//
+// - Stored transposed, as three rows of four: row i is
+//   column i of the 4x4 matrix, with the translation in w.
+//   That's 48 bytes instead of 64, and is exactly what a
+//   "row_major float3x4" is in a constant buffer (see
+//   ShaderIncludes.hlsli), so it uploads with a memcpy.
+// - Conversions to and from XMFLOAT4X4 and XMMATRIX are
+//   exact. Multiply adds up the same products as
+//   XMMatrixMultiply, so its results are within rounding
+//   (checked by MeshCook affine).
+// --------------------------------------------------------
+struct AffineMatrix
+{
+	DirectX::XMFLOAT4 rows[3];
+
+	static AffineMatrix Identity()
+	{
+		AffineMatrix identity = { {
+			DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 0.0f),
+			DirectX::XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f),
+			DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 0.0f) } };
+		return identity;
+	}
+
+	// The last column of "matrix" is dropped, so it has to be affine.
+	static AffineMatrix Store(DirectX::FXMMATRIX matrix)
+	{
+		DirectX::XMMATRIX transposed = DirectX::XMMatrixTranspose(matrix);
+		AffineMatrix affine;
+		DirectX::XMStoreFloat4(&affine.rows[0], transposed.r[0]);
+		DirectX::XMStoreFloat4(&affine.rows[1], transposed.r[1]);
+		DirectX::XMStoreFloat4(&affine.rows[2], transposed.r[2]);
+		return affine;
+	}
+
+	static AffineMatrix FromFloat4x4(const DirectX::XMFLOAT4X4& matrix)
+	{
+		return Store(DirectX::XMLoadFloat4x4(&matrix));
+	}
+
+	DirectX::XMMATRIX Load() const
+	{
+		return DirectX::XMMatrixTranspose(DirectX::XMMATRIX(
+			DirectX::XMLoadFloat4(&rows[0]),
+			DirectX::XMLoadFloat4(&rows[1]),
+			DirectX::XMLoadFloat4(&rows[2]),
+			DirectX::g_XMIdentityR3));
+	}
+
+	DirectX::XMFLOAT4X4 ToFloat4x4() const
+	{
+		DirectX::XMFLOAT4X4 matrix;
+		DirectX::XMStoreFloat4x4(&matrix, Load());
+		return matrix;
+	}
+
+	// "a" then "b", the same as XMMatrixMultiply(a, b).
+	// - Three rows of three multiply-adds, where a 4x4 multiply needs four rows of four.
+	static AffineMatrix Multiply(const AffineMatrix& a, const AffineMatrix& b)
+	{
+		using namespace DirectX;
+		XMVECTOR a0 = XMLoadFloat4(&a.rows[0]);
+		XMVECTOR a1 = XMLoadFloat4(&a.rows[1]);
+		XMVECTOR a2 = XMLoadFloat4(&a.rows[2]);
+
+		// Row i of the result is b's row i applied to a's rows, plus b's translation in w
+		AffineMatrix result;
+		for (int i = 0; i < 3; i++) {
+			XMVECTOR row = XMLoadFloat4(&b.rows[i]);
+			XMVECTOR product = XMVectorMultiply(XMVectorSplatX(row), a0);
+			product = XMVectorMultiplyAdd(XMVectorSplatY(row), a1, product);
+			product = XMVectorMultiplyAdd(XMVectorSplatZ(row), a2, product);
+			product = XMVectorMultiplyAdd(XMVectorSplatW(row), g_XMIdentityR3, product);
+			XMStoreFloat4(&result.rows[i], product);
+		}
+		return result;
+	}
+
+	// The matrix normals go through: the inverse transpose of the rotation and scale,
+	// stored the same way (so row i is row i of the inverse), with no translation.
+	// - Rotated and evenly scaled matrices (the usual case) skip the inverse: theirs is
+	//   the matrix itself over the scale squared. "isUniform", if given, says which it was.
+	// - A matrix that flattens everything (scale of 0) has no inverse, so it gets the
+	//   cofactors instead, which still point normals the right way once normalized.
+	AffineMatrix GetNormalMatrix(bool* isUniform = nullptr) const
+	{
+		using namespace DirectX;
+		XMVECTOR a0 = XMVectorSetW(XMLoadFloat4(&rows[0]), 0.0f);
+		XMVECTOR a1 = XMVectorSetW(XMLoadFloat4(&rows[1]), 0.0f);
+		XMVECTOR a2 = XMVectorSetW(XMLoadFloat4(&rows[2]), 0.0f);
+
+		// Evenly scaled if the columns are all the same length and at right angles
+		float scaleSq = XMVectorGetX(XMVector3Dot(a0, a0));
+		float tolerance = scaleSq * 1e-5f;
+		bool uniform = scaleSq > 0.0f &&
+			fabsf(XMVectorGetX(XMVector3Dot(a1, a1)) - scaleSq) <= tolerance &&
+			fabsf(XMVectorGetX(XMVector3Dot(a2, a2)) - scaleSq) <= tolerance &&
+			fabsf(XMVectorGetX(XMVector3Dot(a0, a1))) <= tolerance &&
+			fabsf(XMVectorGetX(XMVector3Dot(a0, a2))) <= tolerance &&
+			fabsf(XMVectorGetX(XMVector3Dot(a1, a2))) <= tolerance;
+		if (isUniform)
+			*isUniform = uniform;
+
+		AffineMatrix normal;
+		if (uniform) {
+			XMVECTOR inverseScaleSq = XMVectorReplicate(1.0f / scaleSq);
+			XMStoreFloat4(&normal.rows[0], XMVectorMultiply(a0, inverseScaleSq));
+			XMStoreFloat4(&normal.rows[1], XMVectorMultiply(a1, inverseScaleSq));
+			XMStoreFloat4(&normal.rows[2], XMVectorMultiply(a2, inverseScaleSq));
+			return normal;
+		}
+
+		// The rows of the inverse are the cross products of the other two columns, over the determinant
+		XMVECTOR c0 = XMVector3Cross(a1, a2);
+		XMVECTOR c1 = XMVector3Cross(a2, a0);
+		XMVECTOR c2 = XMVector3Cross(a0, a1);
+		float determinant = XMVectorGetX(XMVector3Dot(a0, c0));
+		XMVECTOR inverseDeterminant = XMVectorReplicate(determinant != 0.0f ? 1.0f / determinant : 1.0f);
+		XMStoreFloat4(&normal.rows[0], XMVectorMultiply(c0, inverseDeterminant));
+		XMStoreFloat4(&normal.rows[1], XMVectorMultiply(c1, inverseDeterminant));
+		XMStoreFloat4(&normal.rows[2], XMVectorMultiply(c2, inverseDeterminant));
+		return normal;
+	}
+
+	// Where a point ends up (with the translation).
+	DirectX::XMVECTOR TransformPoint(DirectX::FXMVECTOR point) const
+	{
+		using namespace DirectX;
+		XMVECTOR p = XMVectorSetW(point, 1.0f);
+		return XMVectorSet(
+			XMVectorGetX(XMVector4Dot(XMLoadFloat4(&rows[0]), p)),
+			XMVectorGetX(XMVector4Dot(XMLoadFloat4(&rows[1]), p)),
+			XMVectorGetX(XMVector4Dot(XMLoadFloat4(&rows[2]), p)),
+			1.0f);
+	}
+};
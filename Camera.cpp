@@ -22,18 +22,24 @@ Camera::Camera(DirectX::XMFLOAT3 position, float aspectRatio,
 // Getters
 DirectX::XMFLOAT4X4 Camera::GetViewMatrix() { return viewMat; }
 DirectX::XMFLOAT4X4 Camera::GetProjMatrix() { return projMat; }
-Transform Camera::GetTransform() { return transform; }
+Transform* Camera::GetTransform() { return &transform; }
+DirectX::XMFLOAT3 Camera::GetPosition() { return transform.GetWorldPosition(); }
+float Camera::GetFovAngle() { return fovAngle; }
 
 void Camera::UpdateProjectionMatrix(float aspectRatio) {
 	XMStoreFloat4x4(&projMat, DirectX::XMMatrixPerspectiveFovLH(fovAngle, aspectRatio, nearPlaneDist, farPlaneDist));
 }
 
+// From the world matrix, so the camera follows whatever it's attached to
 void Camera::UpdateViewMatrix() {
+	DirectX::XMFLOAT4X4 world = transform.GetWorldMatrix();
+	DirectX::XMVECTOR position = DirectX::XMVectorSet(world.m[3][0], world.m[3][1], world.m[3][2], 1.0f);
+	DirectX::XMVECTOR forward = DirectX::XMVector3Normalize(DirectX::XMVectorSet(world.m[2][0], world.m[2][1], world.m[2][2], 0.0f));
 	DirectX::XMStoreFloat4x4(
 		&viewMat, 
 		DirectX::XMMatrixLookToLH(
-			DirectX::XMLoadFloat3(&transform.GetPosition()),
-			DirectX::XMLoadFloat3(&transform.GetForwardVector()),
+			position,
+			forward,
 			DirectX::XMVectorSet(0, 1, 0, 0)));
 }
 
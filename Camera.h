@@ -20,7 +20,9 @@ public:
 	// Getters
 	DirectX::XMFLOAT4X4 GetViewMatrix();
 	DirectX::XMFLOAT4X4 GetProjMatrix();
-	Transform GetTransform();
+	Transform* GetTransform();
+	DirectX::XMFLOAT3 GetPosition();	// In world space (the transform's may be relative to a parent)
+	float GetFovAngle();
 
 	// Functions
 	void UpdateProjectionMatrix(float aspectRatio);
@@ -0,0 +1,694 @@
+#include "CompressedStream.h"
+#include <Windows.h>
+#include <cstring>
+
+namespace
+{
+	// How far back a DEFLATE match can reach.
+	const size_t HistorySize = 32 * 1024;
+
+	// Inflated at once, then handed out before inflating more.
+	const size_t OutputChunkSize = 64 * 1024;
+
+	const size_t MaxMatchLength = 258;
+
+	// Length and distance codes: their base values and extra bits (RFC 1951, 3.2.5)
+	const uint16_t s_lengthBase[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t s_lengthExtra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t s_distanceBase[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t s_distanceExtra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// The order a dynamic block lists the lengths of its code length code in.
+	const uint8_t s_codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	double GetSeconds()
+	{
+		LARGE_INTEGER frequency, counter;
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&counter);
+		return (double)counter.QuadPart / (double)frequency.QuadPart;
+	}
+
+	// Reads up to "size" bytes from the file, counting them (and the time it took) in stats.
+	size_t ReadFromFile(std::ifstream& file, char* buffer, size_t size, StreamStats& stats)
+	{
+		double start = GetSeconds();
+		file.read(buffer, (std::streamsize)size);
+		size_t read = (size_t)file.gcount();
+		stats.readSeconds += GetSeconds() - start;
+		stats.fileBytes += read;
+		return read;
+	}
+
+	// CRC-32 (the one gzip uses), eight bytes at a time ("slicing by 8").
+	// - entries[k][b] is the CRC of byte b followed by k zero bytes.
+	struct CrcTable
+	{
+		uint32_t entries[8][256];
+
+		CrcTable()
+		{
+			for (uint32_t i = 0; i < 256; i++) {
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; bit++)
+					crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : (crc >> 1);
+				entries[0][i] = crc;
+			}
+			for (int k = 1; k < 8; k++) {
+				for (uint32_t i = 0; i < 256; i++)
+					entries[k][i] = (entries[k - 1][i] >> 8) ^ entries[0][entries[k - 1][i] & 0xFF];
+			}
+		}
+	};
+
+	uint32_t UpdateCrc(uint32_t crc, const unsigned char* data, size_t size)
+	{
+		static const CrcTable table;
+		crc = ~crc;
+
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint32_t low, high;
+			memcpy(&low, data + i, sizeof(low));
+			memcpy(&high, data + i + 4, sizeof(high));
+			low ^= crc;
+			crc = table.entries[7][low & 0xFF] ^ table.entries[6][(low >> 8) & 0xFF] ^
+				table.entries[5][(low >> 16) & 0xFF] ^ table.entries[4][low >> 24] ^
+				table.entries[3][high & 0xFF] ^ table.entries[2][(high >> 8) & 0xFF] ^
+				table.entries[1][(high >> 16) & 0xFF] ^ table.entries[0][high >> 24];
+		}
+		for (; i < size; i++)
+			crc = table.entries[0][(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	// A canonical Huffman code, as DEFLATE describes them (by the length of each symbol's code).
+	// - Codes up to FastBits long are found with one lookup, longer ones a bit at a time.
+	struct HuffmanCode
+	{
+		static const int FastBits = 10;
+		static const int MaxBits = 15;
+
+		uint16_t fast[1 << FastBits];	// (symbol << 4) | length, indexed by the next FastBits bits (0 if the code is longer)
+		uint16_t counts[MaxBits + 1];	// How many codes of each length
+		uint16_t symbols[288];			// Sorted by code
+
+		// Returns false if the lengths ask for more codes than there are (incomplete codes are fine).
+		bool Build(const uint8_t* lengths, int count)
+		{
+			memset(counts, 0, sizeof(counts));
+			for (int i = 0; i < count; i++)
+				counts[lengths[i]]++;
+			counts[0] = 0;
+
+			int left = 1;
+			for (int length = 1; length <= MaxBits; length++) {
+				left = (left << 1) - counts[length];
+				if (left < 0)
+					return false;
+			}
+
+			uint16_t offsets[MaxBits + 2];
+			offsets[1] = 0;
+			for (int length = 1; length <= MaxBits; length++)
+				offsets[length + 1] = offsets[length] + counts[length];
+			for (int i = 0; i < count; i++) {
+				if (lengths[i] != 0)
+					symbols[offsets[lengths[i]]++] = (uint16_t)i;
+			}
+
+			// Codes are sent most significant bit first, so the table is indexed by them reversed
+			memset(fast, 0, sizeof(fast));
+			uint32_t code = 0;
+			int index = 0;
+			for (int length = 1; length <= FastBits; length++) {
+				for (int i = 0; i < counts[length]; i++, code++, index++) {
+					uint32_t reversed = 0;
+					for (int bit = 0; bit < length; bit++)
+						reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+					for (uint32_t entry = reversed; entry < (1u << FastBits); entry += 1u << length)
+						fast[entry] = (uint16_t)((symbols[index] << 4) | length);
+				}
+				code <<= 1;
+			}
+			return true;
+		}
+	};
+}
+
+
+// --------------------------------------------------------
+// Decodes a gzip stream, pulling compressed blocks from the
+// file as it needs them
+// --------------------------------------------------------
+class Inflater
+{
+public:
+	Inflater(std::ifstream& file, StreamStats& stats);
+
+	// Copy out up to "size" more inflated bytes (fewer only at the end).
+	size_t Read(char* buffer, size_t size);
+
+	bool HasFailed() const { return m_state == State_Failed; }
+
+private:
+	enum State
+	{
+		State_Header,		// Next is a gzip member header (or the end of the file)
+		State_BlockStart,	// Next is a DEFLATE block header (or the member trailer)
+		State_Stored,		// In an uncompressed block
+		State_Codes,		// In a Huffman coded block
+		State_Done,
+		State_Failed,
+	};
+
+	std::ifstream& m_file;
+	StreamStats& m_stats;
+
+	// Compressed input, and the bits taken from it but not used yet (least significant first)
+	std::vector<unsigned char> m_input;
+	size_t m_inputPos;
+	size_t m_inputEnd;
+	bool m_inputDone;
+	uint64_t m_bits;
+	int m_bitCount;
+
+	// Inflated output: the last HistorySize bytes, then what hasn't been handed out yet
+	std::vector<unsigned char> m_output;
+	size_t m_outputEnd;
+	size_t m_outputRead;
+	size_t m_checkedEnd;	// Everything before this is in m_crc and m_memberSize
+
+	State m_state;
+	bool m_lastBlock;
+	uint32_t m_storedRemaining;
+	HuffmanCode m_lengthCode;		// Literals and lengths
+	HuffmanCode m_distanceCode;
+	uint32_t m_crc;
+	uint32_t m_memberSize;
+	int m_memberCount;
+
+	bool Fail() { m_state = State_Failed; return false; }
+
+	bool ReadInput();
+	void Fill();
+	bool GetBits(int count, uint32_t& out);
+	void AlignToByte() { m_bits >>= m_bitCount & 7; m_bitCount &= ~7; }
+	bool HasMoreInput();
+	int Decode(const HuffmanCode& code);
+	void Checksum();
+
+	void Inflate();
+	bool ReadHeader();
+	bool ReadBlockHeader();
+	bool ReadDynamicCodes();
+	bool ReadTrailer();
+	bool InflateStored(size_t limit);
+	bool InflateCodes(size_t limit);
+};
+
+Inflater::Inflater(std::ifstream& file, StreamStats& stats)
+	: m_file(file), m_stats(stats),
+	m_input(CompressedStream::ReadBlockSize), m_inputPos(0), m_inputEnd(0), m_inputDone(false), m_bits(0), m_bitCount(0),
+	m_output(HistorySize + OutputChunkSize + MaxMatchLength), m_outputEnd(0), m_outputRead(0), m_checkedEnd(0),
+	m_state(State_Header), m_lastBlock(false), m_storedRemaining(0), m_crc(0), m_memberSize(0), m_memberCount(0)
+{
+}
+
+size_t Inflater::Read(char* buffer, size_t size)
+{
+	size_t copied = 0;
+	while (copied < size) {
+		if (m_outputRead == m_outputEnd) {
+			if (m_state == State_Done || m_state == State_Failed)
+				break;
+			Inflate();
+			continue;
+		}
+
+		size_t count = m_outputEnd - m_outputRead;
+		if (count > size - copied) count = size - copied;
+		memcpy(buffer + copied, &m_output[m_outputRead], count);
+		m_outputRead += count;
+		copied += count;
+	}
+	return copied;
+}
+
+// Reads the next block of the file into the input.
+bool Inflater::ReadInput()
+{
+	if (m_inputDone)
+		return false;
+
+	m_inputPos = 0;
+	m_inputEnd = ReadFromFile(m_file, (char*)m_input.data(), m_input.size(), m_stats);
+	if (m_inputEnd < m_input.size())
+		m_inputDone = true;
+	return m_inputEnd > 0;
+}
+
+// Tops up the bit buffer to at least 57 bits (unless the file runs out).
+void Inflater::Fill()
+{
+	// Whole bytes at once while there's plenty of input
+	if (m_inputEnd - m_inputPos >= 8) {
+		uint64_t word;
+		memcpy(&word, &m_input[m_inputPos], sizeof(word));
+		int bytes = (63 - m_bitCount) >> 3;
+		int bitCount = m_bitCount + bytes * 8;
+		m_bits |= (word << m_bitCount) & ((1ull << bitCount) - 1);
+		m_bitCount = bitCount;
+		m_inputPos += bytes;
+		return;
+	}
+
+	while (m_bitCount <= 56) {
+		if (m_inputPos == m_inputEnd && !ReadInput())
+			return;
+		m_bits |= (uint64_t)m_input[m_inputPos++] << m_bitCount;
+		m_bitCount += 8;
+	}
+}
+
+bool Inflater::GetBits(int count, uint32_t& out)
+{
+	if (m_bitCount < count) {
+		Fill();
+		if (m_bitCount < count)
+			return Fail();
+	}
+
+	out = (uint32_t)(m_bits & ((1ull << count) - 1));
+	m_bits >>= count;
+	m_bitCount -= count;
+	return true;
+}
+
+// True if there's anything left after the current (byte aligned) position.
+bool Inflater::HasMoreInput()
+{
+	return m_bitCount >= 8 || m_inputPos < m_inputEnd || ReadInput();
+}
+
+// The next symbol of a Huffman code, or -1 if the bits aren't a code (or run out).
+int Inflater::Decode(const HuffmanCode& code)
+{
+	uint16_t entry = code.fast[m_bits & ((1u << HuffmanCode::FastBits) - 1)];
+	int length = entry & 15;
+	if (entry != 0 && length <= m_bitCount) {
+		m_bits >>= length;
+		m_bitCount -= length;
+		return entry >> 4;
+	}
+
+	// Longer than the table covers, so walk the code a bit at a time
+	int value = 0;
+	int first = 0;
+	int index = 0;
+	for (length = 1; length <= HuffmanCode::MaxBits && length <= m_bitCount; length++) {
+		value |= (int)(m_bits >> (length - 1)) & 1;
+		int count = code.counts[length];
+		if (value - count < first) {
+			m_bits >>= length;
+			m_bitCount -= length;
+			return code.symbols[index + value - first];
+		}
+		index += count;
+		first = (first + count) << 1;
+		value <<= 1;
+	}
+	return -1;
+}
+
+// Adds everything inflated since the last call to the member's CRC and size.
+void Inflater::Checksum()
+{
+	m_crc = UpdateCrc(m_crc, m_output.data() + m_checkedEnd, m_outputEnd - m_checkedEnd);
+	m_memberSize += (uint32_t)(m_outputEnd - m_checkedEnd);
+	m_checkedEnd = m_outputEnd;
+}
+
+// Inflates up to another OutputChunkSize bytes (a little more if it ends on a match).
+void Inflater::Inflate()
+{
+	// Keep only what later matches can still refer to
+	if (m_outputEnd > HistorySize) {
+		memmove(m_output.data(), m_output.data() + m_outputEnd - HistorySize, HistorySize);
+		m_outputEnd = m_outputRead = m_checkedEnd = HistorySize;
+	}
+
+	size_t limit = m_outputEnd + OutputChunkSize;
+	while (m_outputEnd < limit) {
+		bool ok = true;
+		switch (m_state) {
+		case State_Header: ok = ReadHeader(); break;
+		case State_BlockStart: ok = m_lastBlock ? ReadTrailer() : ReadBlockHeader(); break;
+		case State_Stored: ok = InflateStored(limit); break;
+		case State_Codes: ok = InflateCodes(limit); break;
+		default: ok = false; break;
+		}
+		if (!ok || m_state == State_Done)
+			break;
+	}
+
+	Checksum();
+}
+
+bool Inflater::ReadHeader()
+{
+	// Members can follow each other; anything else after the first one is ignored (like gzip does)
+	if (m_memberCount > 0 && !HasMoreInput()) {
+		m_state = State_Done;
+		return true;
+	}
+
+	uint32_t id1, id2, method, flags, ignored;
+	if (!GetBits(8, id1) || !GetBits(8, id2) || !GetBits(8, method) || !GetBits(8, flags))
+		return false;
+	if (id1 != 0x1F || id2 != 0x8B || method != 8 || (flags & 0xE0) != 0) {
+		if (m_memberCount == 0)
+			return Fail();
+		m_state = State_Done;
+		return true;
+	}
+
+	// Modification time, extra flags and OS
+	for (int i = 0; i < 6; i++) {
+		if (!GetBits(8, ignored)) return false;
+	}
+
+	// Optional extra field, file name, comment and header CRC
+	if (flags & 4) {
+		uint32_t extraLength;
+		if (!GetBits(16, extraLength)) return false;
+		for (uint32_t i = 0; i < extraLength; i++) {
+			if (!GetBits(8, ignored)) return false;
+		}
+	}
+	for (uint32_t field = 8; field <= 16; field <<= 1) {
+		if (!(flags & field)) continue;
+		do {
+			if (!GetBits(8, ignored)) return false;
+		} while (ignored != 0);
+	}
+	if ((flags & 2) && !GetBits(16, ignored))
+		return false;
+
+	m_crc = 0;
+	m_memberSize = 0;
+	m_lastBlock = false;
+	m_state = State_BlockStart;
+	return true;
+}
+
+bool Inflater::ReadBlockHeader()
+{
+	uint32_t last, type;
+	if (!GetBits(1, last) || !GetBits(2, type))
+		return false;
+	m_lastBlock = (last != 0);
+
+	if (type == 0) {
+		uint32_t length, inverse;
+		AlignToByte();
+		if (!GetBits(16, length) || !GetBits(16, inverse))
+			return false;
+		if (length != (~inverse & 0xFFFF))
+			return Fail();
+		m_storedRemaining = length;
+		m_state = State_Stored;
+		return true;
+	}
+
+	if (type == 1) {
+		// The fixed codes (RFC 1951, 3.2.6)
+		uint8_t lengths[288 + 30];
+		memset(lengths, 8, 144);
+		memset(lengths + 144, 9, 112);
+		memset(lengths + 256, 7, 24);
+		memset(lengths + 280, 8, 8);
+		memset(lengths + 288, 5, 30);
+		m_lengthCode.Build(lengths, 288);
+		m_distanceCode.Build(lengths + 288, 30);
+		m_state = State_Codes;
+		return true;
+	}
+
+	if (type == 2 && ReadDynamicCodes()) {
+		m_state = State_Codes;
+		return true;
+	}
+	return Fail();
+}
+
+bool Inflater::ReadDynamicCodes()
+{
+	uint32_t lengthCount, distanceCount, codeLengthCount;
+	if (!GetBits(5, lengthCount) || !GetBits(5, distanceCount) || !GetBits(4, codeLengthCount))
+		return false;
+	lengthCount += 257;
+	distanceCount += 1;
+	codeLengthCount += 4;
+	if (lengthCount > 286 || distanceCount > 30)
+		return false;
+
+	// The code the other two codes' lengths are written with
+	uint8_t lengths[286 + 30] = {};
+	for (uint32_t i = 0; i < codeLengthCount; i++) {
+		uint32_t length;
+		if (!GetBits(3, length)) return false;
+		lengths[s_codeLengthOrder[i]] = (uint8_t)length;
+	}
+	HuffmanCode codeLengthCode;
+	if (!codeLengthCode.Build(lengths, 19))
+		return false;
+
+	// Then the lengths of both codes, as one run (repeats can cross from one to the other)
+	memset(lengths, 0, sizeof(lengths));
+	uint32_t total = lengthCount + distanceCount;
+	for (uint32_t i = 0; i < total; ) {
+		if (m_bitCount < 16) Fill();
+		int symbol = Decode(codeLengthCode);
+		if (symbol < 0)
+			return false;
+		if (symbol < 16) {
+			lengths[i++] = (uint8_t)symbol;
+			continue;
+		}
+
+		uint32_t repeat = 0;
+		uint8_t value = 0;
+		if (symbol == 16) {
+			if (i == 0 || !GetBits(2, repeat)) return false;
+			value = lengths[i - 1];
+			repeat += 3;
+		}
+		else if (symbol == 17) {
+			if (!GetBits(3, repeat)) return false;
+			repeat += 3;
+		}
+		else {
+			if (!GetBits(7, repeat)) return false;
+			repeat += 11;
+		}
+		if (i + repeat > total)
+			return false;
+		memset(lengths + i, value, repeat);
+		i += repeat;
+	}
+
+	// There has to be a way to end the block
+	if (lengths[256] == 0)
+		return false;
+	return m_lengthCode.Build(lengths, lengthCount) && m_distanceCode.Build(lengths + lengthCount, distanceCount);
+}
+
+bool Inflater::ReadTrailer()
+{
+	Checksum();
+
+	uint32_t crc, size;
+	AlignToByte();
+	if (!GetBits(32, crc) || !GetBits(32, size))
+		return false;
+	if (crc != m_crc || size != m_memberSize)
+		return Fail();
+
+	m_memberCount++;
+	m_state = State_Header;
+	return true;
+}
+
+bool Inflater::InflateStored(size_t limit)
+{
+	while (m_storedRemaining > 0 && m_outputEnd < limit) {
+		uint32_t byte;
+		if (!GetBits(8, byte))
+			return false;
+		m_output[m_outputEnd++] = (unsigned char)byte;
+		m_storedRemaining--;
+	}
+	if (m_storedRemaining == 0)
+		m_state = State_BlockStart;
+	return true;
+}
+
+bool Inflater::InflateCodes(size_t limit)
+{
+	unsigned char* output = m_output.data();
+	while (m_outputEnd < limit) {
+		// Enough bits for a whole length and distance pair (15 + 5 + 15 + 13)
+		if (m_bitCount < 48) Fill();
+
+		int symbol = Decode(m_lengthCode);
+		if (symbol < 256) {
+			if (symbol < 0)
+				return Fail();
+			output[m_outputEnd++] = (unsigned char)symbol;
+			continue;
+		}
+		if (symbol == 256) {
+			m_state = State_BlockStart;
+			return true;
+		}
+
+		symbol -= 257;
+		if (symbol >= 29)
+			return Fail();
+		uint32_t extra;
+		if (!GetBits(s_lengthExtra[symbol], extra))
+			return false;
+		size_t length = s_lengthBase[symbol] + extra;
+
+		symbol = Decode(m_distanceCode);
+		if (symbol < 0 || symbol >= 30 || !GetBits(s_distanceExtra[symbol], extra))
+			return Fail();
+		size_t distance = s_distanceBase[symbol] + extra;
+		if (distance > m_outputEnd)
+			return Fail();
+
+		// Overlapping copies repeat the bytes they've just written, so those go a byte at a time
+		unsigned char* to = output + m_outputEnd;
+		const unsigned char* from = to - distance;
+		if (distance >= length) {
+			memcpy(to, from, length);
+		}
+		else {
+			for (size_t i = 0; i < length; i++)
+				to[i] = from[i];
+		}
+		m_outputEnd += length;
+	}
+	return true;
+}
+
+
+double StreamStats::GetRatio() const
+{
+	return fileBytes > 0 ? (double)bytes / fileBytes : 0.0;
+}
+
+
+CompressedStream::CompressedStream(const char* pathToFile)
+	: m_file(pathToFile, std::ios::binary), m_compression(StreamCompression_None), m_isOpen(false), m_failed(false), m_sizeHint(0)
+{
+	if (!m_file)
+		return;
+
+	// Look at the start (and the end, for the size), then go back to the start
+	unsigned char magic[4] = {};
+	m_file.read((char*)magic, sizeof(magic));
+	m_compression = DetectCompression(magic, (size_t)m_file.gcount());
+	m_file.clear();
+	m_file.seekg(0, std::ios::end);
+	size_t fileSize = (size_t)m_file.tellg();
+	m_sizeHint = fileSize;
+	if (m_compression == StreamCompression_Gzip && fileSize >= 18) {
+		unsigned char trailer[4] = {};
+		m_file.seekg(fileSize - 4);
+		m_file.read((char*)trailer, sizeof(trailer));
+		m_sizeHint = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((size_t)trailer[3] << 24);
+	}
+	m_file.clear();
+	m_file.seekg(0);
+
+	if (m_compression == StreamCompression_Zstd)
+		return;
+	if (m_compression == StreamCompression_Gzip)
+		m_inflater.reset(new Inflater(m_file, m_stats));
+	m_isOpen = true;
+}
+
+// Here rather than in the header, where Inflater is incomplete
+CompressedStream::~CompressedStream()
+{
+}
+
+size_t CompressedStream::Read(char* buffer, size_t size)
+{
+	if (!m_isOpen || m_failed)
+		return 0;
+
+	size_t read = 0;
+	if (m_inflater == nullptr) {
+		read = ReadFromFile(m_file, buffer, size, m_stats);
+	}
+	else {
+		// Reads happen inside the inflater, so take their time back out
+		double start = GetSeconds();
+		double readSeconds = m_stats.readSeconds;
+		read = m_inflater->Read(buffer, size);
+		m_stats.decompressSeconds += (GetSeconds() - start) - (m_stats.readSeconds - readSeconds);
+		m_failed = m_inflater->HasFailed();
+	}
+
+	m_stats.bytes += read;
+	return read;
+}
+
+StreamCompression CompressedStream::DetectCompression(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	if (size >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B)
+		return StreamCompression_Gzip;
+	if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD)
+		return StreamCompression_Zstd;
+	return StreamCompression_None;
+}
+
+bool CompressedStream::ReadFile(const char* pathToFile, std::vector<char>& out, StreamStats* stats)
+{
+	CompressedStream stream(pathToFile);
+	if (!stream.IsOpen())
+		return false;
+
+	out.clear();
+	out.reserve(stream.GetSizeHint());
+	while (true) {
+		size_t size = out.size();
+		out.resize(size + ReadBlockSize);
+		size_t read = stream.Read(out.data() + size, ReadBlockSize);
+		out.resize(size + read);
+		if (read < ReadBlockSize)
+			break;
+	}
+
+	if (stats != nullptr) *stats = stream.GetStats();
+	return !stream.HasFailed();
+}
+
+// Getters
+bool CompressedStream::IsOpen() const { return m_isOpen; }
+StreamCompression CompressedStream::GetCompression() const { return m_compression; }
+bool CompressedStream::HasFailed() const { return m_failed; }
+size_t CompressedStream::GetSizeHint() const { return m_sizeHint; }
+const StreamStats& CompressedStream::GetStats() const { return m_stats; }
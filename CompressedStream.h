@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+// What a file's contents are stored as (found from its first bytes, not its name).
+enum StreamCompression
+{
+	StreamCompression_None,
+	StreamCompression_Gzip,
+	StreamCompression_Zstd,		// Recognized, but can't be read
+};
+
+// Where the time went while reading a stream.
+struct StreamStats
+{
+	size_t fileBytes = 0;			// Read from disk
+	size_t bytes = 0;				// Handed out (after decompression)
+	double readSeconds = 0.0;		// Waiting on the file
+	double decompressSeconds = 0.0;	// Inflating (not including the reads it waited on)
+
+	double GetRatio() const;		// bytes / fileBytes
+};
+
+class Inflater;
+
+// --------------------------------------------------------
+// Reads a file from the start in fixed size blocks, inflating
+// it on the way if it's compressed
+//
+// - Only ReadBlockSize bytes of the file and the last 32 KB of
+//   its decompressed contents (what DEFLATE can refer back to)
+//   are held at any time, however big the file is.
+// - gzip (DEFLATE) is decoded here, checked against the CRC and
+//   size in every member's trailer. Concatenated members are read
+//   one after another, like gzip itself does.
+// - zstd files are recognized by their magic number, but there's
+//   no decoder for them, so they don't open.
+// - Anything else is read as is, so callers can use a stream for
+//   every file and not care which ones are compressed.
+// --------------------------------------------------------
+class CompressedStream
+{
+public:
+	// Bytes read from the file at once.
+	static const size_t ReadBlockSize = 256 * 1024;
+
+	CompressedStream(const char* pathToFile);
+	~CompressedStream();
+
+	// Not copyable, since it owns the file.
+	CompressedStream(const CompressedStream&) = delete;
+	CompressedStream& operator=(const CompressedStream&) = delete;
+
+	// True if the file exists and is in a format that can be read.
+	bool IsOpen() const;
+	StreamCompression GetCompression() const;
+
+	// Copy the next "size" bytes of the contents into buffer.
+	// - Returns fewer only at the end of the contents (or if it fails).
+	size_t Read(char* buffer, size_t size);
+
+	// True if the compressed data turned out to be corrupt or truncated.
+	bool HasFailed() const;
+
+	// How big the contents should be, for sizing buffers up front (0 if it can't tell).
+	// - For gzip this is the size the last member's trailer gives, so it's only
+	//   right for files with one member (of under 4 GB), which is nearly all of them.
+	size_t GetSizeHint() const;
+
+	const StreamStats& GetStats() const;
+
+	// Which format some data starts with.
+	static StreamCompression DetectCompression(const void* data, size_t size);
+
+	// Read a whole file into memory, decompressed. Returns false if it can't be opened or read.
+	static bool ReadFile(const char* pathToFile, std::vector<char>& out, StreamStats* stats = nullptr);
+
+private:
+	std::ifstream m_file;
+	StreamCompression m_compression;
+	bool m_isOpen;
+	bool m_failed;
+	size_t m_sizeHint;
+	StreamStats m_stats;
+	std::unique_ptr<Inflater> m_inflater;	// Only for gzip
+};
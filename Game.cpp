@@ -1,5 +1,8 @@
 #include "Game.h"
 #include "Vertex.h"
+#include "ObjParser.h"
+#include "MeshBuilder.h"
+#include "MeshSimplifier.h"
 
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
@@ -29,6 +32,10 @@ Game::Game(HINSTANCE hInstance)
 	// Do we want a console window?  Probably only in debug mode
 	CreateConsoleWindow(500, 120, 32, 120);
 	printf("Console window created successfully.  Feel free to printf() here.\n");
+
+	// Report how fast each model file is parsed, and how well it welds
+	ObjParser::SetReportThroughput(true);
+	Mesh::SetReportStats(true);
 #endif
 
 }
@@ -113,6 +120,8 @@ void Game::Init()
 void Game::LoadShaders()
 {
 	normalMapVertexShader = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"VS_Normal.cso").c_str());
+	packedNormalMapVertexShader = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"VS_NormalPacked.cso").c_str());
+	quantizedNormalMapVertexShader = std::make_shared<SimpleVertexShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"VS_NormalQuantized.cso").c_str());
 	normalMapPixelShader = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"PS_Normal.cso").c_str());
 
 	PBRPixelShader = std::make_shared<SimplePixelShader>(device.Get(), context.Get(), GetFullPathTo_Wide(L"PS_PBR.cso").c_str());
@@ -188,11 +197,46 @@ void Game::CreateBasicGeometry()
 	std::shared_ptr<Material> matSnowman = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 100, PBRPixelShader, normalMapVertexShader, textureSRVPtr, textureSSPtr,
 		normalMapSRVPtr, roughnessSRVPtr, metalnessSRVPtr);
 
-
-
-	// Create the meshes from a .obj file.
+	// A plain white texture, so a material can be just its color tint
+	const uint32_t white = 0xFFFFFFFF;
+	D3D11_TEXTURE2D_DESC whiteDesc = {};
+	whiteDesc.Width = 1;
+	whiteDesc.Height = 1;
+	whiteDesc.MipLevels = 1;
+	whiteDesc.ArraySize = 1;
+	whiteDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	whiteDesc.SampleDesc.Count = 1;
+	whiteDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	whiteDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	D3D11_SUBRESOURCE_DATA whiteData = {};
+	whiteData.pSysMem = &white;
+	whiteData.SysMemPitch = sizeof(white);
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> whiteTexture;
+	device->CreateTexture2D(&whiteDesc, &whiteData, whiteTexture.GetAddressOf());
+	device->CreateShaderResourceView(whiteTexture.Get(), nullptr, whiteSRVPtr.GetAddressOf());
+
+
+
+	// Create the player's mesh from a .obj file, and build the cube in memory.
+	// - The player is simplified into levels of detail and reordered for the
+	//   GPU's vertex cache when first cooked; the cube is only 24 vertices
+	//   and 12 triangles, so it needs neither (and has no file to read)
+	// - The player uses quantized vertices and is split into meshlets,
+	//   the cube stays full size since the sky shader draws it too
+	// - Both share pooled buffers with any other mesh of their vertex format
+	// - Both get a position only stream, which the shadow pass draws
+	// - Only the player keeps anything on the CPU (its positions, for
+	//   an exact box); nothing reads the cube's vertices back
+	Mesh::SetUseGeometryPool(true);
+	Mesh::SetBuildFlags(MeshBuild_Optimize | MeshBuild_Lods | MeshBuild_Meshlets | MeshBuild_PositionStream);
+	Mesh::SetFileVertexFormat(VertexFormat_Quantized);
+	Mesh::SetDefaultRetention(MeshRetention_Positions);
 	meshPlayer = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/SnowmanOBJ.obj").c_str(), device.Get());
-	meshCube = std::make_shared<Mesh>(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device.Get());
+	Mesh::SetBuildFlags(MeshBuild_PositionStream);
+	Mesh::SetFileVertexFormat(VertexFormat_Full);
+	Mesh::SetDefaultRetention(MeshRetention_None);
+	meshCube = std::make_shared<Mesh>(MeshPrimitives::Cube(), device.Get());
+	Mesh::ReportResidentMemory();
 
 
 
@@ -201,6 +245,13 @@ void Game::CreateBasicGeometry()
 	player = std::make_unique<Player>(XMFLOAT3(0.0f, 0.0f, -5.0f), meshPlayer, matSnowman, aspectRatio);
 	entities.push_back(player->GetGameEntity());
 
+	// Each part of the player in the material its MTL file gives it
+	for (unsigned int i = 0; i < meshPlayer->GetSubmeshCount(); i++) {
+		const ObjMaterial* objMaterial = meshPlayer->GetSubmeshMaterial(i);
+		if (objMaterial != nullptr)
+			player->GetGameEntity()->SetSubmeshMaterial(i, CreateMaterial(*objMaterial, matSnowman));
+	}
+
 	// Create the PBR materials
 	for (int i = 0; i < 3; i++) {
 		for (int j = 0; j < 5; j++) {
@@ -218,6 +269,36 @@ void Game::CreateBasicGeometry()
 }
 
 
+// --------------------------------------------------------
+// A Material for one read from an MTL file, drawn with the shaders (and
+// any maps the MTL doesn't have) of another
+// - Its diffuse map is looked for next to the models by file name
+//   alone, since exporters tend to write their own absolute paths.
+//   If it isn't there (or can't be read), the fallback's is used.
+// - Without a diffuse map it's just its diffuse color
+// --------------------------------------------------------
+std::shared_ptr<Material> Game::CreateMaterial(const ObjMaterial& objMaterial, std::shared_ptr<Material> fallback)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> albedo = fallback->GetTextureSRVComPtr();
+	XMFLOAT4 colorTint = XMFLOAT4(1.0f, 1.0f, 1.0f, objMaterial.opacity);
+	if (objMaterial.diffuseMap.empty()) {
+		albedo = whiteSRVPtr;
+		colorTint = XMFLOAT4(objMaterial.diffuse.x, objMaterial.diffuse.y, objMaterial.diffuse.z, objMaterial.opacity);
+	}
+	else {
+		std::string fileName = objMaterial.diffuseMap.substr(objMaterial.diffuseMap.find_last_of("/\\") + 1);
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture;
+		if (SUCCEEDED(CreateWICTextureFromFile(device.Get(), context.Get(),
+			GetFullPathTo_Wide(L"../../Assets/Models/" + std::wstring(fileName.begin(), fileName.end())).c_str(), nullptr, texture.GetAddressOf())))
+			albedo = texture;
+	}
+
+	int specular = objMaterial.specularExponent > 0.0f ? (int)objMaterial.specularExponent : fallback->GetSpecularExponent();
+	return std::make_shared<Material>(colorTint, specular, fallback->GetPixelShader(), fallback->GetVertexShader(), albedo, fallback->GetTextureSSComPtr(),
+		fallback->GetNormalMapSRVComPtr(), fallback->GetRoughnessSRVComPtr(), fallback->GetMetalnessSRVComPtr());
+}
+
+
 // --------------------------------------------------------
 // Handle resizing DirectX "stuff" to match the new window size.
 // For instance, updating our projection matrix's aspect ratio.
@@ -289,6 +370,10 @@ void Game::Update(float deltaTime, float totalTime)
 	}
 	*/
 
+	// Everything has moved, so bring the world matrices (and the children of
+	// anything that moved) up to date in one pass, rather than as they're drawn
+	Transform::UpdateHierarchy();
+
 }
 
 // --------------------------------------------------------
@@ -309,48 +394,27 @@ void Game::Draw(float deltaTime, float totalTime)
 		1.0f,
 		0);
 
+	// Mesh::Bind can't know what was set in the input assembler last frame
+	Mesh::ResetBinding();
 
-	// Draw each of the entities.
-	for (int i = 0; i < entities.size(); i++) {
-
-		// Set the vertex and pixel shaders to use for the next Draw() command
-		entities[i]->GetMaterial()->GetVertexShader()->SetShader();
-		entities[i]->GetMaterial()->GetPixelShader()->SetShader();
-
-		// Create, map, and bind the constant buffer for the vertex shader.
-		// - Create data for the constant buffer.
-		// - Map the resource.
-		std::shared_ptr<SimpleVertexShader> vs = entities[i]->GetMaterial()->GetVertexShader();
-		vs->SetFloat4("colorTint", entities[i]->GetMaterial()->GetColorTint());
-		vs->SetMatrix4x4("worldMatrix", entities[i]->GetTransform()->GetWorldMatrix());
-		vs->SetMatrix4x4("viewMatrix", player->GetCamera()->GetViewMatrix());
-		vs->SetMatrix4x4("projMatrix", player->GetCamera()->GetProjMatrix());
-		vs->SetFloat4("specular", XMFLOAT4((float) entities[i]->GetMaterial()->GetSpecularExponent(), 0.0f, 0.0f, 0.0f));
-		vs->CopyAllBufferData();
-
-		// Set the pixel shader states required to display the texture.
-		std::shared_ptr<SimplePixelShader> ps = entities[i]->GetMaterial()->GetPixelShader();
-		ps->SetShaderResourceView("albedo", entities[i]->GetMaterial()->GetTextureSRVComPtr().Get());
-		if (entities[i]->GetMaterial()->GetNormalMapSRVComPtr().Get() != nullptr)				// If the material has a normal map, set it.
-			ps->SetShaderResourceView("normalMap", entities[i]->GetMaterial()->GetNormalMapSRVComPtr().Get());
-		if (entities[i]->GetMaterial()->GetRoughnessSRVComPtr().Get() != nullptr) {				// If the material has PBR info, set it.
-			ps->SetShaderResourceView("roughnessMap", entities[i]->GetMaterial()->GetRoughnessSRVComPtr().Get());
-			ps->SetShaderResourceView("metalnessMap", entities[i]->GetMaterial()->GetMetalnessSRVComPtr().Get());
-		}
-		ps->SetSamplerState("samplerOptions", entities[i]->GetMaterial()->GetTextureSSComPtr().Get());
 
-		// Set the data for the lights.
-		ps->SetData("lights", (void*)(&lightShaderInputs[0]), sizeof(LightShaderInput) * MAX_LIGHTS);
-		ps->SetFloat("numOfLights", lightShaderInputs.size());
-		ps->SetData("cameraPos", &(player->GetCamera()->GetTransform().GetPosition()), sizeof(XMFLOAT3));
-		ps->CopyBufferData("ExternalData");
+	// World * view * projection of every entity from the camera, all at once
+	Camera* camera = player->GetCamera();
+	wvpBatch.Clear();
+	uint32_t cameraView = wvpBatch.AddView(camera->GetViewMatrix(), camera->GetProjMatrix());
+	for (auto& entity : entities)
+		wvpBatch.AddWorld(entity->GetTransform()->GetWorldAffine());
+	wvpBatch.Compute();
 
+	// Draw each of the entities.
+	for (int i = 0; i < entities.size(); i++) {
 
-		// Draw the entities
-		DrawMesh(entities[i]->GetMesh());
+		// Draw the entities (at the level of detail their distance allows,
+		// culling the meshlets of ones close enough to need full detail)
+		DrawEntity(entities[i].get(), camera, wvpBatch.Get(cameraView, i));
 
 		// Draw the sky.
-		skybox->Draw(player->GetCamera(), context.Get());
+		skybox->Draw(camera, context.Get());
 	}
 
 	
@@ -367,28 +431,150 @@ void Game::Draw(float deltaTime, float totalTime)
 }
 
 
-void Game::DrawMesh(Mesh* mesh)
+// --------------------------------------------------------
+// The vertex shader to draw a mesh with
+// - Swaps the normal map vertex shader for the version that matches
+//   the mesh's packed vertex format, if it has one
+// --------------------------------------------------------
+std::shared_ptr<SimpleVertexShader> Game::GetVertexShaderFor(std::shared_ptr<SimpleVertexShader> vs, Mesh* mesh)
+{
+	if (vs != normalMapVertexShader)
+		return vs;
+
+	switch (mesh->GetVertexFormat()) {
+	case VertexFormat_Packed: return packedNormalMapVertexShader;
+	case VertexFormat_Quantized: return quantizedNormalMapVertexShader;
+	default: return vs;
+	}
+}
+
+// --------------------------------------------------------
+// The level of detail to draw an entity's mesh at
+// - The coarsest one whose error stays under a pixel on screen,
+//   measured from the closest point of the mesh's bounding sphere
+// --------------------------------------------------------
+unsigned int Game::SelectLod(GameEntity* entity, Camera* camera)
+{
+	Mesh* mesh = entity->GetMesh();
+	if (mesh->GetLodCount() <= 1)
+		return 0;
+
+	XMFLOAT3 scale = entity->GetTransform()->GetScale();
+	float worldScale = fmaxf(fabsf(scale.x), fmaxf(fabsf(scale.y), fabsf(scale.z)));
+
+	BoundingSphere bounds = mesh->GetBoundingSphere();
+	XMFLOAT4X4 world = entity->GetTransform()->GetWorldMatrix();
+	XMVECTOR worldCenter = XMVector3Transform(XMLoadFloat3(&bounds.Center), XMLoadFloat4x4(&world));
+	XMFLOAT3 cameraPos = camera->GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(worldCenter, XMLoadFloat3(&cameraPos))));
+	distance -= bounds.Radius * worldScale;
+
+	return mesh->SelectLod(distance, worldScale, MeshSimplifier::GetPixelsPerUnit(camera->GetFovAngle(), (float)this->height));
+}
+
+// --------------------------------------------------------
+// Draws an entity's mesh at a level of detail (or just the
+// meshlets that face the camera and are in view)
+// - The buffers are bound once, then each submesh is a range of
+//   them drawn with its own material
+// - Neighbouring submeshes with the same material are drawn
+//   together, and a material is only set when it changes
+// --------------------------------------------------------
+void Game::DrawEntity(GameEntity* entity, Camera* camera, const XMFLOAT4X4& worldViewProj)
 {
+	Mesh* mesh = entity->GetMesh();
+	unsigned int lod = SelectLod(entity, camera);
+	bool culled = (lod == 0 && mesh->GetMeshletCount() > 0);
+	if (culled && mesh->CullMeshlets(context.Get(), entity->GetTransform()->GetWorldMatrix(),
+		camera->GetViewMatrix(), camera->GetProjMatrix(), camera->GetPosition()) == 0)
+		return;
 
 	// Set buffers in the input assembler
-	//  - Do this ONCE PER OBJECT you're drawing, since each object might
-	//    have different geometry.
-	//  - for this demo, this step *could* simply be done once during Init(),
-	//    but I'm doing it here because it's often done multiple times per frame
-	//    in a larger application/game
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, mesh->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
-
-
-	// Finally do the actual drawing
-	//  - Do this ONCE PER OBJECT you intend to draw
-	//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
-	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
-	//     vertices in the currently set VERTEX BUFFER
-	context->DrawIndexed(
-		mesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+	//  - Only changes them if the last mesh drawn was in a different pool
+	//    (or had its own buffers)
+	mesh->Bind(context.Get(), culled);
+
+	// The culled index buffer starts at 0, the mesh's own ranges at its first index
+	unsigned int firstIndex = culled ? 0 : mesh->GetFirstIndex();
+	Material* current = nullptr;
+	Material* pending = nullptr;
+	MeshSubmesh range = {};
+	for (unsigned int i = 0; i <= mesh->GetSubmeshCount(); i++) {
+		MeshSubmesh submesh = {};
+		Material* material = nullptr;
+		if (i < mesh->GetSubmeshCount()) {
+			submesh = culled ? mesh->GetCulledSubmesh(i) : mesh->GetSubmesh(lod, i);
+			if (submesh.indexCount == 0)
+				continue;
+			material = entity->GetMaterial(i);
+
+			// Carries straight on from the last one?
+			if (material == pending && submesh.indexOffset == range.indexOffset + range.indexCount) {
+				range.indexCount += submesh.indexCount;
+				continue;
+			}
+		}
+
+		// Draw what's been gathered so far
+		if (pending != nullptr && range.indexCount > 0) {
+			if (pending != current) {
+				SetMaterial(entity, pending, camera, worldViewProj);
+				current = pending;
+			}
+			context->DrawIndexed(
+				range.indexCount,     // The number of indices to use (just the ones of this range)
+				firstIndex + range.indexOffset,     // Offset to the first index we want to use
+				mesh->GetBaseVertex());    // Offset to add to each index when looking up vertices
+		}
+		pending = material;
+		range = submesh;
+	}
+}
+
+// --------------------------------------------------------
+// Sets the shaders (and their data) an entity is drawn with
+// for one of its materials
+// - worldViewProj is the entity's from wvpBatch
+// --------------------------------------------------------
+void Game::SetMaterial(GameEntity* entity, Material* material, Camera* camera, const XMFLOAT4X4& worldViewProj)
+{
+	// Set the vertex and pixel shaders to use for the next Draw() command
+	// - Meshes with smaller vertices need the version of the vertex shader that unpacks them
+	std::shared_ptr<SimpleVertexShader> vs = GetVertexShaderFor(material->GetVertexShader(), entity->GetMesh());
+	vs->SetShader();
+	material->GetPixelShader()->SetShader();
+
+	// Create, map, and bind the constant buffer for the vertex shader.
+	// - Create data for the constant buffer.
+	// - Map the resource.
+	if (entity->GetMesh()->GetVertexFormat() == VertexFormat_Quantized) {
+		PositionQuantization quantization = entity->GetMesh()->GetPositionQuantization();
+		vs->SetFloat3("positionMin", quantization.min);
+		vs->SetFloat3("positionScale", quantization.scale);
+	}
+	vs->SetFloat4("colorTint", material->GetColorTint());
+	AffineMatrix world = entity->GetTransform()->GetWorldAffine();
+	AffineMatrix normal = entity->GetTransform()->GetNormalMatrix();
+	vs->SetData("worldMatrix", &world, sizeof(AffineMatrix));	// Both row_major float3x4s in the shader
+	vs->SetData("normalMatrix", &normal, sizeof(AffineMatrix));
+	vs->SetMatrix4x4("worldViewProj", worldViewProj);
+	vs->SetFloat4("specular", XMFLOAT4((float) material->GetSpecularExponent(), 0.0f, 0.0f, 0.0f));
+	vs->CopyAllBufferData();
+
+	// Set the pixel shader states required to display the texture.
+	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+	ps->SetShaderResourceView("albedo", material->GetTextureSRVComPtr().Get());
+	if (material->GetNormalMapSRVComPtr().Get() != nullptr)				// If the material has a normal map, set it.
+		ps->SetShaderResourceView("normalMap", material->GetNormalMapSRVComPtr().Get());
+	if (material->GetRoughnessSRVComPtr().Get() != nullptr) {				// If the material has PBR info, set it.
+		ps->SetShaderResourceView("roughnessMap", material->GetRoughnessSRVComPtr().Get());
+		ps->SetShaderResourceView("metalnessMap", material->GetMetalnessSRVComPtr().Get());
+	}
+	ps->SetSamplerState("samplerOptions", material->GetTextureSSComPtr().Get());
+
+	// Set the data for the lights.
+	ps->SetData("lights", (void*)(&lightShaderInputs[0]), sizeof(LightShaderInput) * MAX_LIGHTS);
+	ps->SetFloat("numOfLights", lightShaderInputs.size());
+	ps->SetData("cameraPos", &(camera->GetPosition()), sizeof(XMFLOAT3));
+	ps->CopyBufferData("ExternalData");
 }
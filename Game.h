@@ -9,6 +9,7 @@
 #include "Light.h"
 #include "Sky.h"
 #include "Player.h"
+#include "WorldViewProjBatch.h"
 
 
 
@@ -36,6 +37,7 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> normalMapSRVPtr;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughnessSRVPtr;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalnessSRVPtr;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> whiteSRVPtr;		// 1x1 white, for materials that are only a color
 
 
 	// Vector to hold five entities
@@ -52,6 +54,9 @@ public:
 	std::shared_ptr<Sky> skybox;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeMap;
 
+	// World * view * projection of every entity, worked out at the start of each Draw
+	WorldViewProjBatch wvpBatch;
+
 
 
 
@@ -61,7 +66,10 @@ public:
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
-	void DrawMesh(Mesh* mesh);
+	void DrawEntity(GameEntity* entity, Camera* camera, const DirectX::XMFLOAT4X4& worldViewProj);
+	void SetMaterial(GameEntity* entity, Material* material, Camera* camera, const DirectX::XMFLOAT4X4& worldViewProj);
+	unsigned int SelectLod(GameEntity* entity, Camera* camera);
+	std::shared_ptr<SimpleVertexShader> GetVertexShaderFor(std::shared_ptr<SimpleVertexShader> vs, Mesh* mesh);
 
 
 
@@ -71,6 +79,7 @@ private:
 	// Initialization helper methods - feel free to customize, combine, etc.
 	void LoadShaders(); 
 	void CreateBasicGeometry();
+	std::shared_ptr<Material> CreateMaterial(const ObjMaterial& objMaterial, std::shared_ptr<Material> fallback);
 
 	
 	// Note the usage of ComPtr below
@@ -85,6 +94,8 @@ private:
 
 
 	std::shared_ptr<SimpleVertexShader> normalMapVertexShader;
+	std::shared_ptr<SimpleVertexShader> packedNormalMapVertexShader;		// VS_Normal for meshes with packed vertices
+	std::shared_ptr<SimpleVertexShader> quantizedNormalMapVertexShader;	// VS_Normal for meshes with quantized vertices
 	std::shared_ptr<SimpleVertexShader> shadowVertexShader;			// Only need a vertex shader for shadows, output is directly used.
 	std::shared_ptr<SimpleVertexShader> skyVertexShader;
 };
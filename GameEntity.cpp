@@ -3,7 +3,6 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat
 {
 	materialPtr = material;
 	meshPtr = mesh;
-	transform = Transform();
 }
 
 Mesh* GameEntity::GetMesh()
@@ -16,7 +15,16 @@ Transform* GameEntity::GetTransform()
 	return &transform;
 }
 
-Material* GameEntity::GetMaterial()
+Material* GameEntity::GetMaterial(unsigned int submesh)
 {
+	if (submesh < submeshMaterialPtrs.size() && submeshMaterialPtrs[submesh] != nullptr)
+		return submeshMaterialPtrs[submesh].get();
 	return materialPtr.get();
 }
+
+void GameEntity::SetSubmeshMaterial(unsigned int submesh, std::shared_ptr<Material> material)
+{
+	if (submesh >= submeshMaterialPtrs.size())
+		submeshMaterialPtrs.resize(submesh + 1);
+	submeshMaterialPtrs[submesh] = material;
+}
@@ -11,12 +11,16 @@ public:
 	GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
 
 	Mesh* GetMesh();
-	Transform* GetTransform();
-	Material* GetMaterial();
+	Transform* GetTransform();	// A handle into the shared TransformSystem, see Transform
+	Material* GetMaterial(unsigned int submesh = 0);	// The entity's material, unless the submesh has its own
+
+	// Draw one of the mesh's submeshes (see Mesh::GetSubmeshCount) with a material of its own.
+	void SetSubmeshMaterial(unsigned int submesh, std::shared_ptr<Material> material);
 
 private:
 	Transform transform;
 	std::shared_ptr<Mesh> meshPtr;
 	std::shared_ptr<Material> materialPtr;
+	std::vector<std::shared_ptr<Material>> submeshMaterialPtrs;	// nullptr for the ones without their own
 };
 
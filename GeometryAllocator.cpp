@@ -0,0 +1,98 @@
+#include "GeometryAllocator.h"
+#include <iterator>
+
+double GeometryAllocatorStats::GetOccupancy() const
+{
+	return capacity > 0 ? (double)used / capacity : 0.0;
+}
+
+double GeometryAllocatorStats::GetFragmentation() const
+{
+	uint32_t freeCount = capacity - used;
+	return freeCount > 0 ? 1.0 - (double)largestFreeBlock / freeCount : 0.0;
+}
+
+
+GeometryAllocator::GeometryAllocator(uint32_t capacity)
+{
+	Reset(capacity);
+}
+
+void GeometryAllocator::Reset(uint32_t capacity)
+{
+	m_capacity = capacity;
+	m_used = 0;
+	m_freeBlocks.clear();
+	m_allocations.clear();
+	if (capacity > 0)
+		m_freeBlocks[0] = capacity;
+}
+
+uint32_t GeometryAllocator::Allocate(uint32_t count)
+{
+	if (count == 0)
+		return InvalidOffset;
+
+	// The smallest block it fits in (the first one that's exactly right wins)
+	auto best = m_freeBlocks.end();
+	for (auto block = m_freeBlocks.begin(); block != m_freeBlocks.end(); ++block) {
+		if (block->second < count || (best != m_freeBlocks.end() && block->second >= best->second))
+			continue;
+		best = block;
+		if (block->second == count)
+			break;
+	}
+	if (best == m_freeBlocks.end())
+		return InvalidOffset;
+
+	// Take it from the front of the block
+	uint32_t offset = best->first;
+	uint32_t remaining = best->second - count;
+	m_freeBlocks.erase(best);
+	if (remaining > 0)
+		m_freeBlocks[offset + count] = remaining;
+
+	m_allocations[offset] = count;
+	m_used += count;
+	return offset;
+}
+
+void GeometryAllocator::Free(uint32_t offset)
+{
+	auto allocation = m_allocations.find(offset);
+	if (allocation == m_allocations.end())
+		return;
+
+	uint32_t size = allocation->second;
+	m_allocations.erase(allocation);
+	m_used -= size;
+
+	// Merge with the free blocks right after and right before it
+	auto next = m_freeBlocks.lower_bound(offset);
+	if (next != m_freeBlocks.end() && next->first == offset + size) {
+		size += next->second;
+		next = m_freeBlocks.erase(next);
+	}
+	if (next != m_freeBlocks.begin()) {
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset) {
+			previous->second += size;
+			return;
+		}
+	}
+	m_freeBlocks[offset] = size;
+}
+
+GeometryAllocatorStats GeometryAllocator::GetStats() const
+{
+	GeometryAllocatorStats stats;
+	stats.capacity = m_capacity;
+	stats.used = m_used;
+	stats.allocationCount = (uint32_t)m_allocations.size();
+	stats.freeBlockCount = (uint32_t)m_freeBlocks.size();
+	for (const auto& block : m_freeBlocks) {
+		if (block.second > stats.largestFreeBlock)
+			stats.largestFreeBlock = block.second;
+	}
+	return stats;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// How full and how broken up a GeometryAllocator is.
+struct GeometryAllocatorStats
+{
+	uint32_t capacity = 0;
+	uint32_t used = 0;
+	uint32_t allocationCount = 0;
+	uint32_t freeBlockCount = 0;
+	uint32_t largestFreeBlock = 0;
+
+	// Share of the capacity that's allocated.
+	double GetOccupancy() const;
+
+	// Share of the free space that isn't in the largest free block
+	// (0 when it's all in one piece, near 1 when it's all crumbs).
+	double GetFragmentation() const;
+};
+
+// --------------------------------------------------------
+// Hands out ranges of a fixed size buffer (in elements, like
+// vertices or indices), without touching the buffer itself
+//
+// - Free space is kept as a list of blocks sorted by offset.
+//   Allocations take the smallest block they fit in (best
+//   fit), which leaves the big blocks for big meshes.
+// - Freed ranges merge with the free blocks on either side,
+//   so the list never holds two blocks that touch.
+// --------------------------------------------------------
+class GeometryAllocator
+{
+public:
+	static const uint32_t InvalidOffset = 0xFFFFFFFF;
+
+	GeometryAllocator(uint32_t capacity = 0);
+
+	// Forget every allocation and start over with this capacity.
+	void Reset(uint32_t capacity);
+
+	// The offset of a new range of "count" elements, or InvalidOffset if no free block is big enough.
+	uint32_t Allocate(uint32_t count);
+
+	// Give back a range from Allocate.
+	void Free(uint32_t offset);
+
+	uint32_t GetCapacity() const { return m_capacity; }
+	GeometryAllocatorStats GetStats() const;
+
+private:
+	uint32_t m_capacity;
+	uint32_t m_used;
+	std::map<uint32_t, uint32_t> m_freeBlocks;		// Offset -> size
+	std::map<uint32_t, uint32_t> m_allocations;		// Offset -> size
+};
@@ -0,0 +1,95 @@
+#include "GeometryPool.h"
+
+std::vector<std::unique_ptr<GeometryPool>> GeometryPool::s_pools;
+
+// Bytes per index of an index buffer format.
+static unsigned int GetIndexSize(DXGI_FORMAT indexFormat)
+{
+	return (indexFormat == DXGI_FORMAT_R16_UINT) ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+GeometryPool::GeometryPool(ID3D11Device* device, unsigned int vertexStride, DXGI_FORMAT indexFormat, uint32_t vertexCapacity, uint32_t indexCapacity)
+	: m_vertexStride(vertexStride), m_indexFormat(indexFormat), m_vertices(vertexCapacity), m_indices(indexCapacity)
+{
+	// Default usage (not immutable), since meshes are copied in one at a time
+	D3D11_BUFFER_DESC vbd = {};
+	vbd.Usage = D3D11_USAGE_DEFAULT;
+	vbd.ByteWidth = vertexStride * vertexCapacity;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	device->CreateBuffer(&vbd, nullptr, m_vertexBufferPtr.GetAddressOf());
+
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_DEFAULT;
+	ibd.ByteWidth = GetIndexSize(indexFormat) * indexCapacity;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	device->CreateBuffer(&ibd, nullptr, m_indexBufferPtr.GetAddressOf());
+}
+
+GeometryPool* GeometryPool::Add(ID3D11Device* device, const void* vertexData, unsigned int vertexStride, uint32_t vertexCount,
+	const void* indexData, DXGI_FORMAT indexFormat, uint32_t indexCount, GeometryAllocation* out)
+{
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	device->GetImmediateContext(context.GetAddressOf());
+
+	for (std::unique_ptr<GeometryPool>& pool : s_pools) {
+		if (pool->m_vertexStride == vertexStride && pool->m_indexFormat == indexFormat &&
+			pool->TryAdd(context.Get(), vertexData, vertexCount, indexData, indexCount, out))
+			return pool.get();
+	}
+
+	// None had room, so start another (big enough for this, at least)
+	std::unique_ptr<GeometryPool> pool(new GeometryPool(device, vertexStride, indexFormat,
+		vertexCount > DefaultVertexCapacity ? vertexCount : DefaultVertexCapacity,
+		indexCount > DefaultIndexCapacity ? indexCount : DefaultIndexCapacity));
+	if (pool->m_vertexBufferPtr == nullptr || pool->m_indexBufferPtr == nullptr ||
+		!pool->TryAdd(context.Get(), vertexData, vertexCount, indexData, indexCount, out))
+		return nullptr;
+
+	s_pools.push_back(std::move(pool));
+	return s_pools.back().get();
+}
+
+bool GeometryPool::TryAdd(ID3D11DeviceContext* context, const void* vertexData, uint32_t vertexCount, const void* indexData, uint32_t indexCount, GeometryAllocation* out)
+{
+	uint32_t baseVertex = m_vertices.Allocate(vertexCount);
+	if (baseVertex == GeometryAllocator::InvalidOffset)
+		return false;
+	uint32_t firstIndex = m_indices.Allocate(indexCount);
+	if (firstIndex == GeometryAllocator::InvalidOffset) {
+		m_vertices.Free(baseVertex);
+		return false;
+	}
+
+	// Copy it into its ranges of the buffers
+	D3D11_BOX box = { 0, 0, 0, 0, 1, 1 };
+	box.left = baseVertex * m_vertexStride;
+	box.right = (baseVertex + vertexCount) * m_vertexStride;
+	context->UpdateSubresource(m_vertexBufferPtr.Get(), 0, &box, vertexData, 0, 0);
+
+	unsigned int indexSize = GetIndexSize(m_indexFormat);
+	box.left = firstIndex * indexSize;
+	box.right = (firstIndex + indexCount) * indexSize;
+	context->UpdateSubresource(m_indexBufferPtr.Get(), 0, &box, indexData, 0, 0);
+
+	out->baseVertex = baseVertex;
+	out->vertexCount = vertexCount;
+	out->firstIndex = firstIndex;
+	out->indexCount = indexCount;
+	return true;
+}
+
+void GeometryPool::Remove(const GeometryAllocation& allocation)
+{
+	m_vertices.Free(allocation.baseVertex);
+	m_indices.Free(allocation.firstIndex);
+}
+
+size_t GeometryPool::GetPoolCount() { return s_pools.size(); }
+GeometryPool* GeometryPool::GetPool(size_t index) { return s_pools[index].get(); }
+
+ID3D11Buffer* GeometryPool::GetVertexBuffer() { return m_vertexBufferPtr.Get(); }
+ID3D11Buffer* GeometryPool::GetIndexBuffer() { return m_indexBufferPtr.Get(); }
+unsigned int GeometryPool::GetVertexStride() { return m_vertexStride; }
+DXGI_FORMAT GeometryPool::GetIndexFormat() { return m_indexFormat; }
+GeometryAllocatorStats GeometryPool::GetVertexStats() { return m_vertices.GetStats(); }
+GeometryAllocatorStats GeometryPool::GetIndexStats() { return m_indices.GetStats(); }
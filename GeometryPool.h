@@ -0,0 +1,71 @@
+#pragma once
+
+#include "StandardIncludes.h"
+#include <d3d11.h>
+#include <cstdint>
+#include "GeometryAllocator.h"
+
+// Where a mesh's geometry sits in a GeometryPool.
+// - Its indices start at 0 for its own first vertex, so draws pass
+//   baseVertex as the offset to add to each index.
+struct GeometryAllocation
+{
+	uint32_t baseVertex = 0;
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+// --------------------------------------------------------
+// One big vertex buffer and one big index buffer that many
+// meshes' geometry is copied into
+//
+// - Meshes with the same vertex stride and index format share
+//   a pool, so drawing one after another doesn't need the
+//   input assembler's buffers changed in between.
+// - Space is handed out by a GeometryAllocator for each
+//   buffer; a full pool just means a new one is made.
+// - Pools live until the program ends (meshes give their
+//   space back when they're destroyed).
+// --------------------------------------------------------
+class GeometryPool
+{
+public:
+	static const uint32_t DefaultVertexCapacity = 1 << 18;
+	static const uint32_t DefaultIndexCapacity = 1 << 20;
+
+	GeometryPool(ID3D11Device* device, unsigned int vertexStride, DXGI_FORMAT indexFormat, uint32_t vertexCapacity, uint32_t indexCapacity);
+
+	// Copy some geometry into the first pool with room for it (and a
+	// matching layout), making a new pool if none has.
+	// - indexData is in indexFormat (16 or 32 bits per index).
+	// - Returns nullptr if the buffers couldn't be made.
+	static GeometryPool* Add(ID3D11Device* device, const void* vertexData, unsigned int vertexStride, uint32_t vertexCount,
+		const void* indexData, DXGI_FORMAT indexFormat, uint32_t indexCount, GeometryAllocation* out);
+
+	// Give back the space of something Add put in this pool.
+	void Remove(const GeometryAllocation& allocation);
+
+	// Every pool made so far.
+	static size_t GetPoolCount();
+	static GeometryPool* GetPool(size_t index);
+
+	ID3D11Buffer* GetVertexBuffer();
+	ID3D11Buffer* GetIndexBuffer();
+	unsigned int GetVertexStride();
+	DXGI_FORMAT GetIndexFormat();
+	GeometryAllocatorStats GetVertexStats();
+	GeometryAllocatorStats GetIndexStats();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_vertexBufferPtr;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_indexBufferPtr;
+	unsigned int m_vertexStride;
+	DXGI_FORMAT m_indexFormat;
+	GeometryAllocator m_vertices;
+	GeometryAllocator m_indices;
+
+	static std::vector<std::unique_ptr<GeometryPool>> s_pools;
+
+	bool TryAdd(ID3D11DeviceContext* context, const void* vertexData, uint32_t vertexCount, const void* indexData, uint32_t indexCount, GeometryAllocation* out);
+};
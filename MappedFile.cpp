@@ -0,0 +1,46 @@
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const char* pathToFile)
+{
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = nullptr;
+	m_data = nullptr;
+	m_size = 0;
+	m_isOpen = false;
+
+	// Open the file itself (sequential scan hints the cache manager to read ahead).
+	m_file = CreateFileA(pathToFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(m_file, &fileSize))
+		return;
+
+	// An empty file can't be mapped, but it's still a valid (empty) file.
+	m_size = (size_t)fileSize.QuadPart;
+	if (m_size == 0) {
+		m_isOpen = true;
+		return;
+	}
+
+	// Map the whole file, read only.
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+		return;
+
+	m_data = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	m_isOpen = (m_data != nullptr);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr) UnmapViewOfFile(m_data);
+	if (m_mapping != nullptr) CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+
+// Getters
+bool MappedFile::IsOpen() const { return m_isOpen; }
+const char* MappedFile::GetData() const { return m_data; }
+size_t MappedFile::GetSize() const { return m_size; }
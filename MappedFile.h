@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Windows.h>
+
+// --------------------------------------------------------
+// A read-only view of an entire file on disk
+//
+// - The file is memory mapped rather than read, so the OS
+//   pages it in on demand and nothing is copied into our
+//   own buffers.
+// - The view stays valid for the lifetime of this object.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const char* pathToFile);
+	~MappedFile();
+
+	// Not copyable, since it owns the OS handles.
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Getters
+	bool IsOpen() const;
+	const char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const char* m_data;
+	size_t m_size;
+	bool m_isOpen;
+};
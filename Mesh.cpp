@@ -1,192 +1,347 @@
 #include "Mesh.h"
-#include <fstream>
+#include "MeshBuilder.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshPrimitives.h"
+#include "MeshSimplifier.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 
 using namespace DirectX;
 
+bool Mesh::s_reportStats = false;
+uint32_t Mesh::s_buildFlags = MeshBuild_None;
+VertexFormat Mesh::s_fileVertexFormat = VertexFormat_Full;
+LodSettings Mesh::s_lodSettings;
+bool Mesh::s_useGeometryPool = false;
+MeshRetention Mesh::s_retention = MeshRetention_Full;
+std::vector<Mesh*> Mesh::s_meshes;
+ID3D11Buffer* Mesh::s_boundVertexBuffer = nullptr;
+ID3D11Buffer* Mesh::s_boundIndexBuffer = nullptr;
+
+// Just the file name from a path, for printing.
+static const char* GetFileName(const char* path)
+{
+	const char* fileName = path;
+	for (const char* c = path; *c != '\0'; c++) {
+		if (*c == '/' || *c == '\\') fileName = c + 1;
+	}
+	return fileName;
+}
+
+// The build flags meshes are built (and cooked) with
+// - Only the full vertex format starts with a float3 position, so the
+//   packed ones always get a position stream for the depth passes.
+static uint32_t GetEffectiveBuildFlags()
+{
+	uint32_t flags = Mesh::GetBuildFlags();
+	if (Mesh::GetFileVertexFormat() != VertexFormat_Full)
+		flags |= MeshBuild_PositionStream;
+	return flags;
+}
+
+// Bytes a vector has reserved.
+template<typename T>
+static size_t GetCapacityBytes(const std::vector<T>& vector)
+{
+	return vector.capacity() * sizeof(T);
+}
+
+static const char* GetRetentionName(MeshRetention retention)
+{
+	switch (retention) {
+	case MeshRetention_None: return "none";
+	case MeshRetention_Positions: return "positions";
+	default: return "full";
+	}
+}
+
 // Constructor
 Mesh::Mesh(Vertex vertexArray[], unsigned int indexArray[], int numOfVertices, int numOfIndices, ID3D11Device* device) {
 
+	m_name = "(vertex array)";
+	m_vertexFormat = VertexFormat_Full;
+	m_pool = nullptr;
+	m_positionPool = nullptr;
+	m_positionCount = 0;
+	s_meshes.push_back(this);
 	CalculateTangents(&vertexArray[0], numOfVertices, &indexArray[0], numOfIndices);
-	CreateBuffers(&vertexArray[0], &indexArray[0], numOfVertices, numOfIndices, device);
+	CreateBuffers(&vertexArray[0], sizeof(Vertex), &indexArray[0], numOfVertices, numOfIndices, device);
+	m_hullBuilt = false;
+	KeepVertices(&vertexArray[0], numOfVertices);
 }
 
 Mesh::Mesh(const char* pathToFile, ID3D11Device* device) {
 
-	// Set default values.
-	m_numOfIndices = 0;
+	SetDefaults(GetFileName(pathToFile));
 
-	// File input object
-	std::ifstream obj(pathToFile);
+	// The cooked (binary) version of this model, keyed by the model's contents
+	// and the build flags (and level of detail settings).
+	// - If the source model isn't there at all (only cooked files were
+	//   deployed), any cooked file of the current version is used as is
+	std::string cachePath = MeshCache::GetCachePath(pathToFile);
+	uint64_t sourceHash = 0;
+	bool hasSource = MeshCache::HashFile(pathToFile, &sourceHash);
 
-	// Check for successful open
-	if (!obj.is_open())
+	{
+		MeshCacheFile cache(cachePath.c_str());
+		if (cache.IsValid() && (!hasSource || (cache.GetHeader()->sourceHash == sourceHash && MeshCache::MatchesBuild(*cache.GetHeader(), GetEffectiveBuildFlags(), s_lodSettings)))) {
+			const MeshCacheHeader* header = cache.GetHeader();
+			if (s_reportStats) {
+				printf("Mesh: %s - loaded from %s (%u vertices, %u indices, %u levels of detail)\n",
+					GetFileName(pathToFile),
+					GetFileName(cachePath.c_str()),
+					header->vertexCount,
+					header->indexCount,
+					header->lodCount);
+
+				const MeshCacheReadStats& readStats = cache.GetReadStats();
+				if (readStats.compression != StreamCompression_None) {
+					printf("Mesh: %s - %zu KB read in %.2f ms, inflated to %zu KB in %.2f ms\n",
+						GetFileName(cachePath.c_str()),
+						readStats.stream.fileBytes / 1024,
+						readStats.stream.readSeconds * 1000.0,
+						readStats.stream.bytes / 1024,
+						readStats.stream.decompressSeconds * 1000.0);
+				}
+			}
+			if (header->indexCount == 0)
+				return;
+
+			// Upload straight from the mapped (or inflated) file, no parsing needed
+			CreateFileBuffers(pathToFile, cache.GetVertices(), cache.GetIndices(), header->vertexCount, header->indexCount, device);
+			SetLods(cache.GetLods(), header->lodCount);
+			SetMeshlets(cache.GetMeshlets(), header->meshletCount, cache.GetIndices(), device);
+			SetSubmeshes(cache.GetSubmeshes(), header->submeshCount);
+			LoadMaterials(pathToFile, cache.GetMaterialLibraries());
+			if (header->positionCount > 0)
+				CreatePositionBuffers(cache.GetPositions(), cache.GetPositionIndices(), header->positionCount, header->indexCount, device);
+			KeepVertices(cache.GetVertices(), header->vertexCount);
+			return;
+		}
+	}
+
+	if (!hasSource)
 		return;
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;     // Positions from the file
-	std::vector<XMFLOAT3> normals;       // Normals from the file
-	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
-	char chars[100];                     // String for line reading
-
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
+	// Otherwise read the positions, normals, uvs and faces from the file,
+	// weld the face corners into indexed geometry and calculate the tangents
+	MeshGeometry geometry;
+	WeldStats weldStats;
+	if (!MeshBuilder::BuildFromObjFile(pathToFile, geometry, &weldStats))
+		return;
+
+	if (s_reportStats) {
+		printf("Mesh: %s - %zu corners welded into %zu vertices (reuse %.2fx, %zu KB -> %zu KB)\n",
+			GetFileName(pathToFile),
+			weldStats.cornerCount,
+			weldStats.vertexCount,
+			weldStats.GetReuseRatio(),
+			weldStats.cornerCount * sizeof(Vertex) / 1024,
+			weldStats.vertexCount * sizeof(Vertex) / 1024);
+	}
+
+	if (s_reportStats && !geometry.submeshes.empty()) {
+		printf("Mesh: %s - %zu materials:", GetFileName(pathToFile), geometry.submeshes.size());
+		for (const MeshSubmesh& submesh : geometry.submeshes)
+			printf(" %s (%u tris)", submesh.material, submesh.indexCount / 3);
+		printf("\n");
+	}
+
+	// Nothing to draw?
+	if (geometry.indices.empty())
+		return;
+
+	BuildGeometry(geometry);
+
+	// Cook it so the next load can skip all of that
+	MeshCache::Write(cachePath.c_str(), sourceHash, GetEffectiveBuildFlags(), s_lodSettings, geometry);
+
+	CreateGeometryBuffers(geometry, device);
+	LoadMaterials(pathToFile, geometry.materialLibraries);
+}
+
+Mesh::Mesh(const PrimitiveSettings& settings, ID3D11Device* device) {
+
+	SetDefaults(MeshPrimitives::GetName(settings).c_str());
+
+	LARGE_INTEGER frequency, start, stop;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+	MeshGeometry geometry;
+	MeshPrimitives::Build(settings, geometry);
+	QueryPerformanceCounter(&stop);
+
+	if (s_reportStats) {
+		printf("Mesh: %s - built in %.1f us (%zu vertices, %zu triangles)\n",
+			m_name.c_str(),
+			(double)(stop.QuadPart - start.QuadPart) * 1000000.0 / (double)frequency.QuadPart,
+			geometry.vertices.size(),
+			geometry.indices.size() / 3);
+	}
+
+	if (geometry.indices.empty())
+		return;
+
+	// Nothing is cooked, since building it again is quicker than reading a file
+	BuildGeometry(geometry);
+	LocalBounds bounds = MeshPrimitives::GetBounds(settings);
+	CreateGeometryBuffers(geometry, device, &bounds);
+}
+
+// What a mesh is until it has geometry (a file that can't be loaded leaves it like this).
+void Mesh::SetDefaults(const char* name) {
+
+	m_name = name;
+	m_numOfIndices = 0;
+	m_vertexCount = 0;
+	m_retention = s_retention;
+	m_pool = nullptr;
+	m_positionPool = nullptr;
+	m_positionCount = 0;
+	s_meshes.push_back(this);
+	m_indexFormat = DXGI_FORMAT_R32_UINT;
+	m_vertexFormat = VertexFormat_Full;
+	m_vertexStride = sizeof(Vertex);
+	m_lods.assign(1, MeshLod{ 0, 0, 0.0f });
+	m_hullBuilt = false;
+}
+
+// The optional steps of the build flags, after a model is welded (or a primitive built)
+void Mesh::BuildGeometry(MeshGeometry& geometry) {
+
+	// Simplify it into levels of detail, if asked to
+	if (s_buildFlags & MeshBuild_Lods) {
+		MeshSimplifier::BuildLodChain(geometry, s_lodSettings);
+
+		if (s_reportStats) {
+			printf("Mesh: %s - %zu levels of detail:", m_name.c_str(), geometry.lods.size());
+			for (const MeshLod& lod : geometry.lods)
+				printf(" %u tris (error %g)", lod.indexCount / 3, lod.error);
+			printf("\n");
 		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
+	}
+
+	// Reorder it for the GPU, if asked to
+	if (s_buildFlags & MeshBuild_Optimize) {
+		MeshOptimizeStats optimizeStats;
+		MeshOptimizer::Optimize(geometry, &optimizeStats);
+
+		if (s_reportStats) {
+			printf("Mesh: %s - optimized in %.2f ms (ACMR %.3f -> %.3f, ATVR %.3f -> %.3f)\n",
+				m_name.c_str(),
+				optimizeStats.seconds * 1000.0,
+				optimizeStats.before.GetACMR(),
+				optimizeStats.after.GetACMR(),
+				optimizeStats.before.GetATVR(),
+				optimizeStats.after.GetATVR());
 		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
+	}
+
+	// Split the full detail level into meshlets, if asked to
+	if (s_buildFlags & MeshBuild_Meshlets) {
+		size_t fullCount = geometry.lods.empty() ? geometry.indices.size() : geometry.lods[0].indexCount;
+		MeshBuilder::BuildMeshlets(geometry);
+
+		if (s_reportStats) {
+			printf("Mesh: %s - %zu meshlets (%.1f triangles each)\n",
+				m_name.c_str(),
+				geometry.meshlets.size(),
+				geometry.meshlets.empty() ? 0.0 : (double)fullCount / 3 / geometry.meshlets.size());
 		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			//  If the model is missing any of these, this 
-			//  code will not handle the file correctly!
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-
-			// Add three more indices
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-
-			// Was there a 4th face?
-			if (facesRead == 12)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-
-				// Add three more indices
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-			}
+	}
+
+	// Weld a position only stream for depth passes, if asked to (or the vertices are packed)
+	if (GetEffectiveBuildFlags() & MeshBuild_PositionStream) {
+		WeldStats positionStats;
+		MeshBuilder::BuildPositionStream(geometry, &positionStats);
+
+		if (s_reportStats) {
+			printf("Mesh: %s - %zu vertices share %zu positions (%zu KB -> %zu KB for depth passes)\n",
+				m_name.c_str(),
+				positionStats.cornerCount,
+				positionStats.vertexCount,
+				positionStats.cornerCount * sizeof(Vertex) / 1024,
+				positionStats.vertexCount * sizeof(XMFLOAT3) / 1024);
 		}
 	}
+}
+
+// Creates the buffers of built geometry, and keeps what the retention setting asks for
+// - bounds (if given) are used instead of working them out from the vertices.
+void Mesh::CreateGeometryBuffers(const MeshGeometry& geometry, ID3D11Device* device, const LocalBounds* bounds) {
+
+	CreateFileBuffers(m_name.c_str(), &geometry.vertices[0], &geometry.indices[0], (int)geometry.vertices.size(), (int)geometry.indices.size(), device);
+	if (!geometry.lods.empty())
+		SetLods(&geometry.lods[0], (int)geometry.lods.size());
+	if (!geometry.meshlets.empty())
+		SetMeshlets(&geometry.meshlets[0], (int)geometry.meshlets.size(), &geometry.indices[0], device);
+	if (!geometry.submeshes.empty())
+		SetSubmeshes(&geometry.submeshes[0], (int)geometry.submeshes.size());
+	if (!geometry.positions.empty())
+		CreatePositionBuffers(&geometry.positions[0], &geometry.positionIndices[0], (int)geometry.positions.size(), (int)geometry.positionIndices.size(), device);
+	KeepVertices(&geometry.vertices[0], (int)geometry.vertices.size(), bounds);
+}
 
-	// Close the file and create the actual buffers
-	obj.close();
-	CalculateTangents(&verts[0], vertCounter, &indices[0], vertCounter);
-	CreateBuffers(&verts[0], &indices[0], vertCounter, vertCounter, device);
+// Packs the vertices into the file vertex format (if it isn't the full one) and creates the buffers.
+void Mesh::CreateFileBuffers(const char* pathToFile, const Vertex vertexArray[], const unsigned int indexArray[], int numOfVertices, int numOfIndices, ID3D11Device* device) {
+
+	m_vertexFormat = s_fileVertexFormat;
+	if (m_vertexFormat == VertexFormat_Full) {
+		CreateBuffers(vertexArray, sizeof(Vertex), indexArray, numOfVertices, numOfIndices, device);
+		return;
+	}
 
-	m_verts = verts;
+	std::vector<unsigned char> packed;
+	VertexPackError error;
+	VertexPacker::PackAs(m_vertexFormat, vertexArray, numOfVertices, packed, &m_positionQuantization, &error);
+
+	if (s_reportStats) {
+		printf("Mesh: %s - packed %zu KB -> %zu KB (max error: normal %.4f deg, tangent %.4f deg, position %g, uv %g)\n",
+			GetFileName(pathToFile),
+			numOfVertices * sizeof(Vertex) / 1024,
+			packed.size() / 1024,
+			error.normalDegrees,
+			error.tangentDegrees,
+			error.position,
+			error.uv);
+	}
+
+	CreateBuffers(packed.data(), VertexPacker::GetStride(m_vertexFormat), indexArray, numOfVertices, numOfIndices, device);
 }
 
-void Mesh::CreateBuffers(Vertex vertexArray[], unsigned int indexArray[], int numOfVertices, int numOfIndices, ID3D11Device* device) {
+void Mesh::CreateBuffers(const void* vertexData, unsigned int vertexStride, const unsigned int indexArray[], int numOfVertices, int numOfIndices, ID3D11Device* device) {
 
 	m_numOfIndices = numOfIndices;
+	m_vertexStride = vertexStride;
+	m_lods.assign(1, MeshLod{ 0, (uint32_t)numOfIndices, 0.0f });
+
+	// Use 16 bit indices whenever every vertex can be reached with one
+	// - Half the memory (and bandwidth) of 32 bit ones
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = indexArray;
+	UINT indexSize = sizeof(unsigned int);
+	m_indexFormat = DXGI_FORMAT_R32_UINT;
+	if (numOfVertices <= 0x10000) {
+		shortIndices.assign(indexArray, indexArray + numOfIndices);
+		indexData = shortIndices.data();
+		indexSize = sizeof(uint16_t);
+		m_indexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
+	// Share a pool's buffers, if asked to (own ones if that fails)
+	if (s_useGeometryPool) {
+		m_pool = GeometryPool::Add(device, vertexData, vertexStride, numOfVertices, indexData, m_indexFormat, numOfIndices, &m_poolAllocation);
+		if (m_pool != nullptr)
+			return;
+	}
 
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numOfVertices;       // 3 = number of vertices in the buffer
+	vbd.ByteWidth = vertexStride * numOfVertices;       // 3 = number of vertices in the buffer
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells DirectX this is a vertex buffer
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
@@ -195,7 +350,7 @@ void Mesh::CreateBuffers(Vertex vertexArray[], unsigned int indexArray[], int nu
 	// Create the proper struct to hold the initial vertex data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertexArray;
+	initialVertexData.pSysMem = vertexData;
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
@@ -206,7 +361,7 @@ void Mesh::CreateBuffers(Vertex vertexArray[], unsigned int indexArray[], int nu
 	//    it to create the buffer.  The description is then useless.
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numOfIndices;	// 3 = number of indices in the buffer
+	ibd.ByteWidth = indexSize * numOfIndices;	// 3 = number of indices in the buffer
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells DirectX this is an index buffer
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
@@ -215,95 +370,163 @@ void Mesh::CreateBuffers(Vertex vertexArray[], unsigned int indexArray[], int nu
 	// Create the proper struct to hold the initial index data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indexArray;
+	initialIndexData.pSysMem = indexData;
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
 	device->CreateBuffer(&ibd, &initialIndexData, m_indexBufferPtr.GetAddressOf());
 }
 
-// Calculates the tangents of the vertices in a mesh
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
-//
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
-{
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+// Replaces the single full detail level CreateBuffers made with a chain of them
+void Mesh::SetLods(const MeshLod lods[], int lodCount) {
+
+	if (lodCount < 1)
+		return;
+
+	m_lods.assign(lods, lods + lodCount);
+	m_numOfIndices = m_lods[0].indexCount;
+}
+
+// Keeps the meshlets (and the indices they point into) for culling, and makes
+// a dynamic index buffer big enough for all of them
+void Mesh::SetMeshlets(const Meshlet meshlets[], int meshletCount, const unsigned int indexArray[], ID3D11Device* device) {
+
+	if (meshletCount < 1)
+		return;
+
+	m_meshlets.assign(meshlets, meshlets + meshletCount);
+	m_meshletIndices.assign(indexArray + m_lods[0].indexOffset, indexArray + m_lods[0].indexOffset + m_lods[0].indexCount);
+	m_culledIndices.reserve(m_meshletIndices.size());
+
+	D3D11_BUFFER_DESC ibd;
+	ibd.Usage = D3D11_USAGE_DYNAMIC;
+	ibd.ByteWidth = (m_indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(unsigned int)) * (UINT)m_meshletIndices.size();
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;	// Rewritten every time it's culled
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+	device->CreateBuffer(&ibd, nullptr, m_culledIndexBufferPtr.GetAddressOf());
+}
+
+// Keeps the material ranges of every level, and works out which meshlets
+// belong to which (they never cross from one submesh into another)
+void Mesh::SetSubmeshes(const MeshSubmesh submeshes[], int submeshCount) {
+
+	if (submeshCount < 1)
+		return;
+
+	m_submeshes.assign(submeshes, submeshes + submeshCount);
+	unsigned int perLevel = GetSubmeshCount();
+	m_culledSubmeshes.assign(m_submeshes.begin(), m_submeshes.begin() + perLevel);
+	for (MeshSubmesh& culled : m_culledSubmeshes)
+		culled.indexOffset = culled.indexCount = 0;
+
+	m_submeshMeshlets.assign(perLevel + 1, (uint32_t)m_meshlets.size());
+	uint32_t meshlet = 0;
+	for (unsigned int i = 0; i < perLevel; i++) {
+		while (meshlet < m_meshlets.size() && m_meshlets[meshlet].indexOffset < m_submeshes[i].indexOffset)
+			meshlet++;
+		m_submeshMeshlets[i] = meshlet;
 	}
+}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+// Reads the model's MTL files for the materials its submeshes use
+// - Matched by their "usemtl" names, which only keep as much as fits in a MeshSubmesh
+void Mesh::LoadMaterials(const char* pathToFile, const std::vector<std::string>& libraries) {
+
+	if (m_submeshes.empty() || libraries.empty())
+		return;
+
+	std::vector<ObjMaterial> materials;
+	if (!ObjParser::ParseMaterialLibraries(pathToFile, libraries, materials) && s_reportStats)
+		printf("Mesh: %s - not every material library could be opened\n", m_name.c_str());
+
+	unsigned int perLevel = GetSubmeshCount();
+	m_submeshMaterials.assign(perLevel, ObjMaterial());
+	for (unsigned int i = 0; i < perLevel; i++) {
+		const MeshSubmesh& submesh = m_submeshes[i];
+		for (const ObjMaterial& material : materials) {
+			if (material.name.compare(0, sizeof(submesh.material) - 1, submesh.material) == 0) {
+				m_submeshMaterials[i] = material;
+				break;
+			}
+		}
 	}
+}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+// Makes the buffers of the position stream (in a pool of its own stride, if pooling)
+// - Its indices line up with the full ones, so the levels of detail
+//   and meshlets' ranges are the same in both.
+void Mesh::CreatePositionBuffers(const XMFLOAT3 positions[], const unsigned int indexArray[], int numOfPositions, int numOfIndices, ID3D11Device* device) {
+
+	m_positionCount = numOfPositions;
+
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = indexArray;
+	UINT indexSize = sizeof(unsigned int);
+	m_positionIndexFormat = DXGI_FORMAT_R32_UINT;
+	if (numOfPositions <= 0x10000) {
+		shortIndices.assign(indexArray, indexArray + numOfIndices);
+		indexData = shortIndices.data();
+		indexSize = sizeof(uint16_t);
+		m_positionIndexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
+	if (s_useGeometryPool) {
+		m_positionPool = GeometryPool::Add(device, positions, sizeof(XMFLOAT3), numOfPositions, indexData, m_positionIndexFormat, numOfIndices, &m_positionPoolAllocation);
+		if (m_positionPool != nullptr)
+			return;
+	}
 
-		// Use Gram-Schmidt orthogonalize
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
+	D3D11_BUFFER_DESC vbd = {};
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = sizeof(XMFLOAT3) * numOfPositions;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialVertexData = {};
+	initialVertexData.pSysMem = positions;
+	device->CreateBuffer(&vbd, &initialVertexData, m_positionBufferPtr.GetAddressOf());
 
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = indexSize * numOfIndices;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialIndexData = {};
+	initialIndexData.pSysMem = indexData;
+	device->CreateBuffer(&ibd, &initialIndexData, m_positionIndexBufferPtr.GetAddressOf());
+}
+
+// Works out the bounds of the vertices (unless they're known already), then keeps as much of them on the
+// CPU as the retention setting asks for (copies, since the array they're
+// in is a temporary or a mapped file)
+void Mesh::KeepVertices(const Vertex vertexArray[], int numOfVertices, const LocalBounds* bounds) {
+
+	m_vertexCount = numOfVertices;
+	m_retention = s_retention;
+	m_bounds = bounds ? *bounds : MeshBounds::Calculate(vertexArray, numOfVertices);
+
+	switch (m_retention) {
+	case MeshRetention_Full:
+		m_verts.assign(vertexArray, vertexArray + numOfVertices);
+		VertexTransform::BuildStreams(vertexArray, numOfVertices, &m_positions, &m_normals);
+		break;
+	case MeshRetention_Positions:
+		VertexTransform::BuildStreams(vertexArray, numOfVertices, &m_positions);
+		break;
+	case MeshRetention_None:
+		break;
 	}
 }
 
+// Calculates the tangents of the vertices in a mesh
+// - See MeshBuilder::CalculateTangents, which doesn't need a Mesh (or D3D) to run
+//
+// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+//
+void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	MeshBuilder::CalculateTangents(verts, numVerts, indices, numIndices);
+}
+
 void Mesh::Draw(ID3D11DeviceContext* context)
 {
 	// Set buffers in the input assembler
@@ -312,10 +535,7 @@ void Mesh::Draw(ID3D11DeviceContext* context)
 	//  - for this demo, this step *could* simply be done once during Init(),
 	//    but I'm doing it here because it's often done multiple times per frame
 	//    in a larger application/game
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, m_vertexBufferPtr.GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(m_indexBufferPtr.Get(), DXGI_FORMAT_R32_UINT, 0);
+	Bind(context);
 
 
 	// Finally do the actual drawing
@@ -325,18 +545,228 @@ void Mesh::Draw(ID3D11DeviceContext* context)
 	//     vertices in the currently set VERTEX BUFFER
 	context->DrawIndexed(
 		m_numOfIndices,     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+		GetFirstIndex(),     // Offset to the first index we want to use
+		GetBaseVertex());    // Offset to add to each index when looking up vertices
+}
+
+void Mesh::Bind(ID3D11DeviceContext* context, bool culledIndices)
+{
+	ID3D11Buffer* vertexBuffer = m_pool ? m_pool->GetVertexBuffer() : m_vertexBufferPtr.Get();
+	ID3D11Buffer* indexBuffer = culledIndices ? m_culledIndexBufferPtr.Get() : m_pool ? m_pool->GetIndexBuffer() : m_indexBufferPtr.Get();
+	BindBuffers(context, vertexBuffer, m_vertexStride, indexBuffer, m_indexFormat);
+}
+
+void Mesh::DrawPositions(ID3D11DeviceContext* context)
+{
+	// The full vertices start with the position too, so they do without a stream
+	// - Packed ones don't, and are only without one if a cooked file was deployed
+	//   without it, so they're left out rather than drawn with the wrong layout.
+	if (m_positionCount == 0) {
+		if (m_vertexFormat == VertexFormat_Full)
+			Draw(context);
+		return;
+	}
+
+	ID3D11Buffer* vertexBuffer = m_positionPool ? m_positionPool->GetVertexBuffer() : m_positionBufferPtr.Get();
+	ID3D11Buffer* indexBuffer = m_positionPool ? m_positionPool->GetIndexBuffer() : m_positionIndexBufferPtr.Get();
+	BindBuffers(context, vertexBuffer, sizeof(XMFLOAT3), indexBuffer, m_positionIndexFormat);
+
+	context->DrawIndexed(
+		m_numOfIndices,
+		m_positionPool ? m_positionPoolAllocation.firstIndex : 0,
+		m_positionPool ? m_positionPoolAllocation.baseVertex : 0);
 }
 
+void Mesh::BindBuffers(ID3D11DeviceContext* context, ID3D11Buffer* vertexBuffer, unsigned int vertexStride, ID3D11Buffer* indexBuffer, DXGI_FORMAT indexFormat)
+{
+	// A buffer only ever has one stride or format, so the buffer alone says what's set
+	if (vertexBuffer != s_boundVertexBuffer) {
+		UINT stride = vertexStride;
+		UINT offset = 0;
+		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+		s_boundVertexBuffer = vertexBuffer;
+	}
+	if (indexBuffer != s_boundIndexBuffer) {
+		context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
+		s_boundIndexBuffer = indexBuffer;
+	}
+}
 
-// Destructor (use of smart pointers makes this empty).
-Mesh::~Mesh(){}
+void Mesh::ResetBinding()
+{
+	s_boundVertexBuffer = nullptr;
+	s_boundIndexBuffer = nullptr;
+}
+
+unsigned int Mesh::SelectLod(float distance, float worldScale, float pixelsPerUnit, float maxPixelError)
+{
+	return MeshSimplifier::SelectLod(m_lods.data(), m_lods.size(), distance, worldScale, pixelsPerUnit, maxPixelError);
+}
+
+unsigned int Mesh::CullMeshlets(ID3D11DeviceContext* context, XMFLOAT4X4 worldMatrix, XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projMatrix, XMFLOAT3 cameraPosition, MeshletCullStats* stats)
+{
+	if (m_meshlets.empty() || m_culledIndexBufferPtr == nullptr)
+		return 0;
+
+	// Culling happens in model space, so take the camera there
+	XMMATRIX world = XMLoadFloat4x4(&worldMatrix);
+	XMFLOAT4X4 worldViewProj;
+	XMStoreFloat4x4(&worldViewProj, world * XMLoadFloat4x4(&viewMatrix) * XMLoadFloat4x4(&projMatrix));
+	XMFLOAT3 localCamera;
+	XMStoreFloat3(&localCamera, XMVector3Transform(XMLoadFloat3(&cameraPosition), XMMatrixInverse(nullptr, world)));
+
+	m_culledIndices.clear();
+	if (m_submeshes.empty()) {
+		MeshletBuilder::Cull(m_meshlets.data(), m_meshlets.size(), m_meshletIndices.data(), worldViewProj, localCamera, m_culledIndices, stats);
+	}
+	else {
+		// One submesh at a time, so each one's survivors stay together
+		MeshletCullStats total;
+		for (size_t i = 0; i < m_culledSubmeshes.size(); i++) {
+			MeshletCullStats submeshStats;
+			m_culledSubmeshes[i].indexOffset = (uint32_t)m_culledIndices.size();
+			MeshletBuilder::Cull(m_meshlets.data() + m_submeshMeshlets[i], m_submeshMeshlets[i + 1] - m_submeshMeshlets[i], m_meshletIndices.data(),
+				worldViewProj, localCamera, m_culledIndices, &submeshStats);
+			m_culledSubmeshes[i].indexCount = (uint32_t)m_culledIndices.size() - m_culledSubmeshes[i].indexOffset;
+
+			total.meshletCount += submeshStats.meshletCount;
+			total.triangleCount += submeshStats.triangleCount;
+			total.visibleMeshlets += submeshStats.visibleMeshlets;
+			total.visibleTriangles += submeshStats.visibleTriangles;
+			total.backfaceMeshlets += submeshStats.backfaceMeshlets;
+			total.frustumMeshlets += submeshStats.frustumMeshlets;
+			total.backfaceTriangles += submeshStats.backfaceTriangles;
+			total.frustumTriangles += submeshStats.frustumTriangles;
+		}
+		if (stats != nullptr) *stats = total;
+	}
+	if (m_culledIndices.empty())
+		return 0;
+
+	// Upload what's left (the meshlets point into the full detail indices,
+	// which start at 0 in the culled buffer too)
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(m_culledIndexBufferPtr.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return 0;
+	if (m_indexFormat == DXGI_FORMAT_R16_UINT) {
+		uint16_t* shortIndices = (uint16_t*)mapped.pData;
+		for (size_t i = 0; i < m_culledIndices.size(); i++)
+			shortIndices[i] = (uint16_t)m_culledIndices[i];
+	}
+	else {
+		memcpy(mapped.pData, m_culledIndices.data(), m_culledIndices.size() * sizeof(unsigned int));
+	}
+	context->Unmap(m_culledIndexBufferPtr.Get(), 0);
+
+	return (unsigned int)m_culledIndices.size();
+}
+
+
+// Destructor (use of smart pointers makes this almost empty).
+Mesh::~Mesh(){
+	if (m_pool != nullptr)
+		m_pool->Remove(m_poolAllocation);
+	if (m_positionPool != nullptr)
+		m_positionPool->Remove(m_positionPoolAllocation);
+	s_meshes.erase(std::remove(s_meshes.begin(), s_meshes.end(), this), s_meshes.end());
+}
 
 // Getters and Setters
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer(){ return m_vertexBufferPtr; }
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer(){ return m_indexBufferPtr; }
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer(){ return m_pool ? m_pool->GetVertexBuffer() : m_vertexBufferPtr; }
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer(){ return m_pool ? m_pool->GetIndexBuffer() : m_indexBufferPtr; }
+GeometryPool* Mesh::GetGeometryPool(){ return m_pool; }
+unsigned int Mesh::GetBaseVertex(){ return m_pool ? m_poolAllocation.baseVertex : 0; }
+unsigned int Mesh::GetFirstIndex(){ return m_pool ? m_poolAllocation.firstIndex : 0; }
+DXGI_FORMAT Mesh::GetIndexFormat(){ return m_indexFormat; }
+VertexFormat Mesh::GetVertexFormat(){ return m_vertexFormat; }
+unsigned int Mesh::GetVertexStride(){ return m_vertexStride; }
+PositionQuantization Mesh::GetPositionQuantization(){ return m_positionQuantization; }
 int Mesh::GetIndexCount(){ return m_numOfIndices; }
+unsigned int Mesh::GetLodCount(){ return (unsigned int)m_lods.size(); }
+MeshLod Mesh::GetLod(unsigned int level){ return m_lods[level < m_lods.size() ? level : m_lods.size() - 1]; }
+unsigned int Mesh::GetSubmeshCount(){ return m_submeshes.empty() ? 1 : (unsigned int)(m_submeshes.size() / m_lods.size()); }
+MeshSubmesh Mesh::GetSubmesh(unsigned int level, unsigned int submesh)
+{
+	level = level < m_lods.size() ? level : (unsigned int)m_lods.size() - 1;
+	if (!m_submeshes.empty())
+		return m_submeshes[level * GetSubmeshCount() + submesh];
+
+	// The whole level, without a material
+	MeshSubmesh whole = {};
+	whole.indexOffset = m_lods[level].indexOffset;
+	whole.indexCount = m_lods[level].indexCount;
+	return whole;
+}
+MeshSubmesh Mesh::GetCulledSubmesh(unsigned int submesh)
+{
+	if (!m_culledSubmeshes.empty())
+		return m_culledSubmeshes[submesh];
+
+	MeshSubmesh whole = {};
+	whole.indexCount = (uint32_t)m_culledIndices.size();
+	return whole;
+}
+const ObjMaterial* Mesh::GetSubmeshMaterial(unsigned int submesh)
+{
+	if (submesh >= m_submeshMaterials.size() || m_submeshMaterials[submesh].name.empty())
+		return nullptr;
+	return &m_submeshMaterials[submesh];
+}
+BoundingBox Mesh::GetBoundingBox(){ return BoundingBox(m_bounds.boxCenter, m_bounds.boxExtents); }
+BoundingSphere Mesh::GetBoundingSphere(){ return BoundingSphere(m_bounds.sphereCenter, m_bounds.sphereRadius); }
+size_t Mesh::GetVertexCount() const { return m_vertexCount; }
+MeshRetention Mesh::GetRetention(){ return m_retention; }
+unsigned int Mesh::GetMeshletCount(){ return (unsigned int)m_meshlets.size(); }
+bool Mesh::HasPositionStream(){ return m_positionCount > 0; }
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetCulledIndexBuffer(){ return m_culledIndexBufferPtr; }
+
+void Mesh::SetReportStats(bool report) { s_reportStats = report; }
+void Mesh::SetBuildFlags(uint32_t flags) { s_buildFlags = flags; }
+uint32_t Mesh::GetBuildFlags() { return s_buildFlags; }
+void Mesh::SetFileVertexFormat(VertexFormat format) { s_fileVertexFormat = format; }
+VertexFormat Mesh::GetFileVertexFormat() { return s_fileVertexFormat; }
+void Mesh::SetLodSettings(const LodSettings& settings) { s_lodSettings = settings; }
+LodSettings Mesh::GetLodSettings() { return s_lodSettings; }
+void Mesh::SetUseGeometryPool(bool use) { s_useGeometryPool = use; }
+bool Mesh::GetUseGeometryPool() { return s_useGeometryPool; }
+void Mesh::SetDefaultRetention(MeshRetention retention) { s_retention = retention; }
+MeshRetention Mesh::GetDefaultRetention() { return s_retention; }
+
+size_t Mesh::GetResidentBytes()
+{
+	return sizeof(Mesh) +
+		GetCapacityBytes(m_verts) +
+		GetCapacityBytes(m_vertsWorldSpace) +
+		GetCapacityBytes(m_positions.x) + GetCapacityBytes(m_positions.y) + GetCapacityBytes(m_positions.z) +
+		GetCapacityBytes(m_normals.x) + GetCapacityBytes(m_normals.y) + GetCapacityBytes(m_normals.z) +
+		GetCapacityBytes(m_hull) +
+		GetCapacityBytes(m_lods) +
+		GetCapacityBytes(m_submeshes) +
+		GetCapacityBytes(m_submeshMeshlets) +
+		GetCapacityBytes(m_culledSubmeshes) +
+		GetCapacityBytes(m_submeshMaterials) +
+		GetCapacityBytes(m_meshlets) +
+		GetCapacityBytes(m_meshletIndices) +
+		GetCapacityBytes(m_culledIndices);
+}
+
+void Mesh::ReportResidentMemory()
+{
+	if (!s_reportStats)
+		return;
+
+	size_t total = 0;
+	for (Mesh* mesh : s_meshes) {
+		size_t bytes = mesh->GetResidentBytes();
+		total += bytes;
+		printf("Mesh: %s - %.1f KB resident on the CPU (%u vertices, keeps %s)\n",
+			mesh->m_name.c_str(),
+			bytes / 1024.0,
+			mesh->m_vertexCount,
+			GetRetentionName(mesh->m_retention));
+	}
+	printf("Mesh: %zu meshes - %.1f KB resident on the CPU in total\n", s_meshes.size(), total / 1024.0);
+}
 
 std::vector<Vertex>* Mesh::GetVerticesWorldSpace(DirectX::XMFLOAT4X4 worldMatrix)
 {
@@ -347,4 +777,36 @@ std::vector<Vertex>* Mesh::GetVerticesWorldSpace(DirectX::XMFLOAT4X4 worldMatrix
 		m_vertsWorldSpace.push_back(newVert);
 	}
 	return &m_vertsWorldSpace;
-}
\ No newline at end of file
+}
+
+void Mesh::TransformPositions(const XMFLOAT4X4& worldMatrix, VertexStreamTarget out, unsigned int threadCount) const
+{
+	VertexTransform::TransformPositions(m_positions, worldMatrix, out, threadCount);
+}
+
+void Mesh::TransformNormals(const XMFLOAT4X4& normalMatrix, VertexStreamTarget out, unsigned int threadCount) const
+{
+	VertexTransform::TransformNormals(m_normals, normalMatrix, out, threadCount);
+}
+
+BoundingBox Mesh::GetWorldBoundingBox(DirectX::XMFLOAT4X4 worldMatrix, bool exactHull)
+{
+	BoundingBox box;
+	if (!exactHull) {
+		MeshBounds::TransformBox(m_bounds.boxCenter, m_bounds.boxExtents, worldMatrix, &box.Center, &box.Extents);
+		return box;
+	}
+
+	// Only the local box is left once the vertices are dropped
+	if (m_retention == MeshRetention_None) {
+		MeshBounds::TransformBox(m_bounds.boxCenter, m_bounds.boxExtents, worldMatrix, &box.Center, &box.Extents);
+		return box;
+	}
+
+	if (!m_hullBuilt) {
+		MeshBounds::BuildConvexHull(m_positions.x.data(), m_positions.y.data(), m_positions.z.data(), m_positions.GetCount(), m_hull);
+		m_hullBuilt = true;
+	}
+	MeshBounds::TransformPointsBox(m_hull.data(), m_hull.size(), worldMatrix, &box.Center, &box.Extents);
+	return box;
+}
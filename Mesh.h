@@ -4,6 +4,22 @@
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include <d3d11.h>
 #include "Vertex.h"
+#include "VertexPacker.h"
+#include "MeshBuilder.h"
+#include "MeshBounds.h"
+#include "MeshPrimitives.h"
+#include "VertexTransform.h"
+#include "GeometryPool.h"
+#include <cstdint>
+#include <string>
+
+// What a mesh keeps on the CPU once its buffers are made.
+enum MeshRetention
+{
+	MeshRetention_None,			// Just the bounds (exact hull boxes fall back to the local box)
+	MeshRetention_Positions,	// Positions as streams, for collision (TransformPositions and exact hull boxes)
+	MeshRetention_Full,			// Every vertex too (GetVerticesWorldSpace and TransformNormals)
+};
 
 
 
@@ -13,28 +29,171 @@ public:
 
 	// Constructor
 	Mesh(Vertex vertexArray[], unsigned int indexArray[], int numOfVertices, int numOfIndices, ID3D11Device* device);
-	Mesh(const char* pathToFile, ID3D11Device* device);
+	Mesh(const char* pathToFile, ID3D11Device* device);	// An OBJ, which (like its cooked file) may be gzip compressed
+	Mesh(const PrimitiveSettings& settings, ID3D11Device* device);	// Built in memory (see MeshPrimitives), no file needed
 
 	// Destructor
 	~Mesh();
 
 	// Getters
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();	// The pool's buffers if it's in one
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
-	int GetIndexCount();
+	GeometryPool* GetGeometryPool();	// nullptr if it has its own buffers
+	unsigned int GetBaseVertex();		// Where its vertices and indices start in the buffers
+	unsigned int GetFirstIndex();
+	DXGI_FORMAT GetIndexFormat();
+	int GetIndexCount();		// Of the full detail level
+	VertexFormat GetVertexFormat();
+	unsigned int GetVertexStride();
+	PositionQuantization GetPositionQuantization();	// Only used by VertexFormat_Quantized
+	unsigned int GetLodCount();		// Always at least 1 (the full detail level)
+	MeshLod GetLod(unsigned int level);
+	unsigned int GetSubmeshCount();		// Per level of detail; always at least 1 (the whole level, if the model has no materials)
+	MeshSubmesh GetSubmesh(unsigned int level, unsigned int submesh);
+	MeshSubmesh GetCulledSubmesh(unsigned int submesh);	// Its range of the culled index buffer, as of the last CullMeshlets
+	const ObjMaterial* GetSubmeshMaterial(unsigned int submesh);	// From the model's MTL files (nullptr if they don't have it)
+	DirectX::BoundingBox GetBoundingBox();			// Local space bounds, worked out at load
+	DirectX::BoundingSphere GetBoundingSphere();
+	size_t GetVertexCount() const;
+	MeshRetention GetRetention();
+	size_t GetResidentBytes();		// Everything the mesh keeps on the CPU
+	unsigned int GetMeshletCount();		// 0 unless loaded with MeshBuild_Meshlets
+	bool HasPositionStream();			// false unless loaded with MeshBuild_PositionStream or a packed vertex format
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetCulledIndexBuffer();
 
 	// Functions
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indicies, int numIndices);
 	void Draw(ID3D11DeviceContext* context);
-	std::vector<Vertex>* GetVerticesWorldSpace(DirectX::XMFLOAT4X4 worldMatrix);
+
+	// Set the mesh's buffers (or the culled index buffer) in the input assembler,
+	// unless they're set already (as they are for every mesh in the same pool).
+	// - Draws then offset by GetFirstIndex() and GetBaseVertex().
+	void Bind(ID3D11DeviceContext* context, bool culledIndices = false);
+
+	// Draw the full detail level for a depth only pass (vertex shaders taking
+	// VertexShaderInputPosition), from the position stream if there is one
+	// (there always is for the packed vertex formats).
+	// - Welded by position alone, so far fewer vertices (of 12 bytes, not
+	//   a full vertex) are fetched and transformed than Draw would.
+	void DrawPositions(ID3D11DeviceContext* context);
+
+	// Forget what Bind last set, for when something else may have changed it.
+	static void ResetBinding();
+
+	// The coarsest level of detail that stays within maxPixelError pixels of the full one.
+	// - distance is from the camera, pixelsPerUnit from MeshSimplifier::GetPixelsPerUnit.
+	unsigned int SelectLod(float distance, float worldScale, float pixelsPerUnit, float maxPixelError = 1.0f);
+
+	// Cull the meshlets of the full detail level against a view, and fill the
+	// culled index buffer with the ones that may be visible.
+	// - Returns the number of indices to draw from the culled index buffer.
+	// - They're grouped by submesh, see GetCulledSubmesh.
+	unsigned int CullMeshlets(ID3D11DeviceContext* context, DirectX::XMFLOAT4X4 worldMatrix, DirectX::XMFLOAT4X4 viewMatrix,
+		DirectX::XMFLOAT4X4 projMatrix, DirectX::XMFLOAT3 cameraPosition, MeshletCullStats* stats = nullptr);
+	std::vector<Vertex>* GetVerticesWorldSpace(DirectX::XMFLOAT4X4 worldMatrix);	// Shares one vector, so one caller at a time (empty unless MeshRetention_Full)
+
+	// Transform every vertex's position (or normal) into caller owned arrays
+	// of GetVertexCount() floats each. Safe to call from many threads at once.
+	// - See VertexTransform; threadCount of 0 uses every hardware thread on big meshes.
+	// - Positions need MeshRetention_Positions or better, normals MeshRetention_Full.
+	void TransformPositions(const DirectX::XMFLOAT4X4& worldMatrix, VertexStreamTarget out, unsigned int threadCount = 0) const;
+	void TransformNormals(const DirectX::XMFLOAT4X4& normalMatrix, VertexStreamTarget out, unsigned int threadCount = 0) const;
+
+	// World space axis aligned box of the mesh.
+	// - By default the local box is transformed, which is O(1) but can be
+	//   loose once rotated. exactHull uses the convex hull's vertices instead
+	//   (built on first use), which gives the same box as every vertex would.
+	DirectX::BoundingBox GetWorldBoundingBox(DirectX::XMFLOAT4X4 worldMatrix, bool exactHull = false);
+
+	// When enabled, loading from a file (or building a primitive) prints information about the mesh (welding, etc).
+	static void SetReportStats(bool report);
+
+	// Optional steps used when loading from a file or building a primitive (MeshBuildFlags).
+	// - Cooked files built with different flags are rebuilt.
+	static void SetBuildFlags(uint32_t flags);
+	static uint32_t GetBuildFlags();
+
+	// Vertex format of the buffers made when loading from a file (or building a primitive).
+	// - Packed formats need the matching vertex shader (VS_NormalPacked, VS_NormalQuantized).
+	// - Packed formats also build the position stream (as MeshBuild_PositionStream does),
+	//   since their vertices can't be drawn by the depth passes.
+	static void SetFileVertexFormat(VertexFormat format);
+	static VertexFormat GetFileVertexFormat();
+
+	// How levels of detail are built when MeshBuild_Lods is set.
+	// - Cooked files built with different settings are rebuilt.
+	static void SetLodSettings(const LodSettings& settings);
+	static LodSettings GetLodSettings();
+
+	// When enabled, new meshes put their geometry in a shared GeometryPool
+	// instead of making their own buffers.
+	static void SetUseGeometryPool(bool use);
+	static bool GetUseGeometryPool();
+
+	// What new meshes keep on the CPU after making their buffers.
+	static void SetDefaultRetention(MeshRetention retention);
+	static MeshRetention GetDefaultRetention();
+
+	// Print what every mesh keeps on the CPU, and the total (when reporting stats).
+	static void ReportResidentMemory();
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_vertexBufferPtr;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_indexBufferPtr;
+	GeometryPool* m_pool;
+	GeometryAllocation m_poolAllocation;
+	DXGI_FORMAT m_indexFormat;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_positionBufferPtr;			// Position stream (if any)
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_positionIndexBufferPtr;
+	GeometryPool* m_positionPool;
+	GeometryAllocation m_positionPoolAllocation;
+	DXGI_FORMAT m_positionIndexFormat;
+	unsigned int m_positionCount;
 	int m_numOfIndices;
+	VertexFormat m_vertexFormat;
+	unsigned int m_vertexStride;
+	PositionQuantization m_positionQuantization;
+	std::vector<MeshLod> m_lods;
+	std::vector<MeshSubmesh> m_submeshes;			// Of every level (empty if the model has no materials)
+	std::vector<uint32_t> m_submeshMeshlets;		// Where each full detail submesh's meshlets start (and one past the last)
+	std::vector<MeshSubmesh> m_culledSubmeshes;
+	std::vector<ObjMaterial> m_submeshMaterials;	// One per submesh of a level (unnamed if the MTL files don't have it)
+	std::vector<Meshlet> m_meshlets;
+	std::vector<unsigned int> m_meshletIndices;		// The full detail indices the meshlets point into
+	std::vector<unsigned int> m_culledIndices;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_culledIndexBufferPtr;
+	std::string m_name;
+	MeshRetention m_retention;
+	unsigned int m_vertexCount;
+	LocalBounds m_bounds;
+	std::vector<DirectX::XMFLOAT3> m_hull;
+	bool m_hullBuilt;
 
 	std::vector<Vertex> m_verts;
+	VertexStream m_positions;
+	VertexStream m_normals;
 	std::vector<Vertex> m_vertsWorldSpace;
-	void CreateBuffers(Vertex vertexArray[], unsigned int indexArray[], int numOfVertices, int numOfIndices, ID3D11Device* device);
+	static bool s_reportStats;
+	static uint32_t s_buildFlags;
+	static VertexFormat s_fileVertexFormat;
+	static LodSettings s_lodSettings;
+	static bool s_useGeometryPool;
+	static MeshRetention s_retention;
+	static std::vector<Mesh*> s_meshes;				// Every mesh that exists, for ReportResidentMemory
+	static ID3D11Buffer* s_boundVertexBuffer;		// What Bind last set
+	static ID3D11Buffer* s_boundIndexBuffer;
+
+	void CreateBuffers(const void* vertexData, unsigned int vertexStride, const unsigned int indexArray[], int numOfVertices, int numOfIndices, ID3D11Device* device);
+	void CreateFileBuffers(const char* pathToFile, const Vertex vertexArray[], const unsigned int indexArray[], int numOfVertices, int numOfIndices, ID3D11Device* device);
+	void SetLods(const MeshLod lods[], int lodCount);
+	void SetDefaults(const char* name);
+	void BuildGeometry(MeshGeometry& geometry);
+	void CreateGeometryBuffers(const MeshGeometry& geometry, ID3D11Device* device, const LocalBounds* bounds = nullptr);
+	void KeepVertices(const Vertex vertexArray[], int numOfVertices, const LocalBounds* bounds = nullptr);
+	static void BindBuffers(ID3D11DeviceContext* context, ID3D11Buffer* vertexBuffer, unsigned int vertexStride, ID3D11Buffer* indexBuffer, DXGI_FORMAT indexFormat);
+	void CreatePositionBuffers(const DirectX::XMFLOAT3 positions[], const unsigned int indexArray[], int numOfPositions, int numOfIndices, ID3D11Device* device);
+	void SetMeshlets(const Meshlet meshlets[], int meshletCount, const unsigned int indexArray[], ID3D11Device* device);
+	void SetSubmeshes(const MeshSubmesh submeshes[], int submeshCount);
+	void LoadMaterials(const char* pathToFile, const std::vector<std::string>& libraries);
 };
 
@@ -0,0 +1,380 @@
+#include "MeshBounds.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Points closer than this (relative to the size of the mesh) to a face count as on it.
+	const double HullTolerance = 1e-6;
+
+	// Positions are copied into doubles, so the hull's planes don't lose precision.
+	struct Point
+	{
+		double x, y, z;
+		bool operator<(const Point& other) const { return x != other.x ? x < other.x : y != other.y ? y < other.y : z < other.z; }
+		bool operator==(const Point& other) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	inline Point Subtract(const Point& a, const Point& b) { return Point{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline Point Cross(const Point& a, const Point& b) { return Point{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	inline double Dot(const Point& a, const Point& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline double Length(const Point& a) { return sqrt(Dot(a, a)); }
+
+	// A face of the hull, wound so its normal points out.
+	struct HullFace
+	{
+		unsigned int v[3];
+		unsigned int neighbor[3];			// The face across the edge from v[i] to v[i + 1]
+		Point normal;
+		double d;
+		bool alive;
+		unsigned int visit;					// Last search that reached it
+		std::vector<unsigned int> outside;	// Points in front of it, that it's responsible for
+	};
+
+	// An edge between the faces a point can see and the ones it can't.
+	struct HorizonEdge
+	{
+		unsigned int from, to;
+		unsigned int across;
+	};
+
+	HullFace MakeFace(const std::vector<Point>& points, unsigned int a, unsigned int b, unsigned int c)
+	{
+		HullFace face;
+		face.v[0] = a; face.v[1] = b; face.v[2] = c;
+		face.normal = Cross(Subtract(points[b], points[a]), Subtract(points[c], points[a]));
+		double length = Length(face.normal);
+		if (length > 0.0) {
+			face.normal.x /= length; face.normal.y /= length; face.normal.z /= length;
+		}
+		face.d = Dot(face.normal, points[a]);
+		face.alive = true;
+		face.visit = 0;
+		return face;
+	}
+
+	// Signed distance of a point in front of a face.
+	inline double Distance(const HullFace& face, const Point& p) { return Dot(face.normal, p) - face.d; }
+
+	// Which of a face's edges runs from "from" to "to" (3 if none).
+	inline int FindEdge(const HullFace& face, unsigned int from, unsigned int to)
+	{
+		for (int e = 0; e < 3; e++) {
+			if (face.v[e] == from && face.v[(e + 1) % 3] == to)
+				return e;
+		}
+		return 3;
+	}
+
+	// Give a point to the face it's furthest in front of, if any.
+	bool AssignOutside(std::vector<HullFace>& faces, const unsigned int* candidates, size_t candidateCount,
+		const std::vector<Point>& points, unsigned int point, double tolerance)
+	{
+		unsigned int best = 0;
+		double bestDistance = tolerance;
+		for (size_t i = 0; i < candidateCount; i++) {
+			double distance = Distance(faces[candidates[i]], points[point]);
+			if (distance > bestDistance) {
+				bestDistance = distance;
+				best = candidates[i];
+			}
+		}
+		if (bestDistance <= tolerance)
+			return false;
+		faces[best].outside.push_back(point);
+		return true;
+	}
+}
+
+
+LocalBounds MeshBounds::Calculate(const Vertex* vertices, size_t count)
+{
+	LocalBounds bounds;
+	if (count == 0)
+		return bounds;
+
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t i = 0; i < count; i++) {
+		XMVECTOR pos = XMLoadFloat3(&vertices[i].Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+	XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+
+	float radiusSq = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&vertices[i].Position), center);
+		radiusSq = fmaxf(radiusSq, XMVectorGetX(XMVector3Dot(offset, offset)));
+	}
+
+	XMStoreFloat3(&bounds.boxCenter, center);
+	XMStoreFloat3(&bounds.boxExtents, XMVectorScale(XMVectorSubtract(boundsMax, boundsMin), 0.5f));
+	bounds.sphereCenter = bounds.boxCenter;
+	bounds.sphereRadius = sqrtf(radiusSq);
+	return bounds;
+}
+
+// Each new extent is the box's extents projected onto that axis
+// - "Transforming Axis-Aligned Bounding Boxes" (Arvo, Graphics Gems 1990)
+void MeshBounds::TransformBox(const XMFLOAT3& center, const XMFLOAT3& extents, const XMFLOAT4X4& matrix, XMFLOAT3* outCenter, XMFLOAT3* outExtents)
+{
+	XMMATRIX m = XMLoadFloat4x4(&matrix);
+	XMStoreFloat3(outCenter, XMVector3Transform(XMLoadFloat3(&center), m));
+
+	const float* e = &extents.x;
+	float* out = &outExtents->x;
+	for (int column = 0; column < 3; column++) {
+		out[column] =
+			fabsf(matrix.m[0][column]) * e[0] +
+			fabsf(matrix.m[1][column]) * e[1] +
+			fabsf(matrix.m[2][column]) * e[2];
+	}
+}
+
+void MeshBounds::TransformPointsBox(const XMFLOAT3* points, size_t count, const XMFLOAT4X4& matrix, XMFLOAT3* outCenter, XMFLOAT3* outExtents)
+{
+	if (count == 0) {
+		*outCenter = XMFLOAT3(matrix.m[3][0], matrix.m[3][1], matrix.m[3][2]);
+		*outExtents = XMFLOAT3(0, 0, 0);
+		return;
+	}
+
+	XMMATRIX m = XMLoadFloat4x4(&matrix);
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t i = 0; i < count; i++) {
+		XMVECTOR pos = XMVector3Transform(XMLoadFloat3(&points[i]), m);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+
+	XMStoreFloat3(outCenter, XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f));
+	XMStoreFloat3(outExtents, XMVectorScale(XMVectorSubtract(boundsMax, boundsMin), 0.5f));
+}
+
+// Convex hull (Quickhull, Barber et al. 1996)
+// - Starts from the biggest tetrahedron the extreme points make. Every
+//   point outside it belongs to one face; each step takes the furthest
+//   point of a face, walks across the faces it can see, and closes the
+//   hole with a fan from the point to the horizon around them.
+// - The walk only follows neighbours, so the faces removed are always
+//   one connected patch even when rounding makes "can see" a close call.
+//   A point whose horizon still isn't a simple loop is kept as is, which
+//   leaves the hull's box exact (it's a real point) if a little slower.
+// - Only run on demand, since it's much slower than the box transform.
+static void BuildHull(std::vector<Point>& points, std::vector<XMFLOAT3>& out)
+{
+	out.clear();
+
+	// Unique positions (welding keeps a vertex per normal/uv, so there are repeats)
+	std::sort(points.begin(), points.end());
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+
+	auto useAllPoints = [&]() {
+		out.resize(points.size());
+		for (size_t i = 0; i < points.size(); i++)
+			out[i] = XMFLOAT3((float)points[i].x, (float)points[i].y, (float)points[i].z);
+	};
+	if (points.size() < 4)
+		return useAllPoints();
+
+	// The extreme point along each axis, both ways
+	unsigned int extremes[6] = {};
+	for (unsigned int i = 0; i < points.size(); i++) {
+		const double* p = &points[i].x;
+		for (int axis = 0; axis < 3; axis++) {
+			if (p[axis] < (&points[extremes[axis * 2]].x)[axis]) extremes[axis * 2] = i;
+			if (p[axis] > (&points[extremes[axis * 2 + 1]].x)[axis]) extremes[axis * 2 + 1] = i;
+		}
+	}
+	double size = 0.0;
+	for (int axis = 0; axis < 3; axis++)
+		size = std::max(size, (&points[extremes[axis * 2 + 1]].x)[axis] - (&points[extremes[axis * 2]].x)[axis]);
+	double tolerance = size * HullTolerance;
+
+	// The starting tetrahedron: the two extremes furthest apart, the point
+	// furthest from the line between them, then the furthest from that plane
+	unsigned int a = extremes[0], b = extremes[1];
+	for (int i = 0; i < 6; i++) {
+		for (int j = i + 1; j < 6; j++) {
+			Point ij = Subtract(points[extremes[j]], points[extremes[i]]);
+			if (Dot(ij, ij) > Dot(Subtract(points[b], points[a]), Subtract(points[b], points[a]))) {
+				a = extremes[i];
+				b = extremes[j];
+			}
+		}
+	}
+
+	Point line = Subtract(points[b], points[a]);
+	double lineLength = Length(line);
+	unsigned int c = a;
+	double best = 0.0;
+	for (unsigned int i = 0; i < points.size(); i++) {
+		double distance = (lineLength > 0.0) ? Length(Cross(line, Subtract(points[i], points[a]))) / lineLength : 0.0;
+		if (distance > best) { best = distance; c = i; }
+	}
+	if (best <= tolerance)
+		return useAllPoints();
+
+	HullFace base = MakeFace(points, a, b, c);
+	unsigned int d = a;
+	best = 0.0;
+	for (unsigned int i = 0; i < points.size(); i++) {
+		double distance = fabs(Distance(base, points[i]));
+		if (distance > best) { best = distance; d = i; }
+	}
+	if (best <= tolerance)
+		return useAllPoints();
+
+	// Wind the tetrahedron's faces outwards, and link them up
+	std::vector<HullFace> faces;
+	const unsigned int corners[4][4] = { { a, b, c, d }, { a, c, d, b }, { a, d, b, c }, { b, d, c, a } };
+	for (const unsigned int* f : corners) {
+		HullFace face = MakeFace(points, f[0], f[1], f[2]);
+		if (Distance(face, points[f[3]]) > 0.0)
+			face = MakeFace(points, f[0], f[2], f[1]);
+		faces.push_back(face);
+	}
+	for (unsigned int f = 0; f < 4; f++) {
+		for (int e = 0; e < 3; e++) {
+			for (unsigned int g = 0; g < 4; g++) {
+				if (g != f && FindEdge(faces[g], faces[f].v[(e + 1) % 3], faces[f].v[e]) < 3)
+					faces[f].neighbor[e] = g;
+			}
+		}
+	}
+
+	const unsigned int tetrahedron[4] = { 0, 1, 2, 3 };
+	for (unsigned int i = 0; i < points.size(); i++) {
+		if (i != a && i != b && i != c && i != d)
+			AssignOutside(faces, tetrahedron, 4, points, i, tolerance);
+	}
+
+	// Then grow it until no face has points left in front of it
+	std::vector<unsigned int> pending = { 0, 1, 2, 3 };
+	std::vector<unsigned int> visible, stack, newFaces;
+	std::vector<HorizonEdge> horizon;
+	std::vector<unsigned int> leftover;
+	std::vector<unsigned int> startStamp(points.size(), 0), startFace(points.size()), endFace(points.size());
+	unsigned int search = 0;
+	while (!pending.empty()) {
+		unsigned int f = pending.back();
+		pending.pop_back();
+		if (!faces[f].alive || faces[f].outside.empty())
+			continue;
+
+		// The furthest point in front of this face is surely on the hull
+		std::vector<unsigned int>& outside = faces[f].outside;
+		size_t eyeSlot = 0;
+		for (size_t i = 1; i < outside.size(); i++) {
+			if (Distance(faces[f], points[outside[i]]) > Distance(faces[f], points[outside[eyeSlot]]))
+				eyeSlot = i;
+		}
+		unsigned int eye = outside[eyeSlot];
+		outside[eyeSlot] = outside.back();
+		outside.pop_back();
+
+		// Walk out across the faces it can see, noting the edges where that stops
+		search++;
+		visible.clear();
+		horizon.clear();
+		stack.assign(1, f);
+		faces[f].visit = search;
+		while (!stack.empty()) {
+			unsigned int g = stack.back();
+			stack.pop_back();
+			visible.push_back(g);
+			for (int e = 0; e < 3; e++) {
+				unsigned int n = faces[g].neighbor[e];
+				if (faces[n].visit == search)
+					continue;
+				if (Distance(faces[n], points[eye]) > tolerance) {
+					faces[n].visit = search;
+					stack.push_back(n);
+				}
+				else {
+					horizon.push_back(HorizonEdge{ faces[g].v[e], faces[g].v[(e + 1) % 3], n });
+				}
+			}
+		}
+
+		// Each horizon vertex should start exactly one edge
+		bool simple = true;
+		for (const HorizonEdge& edge : horizon) {
+			if (startStamp[edge.from] == search)
+				simple = false;
+			startStamp[edge.from] = search;
+		}
+		if (!simple) {
+			leftover.push_back(eye);
+			for (unsigned int g : visible)
+				faces[g].visit = 0;
+			pending.push_back(f);
+			continue;
+		}
+
+		// Close the hole with a fan of faces to the eye
+		newFaces.clear();
+		for (const HorizonEdge& edge : horizon) {
+			unsigned int index = (unsigned int)faces.size();
+			HullFace face = MakeFace(points, edge.from, edge.to, eye);
+			face.neighbor[0] = edge.across;
+			faces[edge.across].neighbor[FindEdge(faces[edge.across], edge.to, edge.from)] = index;
+			startFace[edge.from] = index;
+			endFace[edge.to] = index;
+			faces.push_back(face);
+			newFaces.push_back(index);
+		}
+		for (unsigned int index : newFaces) {
+			HullFace& face = faces[index];
+			face.neighbor[1] = startFace[face.v[1]];	// Its edge to the eye
+			face.neighbor[2] = endFace[face.v[0]];		// Its edge from the eye
+		}
+
+		// The points the removed faces had go to the new ones, unless they're now inside
+		for (unsigned int g : visible) {
+			faces[g].alive = false;
+			for (unsigned int point : faces[g].outside)
+				AssignOutside(faces, newFaces.data(), newFaces.size(), points, point, tolerance);
+			std::vector<unsigned int>().swap(faces[g].outside);
+		}
+		for (unsigned int index : newFaces) {
+			if (!faces[index].outside.empty())
+				pending.push_back(index);
+		}
+	}
+
+	// The hull's vertices are the ones its faces still use
+	std::vector<bool> used(points.size(), false);
+	for (const HullFace& face : faces) {
+		if (!face.alive) continue;
+		used[face.v[0]] = used[face.v[1]] = used[face.v[2]] = true;
+	}
+	for (unsigned int point : leftover)
+		used[point] = true;
+	for (size_t i = 0; i < points.size(); i++) {
+		if (used[i])
+			out.push_back(XMFLOAT3((float)points[i].x, (float)points[i].y, (float)points[i].z));
+	}
+}
+
+void MeshBounds::BuildConvexHull(const Vertex* vertices, size_t count, std::vector<XMFLOAT3>& out)
+{
+	std::vector<Point> points(count);
+	for (size_t i = 0; i < count; i++)
+		points[i] = Point{ vertices[i].Position.x, vertices[i].Position.y, vertices[i].Position.z };
+	BuildHull(points, out);
+}
+
+void MeshBounds::BuildConvexHull(const float* x, const float* y, const float* z, size_t count, std::vector<XMFLOAT3>& out)
+{
+	std::vector<Point> points(count);
+	for (size_t i = 0; i < count; i++)
+		points[i] = Point{ x[i], y[i], z[i] };
+	BuildHull(points, out);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// Local space bounds of a mesh's vertices.
+struct LocalBounds
+{
+	DirectX::XMFLOAT3 boxCenter = DirectX::XMFLOAT3(0, 0, 0);		// Axis aligned box
+	DirectX::XMFLOAT3 boxExtents = DirectX::XMFLOAT3(0, 0, 0);
+	DirectX::XMFLOAT3 sphereCenter = DirectX::XMFLOAT3(0, 0, 0);	// Sphere around the box's center
+	float sphereRadius = 0.0f;
+};
+
+// --------------------------------------------------------
+// Bounding volumes of meshes, so nothing needs to walk every
+// vertex once a mesh is loaded
+//
+// - World space boxes come from transforming the local box's
+//   center and extents (Arvo's method), which is O(1) but can
+//   be bigger than needed once the mesh rotates.
+// - For an exact box, only the vertices of the convex hull
+//   need transforming, since the extreme vertex in any
+//   direction is always on the hull.
+// --------------------------------------------------------
+class MeshBounds
+{
+public:
+	// Bounds of a set of vertices.
+	static LocalBounds Calculate(const Vertex* vertices, size_t count);
+
+	// The box (as center and extents) that holds the given box after a transform.
+	static void TransformBox(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents, const DirectX::XMFLOAT4X4& matrix,
+		DirectX::XMFLOAT3* outCenter, DirectX::XMFLOAT3* outExtents);
+
+	// The exact box (as center and extents) around a set of points after a transform.
+	static void TransformPointsBox(const DirectX::XMFLOAT3* points, size_t count, const DirectX::XMFLOAT4X4& matrix,
+		DirectX::XMFLOAT3* outCenter, DirectX::XMFLOAT3* outExtents);
+
+	// The vertices of the convex hull of the vertices' positions (an incremental hull).
+	// - Flat or tiny meshes that don't have a solid hull just give all their positions.
+	static void BuildConvexHull(const Vertex* vertices, size_t count, std::vector<DirectX::XMFLOAT3>& out);
+	static void BuildConvexHull(const float* x, const float* y, const float* z, size_t count, std::vector<DirectX::XMFLOAT3>& out);	// Separate x/y/z arrays
+};
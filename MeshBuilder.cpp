@@ -0,0 +1,628 @@
+#include "MeshBuilder.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_XM_SSE_INTRINSICS_)
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// Bytes at the start of a Vertex that identify it for welding (position, normal and uv).
+	// - The tangent comes last, and hasn't been calculated yet anyway.
+	const size_t WeldKeySize = offsetof(Vertex, Tangent);
+
+	// Marks an unused slot in the weld table.
+	const unsigned int EmptySlot = 0xFFFFFFFF;
+
+	// One slot of the weld table.
+	// - The full hash is kept so most mismatches never touch the vertex itself.
+	struct WeldSlot
+	{
+		unsigned int hash;
+		unsigned int index;
+	};
+
+	// Hashes some bytes (FNV-1a over 32 bit words, with a final avalanche).
+	template<size_t Size>
+	inline unsigned int HashWords(const void* data)
+	{
+		unsigned int words[Size / sizeof(unsigned int)];
+		memcpy(words, data, Size);
+
+		unsigned int hash = 2166136261u;
+		for (unsigned int word : words) {
+			hash ^= word;
+			hash *= 16777619u;
+		}
+
+		hash ^= hash >> 16;
+		hash *= 0x7feb352d;
+		hash ^= hash >> 15;
+		return hash;
+	}
+
+	// The order to take the triangles of an OBJ file in so each material's are
+	// together (materials in the order they're first used), and their submeshes.
+	// - Leaves both empty if the file doesn't use materials.
+	// - Triangles before the first "usemtl" get a material with no name.
+	void GroupByMaterial(const ObjData& obj, size_t triangleCount, std::vector<unsigned int>& order, std::vector<MeshSubmesh>& submeshes)
+	{
+		order.clear();
+		submeshes.clear();
+		if (obj.materialUses.empty() || triangleCount == 0)
+			return;
+
+		// Which material each triangle uses (only ones that are used get one)
+		std::vector<const std::string*> names;
+		std::vector<unsigned int> triangleMaterial(triangleCount);
+		std::vector<uint32_t> counts;
+		static const std::string noName;
+		const std::string* currentName = &noName;
+		unsigned int current = EmptySlot;
+		size_t nextUse = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			while (nextUse < obj.materialUses.size() && obj.materialUses[nextUse].firstIndex <= t * 3) {
+				currentName = &obj.materialUses[nextUse++].name;
+				current = EmptySlot;
+			}
+			if (current == EmptySlot) {
+				for (current = 0; current < names.size() && *names[current] != *currentName; current++) {}
+				if (current == names.size()) {
+					names.push_back(currentName);
+					counts.push_back(0);
+				}
+			}
+			triangleMaterial[t] = current;
+			counts[current]++;
+		}
+
+		// Counting sort of the triangles by material
+		submeshes.resize(names.size());
+		uint32_t offset = 0;
+		for (size_t m = 0; m < names.size(); m++) {
+			MeshSubmesh& submesh = submeshes[m];
+			memset(&submesh, 0, sizeof(submesh));
+			submesh.indexOffset = offset * 3;
+			submesh.indexCount = counts[m] * 3;
+			memcpy(submesh.material, names[m]->c_str(), std::min(names[m]->size(), sizeof(submesh.material) - 1));
+			counts[m] = offset;
+			offset += submesh.indexCount / 3;
+		}
+		order.resize(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++)
+			order[counts[triangleMaterial[t]]++] = (unsigned int)t;
+	}
+
+	// Hashes the weld key of a vertex.
+	inline unsigned int HashVertex(const Vertex& v) { return HashWords<WeldKeySize>(&v); }
+
+	// Turns -0.0f into 0.0f, so that the two weld together.
+	inline float Canonical(float f) { return (f == 0.0f) ? 0.0f : f; }
+
+	// Triangles (or vertices) per work item when calculating tangents.
+	const size_t TangentBlockSize = 4096;
+
+	// The mesh data needed to calculate triangle tangents, as SoA arrays.
+	struct TriangleTangentInput
+	{
+		const unsigned int* indices;
+		const float* positionX;
+		const float* positionY;
+		const float* positionZ;
+		const float* uvX;
+		const float* uvY;
+	};
+
+	// The (unnormalized) tangent of a single triangle, as x, y, z and a zero.
+	// - Zero if the triangle doesn't have one (degenerate uvs or positions).
+	inline void CalculateTriangleTangent(const TriangleTangentInput& in, size_t triangle, float* out)
+	{
+		unsigned int i1 = in.indices[triangle * 3];
+		unsigned int i2 = in.indices[triangle * 3 + 1];
+		unsigned int i3 = in.indices[triangle * 3 + 2];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = in.positionX[i2] - in.positionX[i1];
+		float y1 = in.positionY[i2] - in.positionY[i1];
+		float z1 = in.positionZ[i2] - in.positionZ[i1];
+
+		float x2 = in.positionX[i3] - in.positionX[i1];
+		float y2 = in.positionY[i3] - in.positionY[i1];
+		float z2 = in.positionZ[i3] - in.positionZ[i1];
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = in.uvX[i2] - in.uvX[i1];
+		float t1 = in.uvY[i2] - in.uvY[i1];
+
+		float s2 = in.uvX[i3] - in.uvX[i1];
+		float t2 = in.uvY[i3] - in.uvY[i1];
+
+		// Create vectors for tangent calculation
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		// Anything that isn't finite (x * 0 is NaN for infinities and NaNs) is dropped
+		bool valid = (tx * 0.0f == 0.0f) && (ty * 0.0f == 0.0f) && (tz * 0.0f == 0.0f);
+		float* tangent = out + triangle * 4;
+		tangent[0] = valid ? tx : 0.0f;
+		tangent[1] = valid ? ty : 0.0f;
+		tangent[2] = valid ? tz : 0.0f;
+		tangent[3] = 0.0f;
+	}
+
+	// The tangents of the triangles in [begin, end), four at a time where possible.
+	void CalculateTriangleTangents(const TriangleTangentInput& in, size_t begin, size_t end, float* out)
+	{
+		size_t t = begin;
+
+#if defined(_XM_SSE_INTRINSICS_)
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		for (; t + 4 <= end; t += 4)
+		{
+			// Gather the corners of four triangles, one per lane
+			const unsigned int* tri = in.indices + t * 3;
+			#define GATHER(array, corner) _mm_setr_ps(array[tri[corner]], array[tri[corner + 3]], array[tri[corner + 6]], array[tri[corner + 9]])
+			__m128 px1 = GATHER(in.positionX, 0), px2 = GATHER(in.positionX, 1), px3 = GATHER(in.positionX, 2);
+			__m128 py1 = GATHER(in.positionY, 0), py2 = GATHER(in.positionY, 1), py3 = GATHER(in.positionY, 2);
+			__m128 pz1 = GATHER(in.positionZ, 0), pz2 = GATHER(in.positionZ, 1), pz3 = GATHER(in.positionZ, 2);
+			__m128 u1 = GATHER(in.uvX, 0), u2 = GATHER(in.uvX, 1), u3 = GATHER(in.uvX, 2);
+			__m128 v1 = GATHER(in.uvY, 0), v2 = GATHER(in.uvY, 1), v3 = GATHER(in.uvY, 2);
+			#undef GATHER
+
+			// Exactly the same operations as CalculateTriangleTangent
+			__m128 x1 = _mm_sub_ps(px2, px1);
+			__m128 y1 = _mm_sub_ps(py2, py1);
+			__m128 z1 = _mm_sub_ps(pz2, pz1);
+
+			__m128 x2 = _mm_sub_ps(px3, px1);
+			__m128 y2 = _mm_sub_ps(py3, py1);
+			__m128 z2 = _mm_sub_ps(pz3, pz1);
+
+			__m128 s1 = _mm_sub_ps(u2, u1);
+			__m128 t1 = _mm_sub_ps(v2, v1);
+
+			__m128 s2 = _mm_sub_ps(u3, u1);
+			__m128 t2 = _mm_sub_ps(v3, v1);
+
+			__m128 r = _mm_div_ps(one, _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1)));
+
+			__m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r);
+			__m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r);
+			__m128 tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r);
+
+			__m128 valid = _mm_and_ps(
+				_mm_and_ps(_mm_cmpeq_ps(_mm_mul_ps(tx, zero), zero), _mm_cmpeq_ps(_mm_mul_ps(ty, zero), zero)),
+				_mm_cmpeq_ps(_mm_mul_ps(tz, zero), zero));
+
+			// Back to one triangle per register
+			tx = _mm_and_ps(tx, valid);
+			ty = _mm_and_ps(ty, valid);
+			tz = _mm_and_ps(tz, valid);
+			__m128 tw = zero;
+			_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+			_mm_storeu_ps(out + t * 4, tx);
+			_mm_storeu_ps(out + t * 4 + 4, ty);
+			_mm_storeu_ps(out + t * 4 + 8, tz);
+			_mm_storeu_ps(out + t * 4 + 12, tw);
+		}
+#endif
+
+		// Whatever is left over
+		for (; t < end; t++)
+			CalculateTriangleTangent(in, t, out);
+	}
+
+	// The sum of the given triangles' tangents (from CalculateTriangleTangents), added in the order given.
+	inline XMFLOAT3 SumTriangleTangents(const float* tangents, const unsigned int* triangles, size_t count)
+	{
+#if defined(_XM_SSE_INTRINSICS_)
+		// x, y and z at once (the fourth is always zero)
+		__m128 sum = _mm_setzero_ps();
+		for (size_t i = 0; i < count; i++)
+			sum = _mm_add_ps(sum, _mm_loadu_ps(tangents + (size_t)triangles[i] * 4));
+
+		alignas(16) float result[4];
+		_mm_store_ps(result, sum);
+		return XMFLOAT3(result[0], result[1], result[2]);
+#else
+		XMFLOAT3 sum(0, 0, 0);
+		for (size_t i = 0; i < count; i++) {
+			const float* tangent = tangents + (size_t)triangles[i] * 4;
+			sum.x += tangent[0];
+			sum.y += tangent[1];
+			sum.z += tangent[2];
+		}
+		return sum;
+#endif
+	}
+
+	// Some tangent perpendicular to the normal, for vertices without a usable one.
+	XMFLOAT3 FallbackTangent(const XMFLOAT3& normal)
+	{
+		// Cross with whichever axis the normal is furthest from
+		XMVECTOR n = XMLoadFloat3(&normal);
+		XMVECTOR axis = (fabsf(normal.x) < 0.9f) ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+		XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(axis, n));
+
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, tangent);
+		if (result.x == 0.0f && result.y == 0.0f && result.z == 0.0f)
+			result = XMFLOAT3(1, 0, 0);
+		return result;
+	}
+
+	// Stores a finished tangent, or a fallback if there wasn't a usable one
+	// (zero, or NaN from a broken normal).
+	inline void SetTangent(Vertex& vert, const XMFLOAT3& tangent)
+	{
+		bool isZero = (tangent.x == 0.0f && tangent.y == 0.0f && tangent.z == 0.0f);
+		bool isNaN = (tangent.x != tangent.x || tangent.y != tangent.y || tangent.z != tangent.z);
+		vert.Tangent = (isZero || isNaN) ? FallbackTangent(vert.Normal) : tangent;
+	}
+
+	// Makes the (summed) tangents of the given vertices orthogonal to their normals and normalizes them.
+	void OrthogonalizeTangents(Vertex* verts, size_t count)
+	{
+		size_t i = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+		// Four vertices at a time, one per lane.  The sums are done in
+		// the same order as the SSE2 XMVector3Dot and XMVector3Normalize
+		// ((x + y) + z); other paths (SSE4's dot product) may round the
+		// last bit differently, see CalculateTangents.
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			const Vertex* v = verts + i;
+			__m128 nx = _mm_setr_ps(v[0].Normal.x, v[1].Normal.x, v[2].Normal.x, v[3].Normal.x);
+			__m128 ny = _mm_setr_ps(v[0].Normal.y, v[1].Normal.y, v[2].Normal.y, v[3].Normal.y);
+			__m128 nz = _mm_setr_ps(v[0].Normal.z, v[1].Normal.z, v[2].Normal.z, v[3].Normal.z);
+			__m128 tx = _mm_setr_ps(v[0].Tangent.x, v[1].Tangent.x, v[2].Tangent.x, v[3].Tangent.x);
+			__m128 ty = _mm_setr_ps(v[0].Tangent.y, v[1].Tangent.y, v[2].Tangent.y, v[3].Tangent.y);
+			__m128 tz = _mm_setr_ps(v[0].Tangent.z, v[1].Tangent.z, v[2].Tangent.z, v[3].Tangent.z);
+
+			// Use Gram-Schmidt orthogonalize
+			__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)), _mm_mul_ps(nz, tz));
+			tx = _mm_sub_ps(tx, _mm_mul_ps(nx, dot));
+			ty = _mm_sub_ps(ty, _mm_mul_ps(ny, dot));
+			tz = _mm_sub_ps(tz, _mm_mul_ps(nz, dot));
+
+			// Normalize (zero length stays zero)
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz)));
+			__m128 nonZero = _mm_cmpneq_ps(zero, length);
+			tx = _mm_and_ps(_mm_div_ps(tx, length), nonZero);
+			ty = _mm_and_ps(_mm_div_ps(ty, length), nonZero);
+			tz = _mm_and_ps(_mm_div_ps(tz, length), nonZero);
+
+			alignas(16) float x[4], y[4], z[4];
+			_mm_store_ps(x, tx);
+			_mm_store_ps(y, ty);
+			_mm_store_ps(z, tz);
+			for (int lane = 0; lane < 4; lane++)
+				SetTangent(verts[i + lane], XMFLOAT3(x[lane], y[lane], z[lane]));
+		}
+#endif
+
+		// Whatever is left over
+		for (; i < count; i++)
+		{
+			// Grab the two vectors
+			XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+			XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+
+			// Use Gram-Schmidt orthogonalize
+			tangent = XMVector3Normalize(
+				tangent - normal * XMVector3Dot(normal, tangent));
+
+			// Store the tangent
+			XMFLOAT3 result;
+			XMStoreFloat3(&result, tangent);
+			SetTangent(verts[i], result);
+		}
+	}
+}
+
+
+double WeldStats::GetReuseRatio() const
+{
+	if (vertexCount == 0) return 0.0;
+	return (double)cornerCount / (double)vertexCount;
+}
+
+
+void MeshBuilder::BuildFromObj(const ObjData& obj, MeshGeometry& out, WeldStats* stats)
+{
+	size_t cornerCount = obj.indices.size();
+
+	out.vertices.clear();
+	out.vertices.reserve(cornerCount);
+	out.indices.resize(cornerCount / 3 * 3);
+
+	// Open-addressing table of vertex indices, kept at most half full so probes stay short.
+	size_t capacity = 16;
+	while (capacity < cornerCount * 2) capacity <<= 1;
+	std::vector<WeldSlot> table(capacity, WeldSlot{ 0, EmptySlot });
+	size_t mask = capacity - 1;
+
+	// The model is most likely in a right-handed space,
+	// especially if it came from Maya.  We want to convert
+	// to a left-handed space for DirectX.  This means we
+	// need to:
+	//  - Invert the Z position
+	//  - Invert the normal's Z
+	//  - Flip the winding order (corners are read as 0, 2, 1)
+	// We also need to flip the UV coordinate since DirectX
+	// defines (0,0) as the top left of the texture, and many
+	// 3D modeling packages use the bottom left as (0,0)
+	const int windingOrder[3] = { 0, 2, 1 };
+
+	// Triangles are taken grouped by material (if there are any)
+	size_t triangleCount = cornerCount / 3;
+	std::vector<unsigned int> triangleOrder;
+	GroupByMaterial(obj, triangleCount, triangleOrder, out.submeshes);
+	out.materialLibraries = obj.materialLibraries;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		size_t i = t * 3;
+		size_t source = triangleOrder.empty() ? i : (size_t)triangleOrder[t] * 3;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			// - Create the vert by looking up the parsed data
+			// - Anything the face didn't reference is zero
+			const ObjIndex& index = obj.indices[source + windingOrder[corner]];
+			XMFLOAT3 pos = (index.position >= 0) ? obj.positions[index.position] : XMFLOAT3(0, 0, 0);
+			XMFLOAT2 uv = (index.uv >= 0) ? obj.uvs[index.uv] : XMFLOAT2(0, 0);
+			XMFLOAT3 norm = (index.normal >= 0) ? obj.normals[index.normal] : XMFLOAT3(0, 0, 0);
+
+			Vertex v;
+			v.Position = XMFLOAT3(Canonical(pos.x), Canonical(pos.y), Canonical(-pos.z));
+			v.Normal = XMFLOAT3(Canonical(norm.x), Canonical(norm.y), Canonical(-norm.z));
+			v.UV = XMFLOAT2(Canonical(uv.x), Canonical(1.0f - uv.y));
+			v.Tangent = XMFLOAT3(0, 0, 0);
+
+			// Find the vertex in the table, or add it
+			unsigned int hash = HashVertex(v);
+			size_t slot = hash & mask;
+			while (true)
+			{
+				WeldSlot& entry = table[slot];
+				if (entry.index == EmptySlot) {
+					entry.hash = hash;
+					entry.index = (unsigned int)out.vertices.size();
+					out.vertices.push_back(v);
+					break;
+				}
+				if (entry.hash == hash && memcmp(&out.vertices[entry.index], &v, WeldKeySize) == 0)
+					break;
+
+				slot = (slot + 1) & mask;
+			}
+
+			out.indices[i + corner] = table[slot].index;
+		}
+	}
+
+	if (stats != nullptr) {
+		stats->cornerCount = cornerCount;
+		stats->vertexCount = out.vertices.size();
+	}
+}
+
+bool MeshBuilder::BuildFromObjFile(const char* pathToFile, MeshGeometry& out, WeldStats* stats)
+{
+	ObjData obj;
+	if (!ObjParser::ParseFile(pathToFile, obj))
+		return false;
+
+	BuildFromObj(obj, out, stats);
+	if (!out.indices.empty())
+		CalculateTangents(&out.vertices[0], (int)out.vertices.size(), &out.indices[0], (int)out.indices.size());
+
+	return true;
+}
+
+// Calculates the tangents of the vertices in a mesh
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - Note: For this code to work, your Vertex format must
+//         contain an XMFLOAT3 called Tangent
+//
+// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+//
+// - Done in three passes, the first and last split across threads:
+//    1. The tangent of every triangle (4 at a time with SSE), from
+//       SoA copies of the positions and uvs
+//    2. Which triangles each vertex is in, in triangle order
+//    3. Every vertex sums its own triangles' tangents (x, y and z at
+//       once with SSE), and the sums are made orthogonal to their
+//       normals (4 vertices at a time)
+//   Each vertex only visits its own triangles, so the work is
+//   O(triangles) however many threads run.  Each vertex also adds up
+//   exactly the same values in exactly the same order as a simple loop
+//   over the triangles would, so the results are bit-for-bit the same
+//   no matter how many threads run.
+//
+// - Against the old scalar code (XMVector3Dot/XMVector3Normalize) the
+//   tangents are the same where DirectXMath sums (x + y) + z like the
+//   SSE code here (its SSE2 path).  Where it doesn't (the SSE4 path's
+//   dot product) the last bits round differently; summing the other
+//   way round on the models in Assets moves them by under 0.00001
+//   degrees.  MeshCook bench-tangents reports the difference, and
+//   fails past 0.0001 degrees.
+//
+// - Triangles with degenerate uvs (or positions), which the old code
+//   turned into NaNs/infinities.  They now contribute nothing, and any
+//   vertex left without a usable tangent gets an arbitrary one that is
+//   still perpendicular to its normal.
+//
+void MeshBuilder::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	if (numVerts <= 0)
+		return;
+
+	size_t vertexCount = (size_t)numVerts;
+	size_t triangleCount = (size_t)(numIndices > 0 ? numIndices : 0) / 3;
+
+	// SoA copies of the positions and uvs
+	std::vector<float> positionX(vertexCount), positionY(vertexCount), positionZ(vertexCount);
+	std::vector<float> uvX(vertexCount), uvY(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		positionX[i] = verts[i].Position.x;
+		positionY[i] = verts[i].Position.y;
+		positionZ[i] = verts[i].Position.z;
+		uvX[i] = verts[i].UV.x;
+		uvY[i] = verts[i].UV.y;
+	}
+
+	TriangleTangentInput input;
+	input.indices = indices;
+	input.positionX = positionX.data();
+	input.positionY = positionY.data();
+	input.positionZ = positionZ.data();
+	input.uvX = uvX.data();
+	input.uvY = uvY.data();
+
+	// 1. The tangent of every triangle
+	std::vector<float> triangleTangents(triangleCount * 4);
+	ParallelFor((triangleCount + TangentBlockSize - 1) / TangentBlockSize, 0, [&](size_t block) {
+		size_t begin = block * TangentBlockSize;
+		size_t end = (begin + TangentBlockSize < triangleCount) ? begin + TangentBlockSize : triangleCount;
+		CalculateTriangleTangents(input, begin, end, triangleTangents.data());
+	});
+
+	// 2. The triangles of every vertex, in triangle order
+	// - Vertex v's are vertexTriangles[firstTriangle[v]] up to (not
+	//   including) vertexTriangles[firstTriangle[v + 1]].
+	// - Counted first, then filled in by going through the triangles
+	//   in order, which keeps each vertex's list in order too.  Filling
+	//   moves each firstTriangle[v] up to where v + 1's start, so they're
+	//   counted one place further along to end up in the right place.
+	size_t cornerCount = triangleCount * 3;
+	std::vector<unsigned int> firstTriangle(vertexCount + 2, 0);
+	for (size_t i = 0; i < cornerCount; i++)
+		firstTriangle[indices[i] + 2]++;
+	for (size_t v = 2; v < vertexCount + 2; v++)
+		firstTriangle[v] += firstTriangle[v - 1];
+
+	std::vector<unsigned int> vertexTriangles(cornerCount);
+	for (size_t t = 0; t < triangleCount; t++) {
+		vertexTriangles[firstTriangle[indices[t * 3] + 1]++] = (unsigned int)t;
+		vertexTriangles[firstTriangle[indices[t * 3 + 1] + 1]++] = (unsigned int)t;
+		vertexTriangles[firstTriangle[indices[t * 3 + 2] + 1]++] = (unsigned int)t;
+	}
+
+	// 3. Sum up and orthogonalize the tangent of every vertex
+	// - Blocks of vertices only write their own, so nothing is shared.
+	ParallelFor((vertexCount + TangentBlockSize - 1) / TangentBlockSize, 0, [&](size_t block) {
+		size_t begin = block * TangentBlockSize;
+		size_t end = (begin + TangentBlockSize < vertexCount) ? begin + TangentBlockSize : vertexCount;
+
+		for (size_t v = begin; v < end; v++) {
+			verts[v].Tangent = SumTriangleTangents(
+				triangleTangents.data(),
+				vertexTriangles.data() + firstTriangle[v],
+				firstTriangle[v + 1] - firstTriangle[v]);
+		}
+
+		OrthogonalizeTangents(verts + begin, end - begin);
+	});
+}
+
+void MeshBuilder::BuildPositionStream(MeshGeometry& geometry, WeldStats* stats)
+{
+	size_t vertexCount = geometry.vertices.size();
+	geometry.positions.clear();
+	geometry.positionIndices.resize(geometry.indices.size());
+
+	// Each vertex's position, welded the same way BuildFromObj welds whole vertices
+	size_t capacity = 16;
+	while (capacity < vertexCount * 2) capacity <<= 1;
+	std::vector<WeldSlot> table(capacity, WeldSlot{ 0, EmptySlot });
+	size_t mask = capacity - 1;
+
+	std::vector<unsigned int> remap(vertexCount, EmptySlot);
+	for (size_t i = 0; i < geometry.indices.size(); i++)
+	{
+		unsigned int vertex = geometry.indices[i];
+		if (remap[vertex] == EmptySlot) {
+			const XMFLOAT3& position = geometry.vertices[vertex].Position;
+			unsigned int hash = HashWords<sizeof(XMFLOAT3)>(&position);
+			size_t slot = hash & mask;
+			while (true)
+			{
+				WeldSlot& entry = table[slot];
+				if (entry.index == EmptySlot) {
+					entry.hash = hash;
+					entry.index = (unsigned int)geometry.positions.size();
+					geometry.positions.push_back(position);
+					break;
+				}
+				if (entry.hash == hash && memcmp(&geometry.positions[entry.index], &position, sizeof(XMFLOAT3)) == 0)
+					break;
+
+				slot = (slot + 1) & mask;
+			}
+			remap[vertex] = table[slot].index;
+		}
+		geometry.positionIndices[i] = remap[vertex];
+	}
+
+	if (stats != nullptr) {
+		stats->cornerCount = vertexCount;
+		stats->vertexCount = geometry.positions.size();
+	}
+}
+
+void MeshBuilder::BuildMeshlets(MeshGeometry& geometry)
+{
+	geometry.meshlets.clear();
+	size_t fullCount = geometry.lods.empty() ? geometry.indices.size() : geometry.lods[0].indexCount;
+	size_t submeshCount = GetSubmeshesPerLevel(geometry);
+	if (submeshCount == 0) {
+		MeshletBuilder::Build(geometry.indices.data(), fullCount, geometry.vertices.data(), geometry.vertices.size(), geometry.meshlets);
+		return;
+	}
+
+	// Each submesh on its own, so culling can still tell them apart
+	std::vector<Meshlet> meshlets;
+	for (size_t i = 0; i < submeshCount; i++) {
+		const MeshSubmesh& submesh = geometry.submeshes[i];
+		MeshletBuilder::Build(geometry.indices.data() + submesh.indexOffset, submesh.indexCount, geometry.vertices.data(), geometry.vertices.size(), meshlets);
+		for (Meshlet& meshlet : meshlets)
+			meshlet.indexOffset += submesh.indexOffset;
+		geometry.meshlets.insert(geometry.meshlets.end(), meshlets.begin(), meshlets.end());
+	}
+}
+
+size_t MeshBuilder::GetSubmeshesPerLevel(const MeshGeometry& geometry)
+{
+	return geometry.submeshes.size() / (geometry.lods.empty() ? 1 : geometry.lods.size());
+}
+
+bool MeshBuilder::ValidatePositionStream(const MeshGeometry& geometry)
+{
+	if (geometry.positionIndices.size() != geometry.indices.size())
+		return false;
+
+	for (size_t i = 0; i < geometry.indices.size(); i++) {
+		unsigned int position = geometry.positionIndices[i];
+		if (position >= geometry.positions.size() ||
+			memcmp(&geometry.positions[position], &geometry.vertices[geometry.indices[i]].Position, sizeof(XMFLOAT3)) != 0)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+#include "ObjParser.h"
+#include "MeshletBuilder.h"
+
+// One level of detail: a range of the index buffer, sharing the mesh's vertices.
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;			// How far (in model units) this level strays from the full detail one.
+};
+
+// A range of the index buffer drawn with one material.
+// - Every level of detail has one for each material, in the same order,
+//   so level L's are submeshes[L * count, (L + 1) * count).
+// - Fixed size, so cooked files can hold them as they are.
+struct MeshSubmesh
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	char material[56];		// The OBJ "usemtl" name (cut short if it doesn't fit)
+};
+
+// How a chain of levels of detail is built (see MeshSimplifier::BuildLodChain).
+struct LodSettings
+{
+	uint32_t maxLevels = 4;			// Including the full detail one.
+	float triangleRatio = 0.5f;		// Triangles of each level, relative to the one before.
+	float maxError = 0.05f;			// Largest error of any level, relative to the mesh's bounding radius.
+};
+
+// CPU-side geometry, ready to have tangents calculated and be uploaded.
+// - Levels of detail, if any, are appended to the indices after the
+//   full detail ones (which are always lods[0] when there are any).
+// - Meshlets, if any, split up the full detail indices.
+// - Submeshes, if any, split up every level by material (and a
+//   meshlet never crosses from one into another).
+// - The position stream, if any, is every distinct position once, with
+//   its own indices lined up with the others (index i of one is the
+//   same corner as index i of the other), so any range of one is the
+//   same triangles in the other.
+struct MeshGeometry
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshSubmesh> submeshes;
+	std::vector<std::string> materialLibraries;		// The OBJ's "mtllib" files, for the submeshes' materials
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<unsigned int> positionIndices;
+};
+
+// Optional steps when building a mesh (kept in MeshCacheHeader::buildFlags).
+enum MeshBuildFlags : uint32_t
+{
+	MeshBuild_None = 0,
+	MeshBuild_Optimize = 1 << 0,	// Reorder for the vertex cache, overdraw and vertex fetch (see MeshOptimizer)
+	MeshBuild_Lods = 1 << 1,		// Simplify into a chain of levels of detail (see MeshSimplifier)
+	MeshBuild_Meshlets = 1 << 2,	// Split into meshlets that can be culled on their own (see MeshletBuilder)
+	MeshBuild_PositionStream = 1 << 3,	// Add a position only stream for depth passes (see MeshBuilder::BuildPositionStream)
+};
+
+// Information about how well the face corners of a mesh were welded.
+struct WeldStats
+{
+	size_t cornerCount = 0;		// Face corners in the source (one vertex each before welding).
+	size_t vertexCount = 0;		// Unique vertices after welding.
+
+	// Average number of corners sharing each vertex (1.0 means no reuse at all).
+	double GetReuseRatio() const;
+};
+
+// --------------------------------------------------------
+// Turns raw parsed model data into indexed geometry
+//
+// - Face corners with identical position/uv/normal are welded
+//   into a single vertex using an open-addressing hash table,
+//   so the index buffer actually reuses vertices.
+// --------------------------------------------------------
+class MeshBuilder
+{
+public:
+	// Assemble OBJ data into a welded, indexed mesh.
+	// - Converts from the OBJ (right handed, bottom left UV origin)
+	//   conventions into DirectX ones along the way.
+	// - Tangents are zeroed, they still need to be calculated.
+	// - If the file uses materials, the triangles are grouped by material
+	//   (in the order they're first used) into one submesh each.
+	static void BuildFromObj(const ObjData& obj, MeshGeometry& out, WeldStats* stats = nullptr);
+
+	// Parse, weld and calculate the tangents of an OBJ file in one go.
+	// - Returns false if the file can't be opened.
+	static bool BuildFromObjFile(const char* pathToFile, MeshGeometry& out, WeldStats* stats = nullptr);
+
+	// Calculates (and overwrites) the tangents of the given vertices.
+	static void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+
+	// Split the full detail level into meshlets, one submesh at a time.
+	static void BuildMeshlets(MeshGeometry& geometry);
+
+	// The number of submeshes each level of detail has (0 if it has none).
+	static size_t GetSubmeshesPerLevel(const MeshGeometry& geometry);
+
+	// Build the position stream of some geometry: its vertices welded by
+	// position alone, in the order the indices first use them.
+	// - Run it after anything that reorders the indices.
+	// - stats count the vertices as corners and the positions as vertices.
+	static void BuildPositionStream(MeshGeometry& geometry, WeldStats* stats = nullptr);
+
+	// True if every corner of the position stream is exactly where the same corner of the full vertices is.
+	static bool ValidatePositionStream(const MeshGeometry& geometry);
+};
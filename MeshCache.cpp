@@ -0,0 +1,297 @@
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const char Magic[4] = { 'M', 'E', 'S', 'H' };
+
+	// Sections of the file start on 16 byte boundaries.
+	inline uint64_t AlignUp(uint64_t value) { return (value + 15) & ~(uint64_t)15; }
+
+	inline uint64_t RotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+	// Final mix of the hash so every input bit affects every output bit.
+	inline uint64_t Avalanche(uint64_t hash)
+	{
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdULL;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ULL;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	// Pads the stream with zeros up to the given offset.
+	void PadTo(std::ofstream& out, uint64_t offset)
+	{
+		const char zeros[16] = {};
+		uint64_t position = (uint64_t)out.tellp();
+		if (offset > position) out.write(zeros, (std::streamsize)(offset - position));
+	}
+}
+
+
+MeshCacheFile::MeshCacheFile(const char* pathToFile)
+	: m_file(pathToFile)
+{
+	m_header = nullptr;
+	m_data = m_file.GetData();
+	m_size = m_file.GetSize();
+	if (!m_file.IsOpen())
+		return;
+
+	// A compressed file has to be inflated into memory of its own first
+	m_readStats.compression = CompressedStream::DetectCompression(m_data, m_size);
+	if (m_readStats.compression != StreamCompression_None) {
+		if (!CompressedStream::ReadFile(pathToFile, m_inflated, &m_readStats.stream))
+			return;
+		m_data = m_inflated.data();
+		m_size = m_inflated.size();
+	}
+	else {
+		m_readStats.stream.fileBytes = m_size;
+		m_readStats.stream.bytes = m_size;
+	}
+	if (m_size < sizeof(MeshCacheHeader))
+		return;
+
+	// Check everything before trusting any of the offsets.
+	const MeshCacheHeader* header = (const MeshCacheHeader*)m_data;
+	uint64_t size = m_size;
+	if (memcmp(header->magic, Magic, sizeof(Magic)) != 0) return;
+	if (header->version != MeshCache::FormatVersion) return;
+	if (header->vertexStride != sizeof(Vertex)) return;
+	if (header->fileSize != size) return;
+	if (header->vertexOffset % 16 != 0 || header->indexOffset % 16 != 0 || header->lodOffset % 16 != 0) return;
+	if (header->vertexOffset + (uint64_t)header->vertexCount * sizeof(Vertex) > size) return;
+	if (header->indexOffset + (uint64_t)header->indexCount * sizeof(unsigned int) > size) return;
+	if (header->lodCount == 0 || header->lodOffset + (uint64_t)header->lodCount * sizeof(MeshLod) > size) return;
+	if (header->meshletOffset % 16 != 0 || header->meshletOffset + (uint64_t)header->meshletCount * sizeof(Meshlet) > size) return;
+	if (header->submeshOffset % 16 != 0 || header->submeshOffset + (uint64_t)header->submeshCount * sizeof(MeshSubmesh) > size) return;
+	if (header->submeshCount % header->lodCount != 0) return;
+	if (header->materialLibraryOffset + header->materialLibraryBytes > size) return;
+	if (header->materialLibraryBytes > 0 && m_data[header->materialLibraryOffset + header->materialLibraryBytes - 1] != '\0') return;
+	if (header->positionCount > 0) {
+		if (header->positionOffset % 16 != 0 || header->positionOffset + (uint64_t)header->positionCount * sizeof(XMFLOAT3) > size) return;
+		if (header->positionIndexOffset % 16 != 0 || header->positionIndexOffset + (uint64_t)header->indexCount * sizeof(unsigned int) > size) return;
+	}
+
+	// Every level has to fit in the indices
+	const MeshLod* lods = (const MeshLod*)(m_data + header->lodOffset);
+	for (uint32_t i = 0; i < header->lodCount; i++) {
+		if ((uint64_t)lods[i].indexOffset + lods[i].indexCount > header->indexCount) return;
+	}
+
+	// And every meshlet
+	const Meshlet* meshlets = (const Meshlet*)(m_data + header->meshletOffset);
+	for (uint32_t i = 0; i < header->meshletCount; i++) {
+		if ((uint64_t)meshlets[i].indexOffset + (uint64_t)meshlets[i].triangleCount * 3 > header->indexCount) return;
+	}
+
+	// And every submesh
+	const MeshSubmesh* submeshes = (const MeshSubmesh*)(m_data + header->submeshOffset);
+	for (uint32_t i = 0; i < header->submeshCount; i++) {
+		if ((uint64_t)submeshes[i].indexOffset + submeshes[i].indexCount > header->indexCount) return;
+	}
+
+	// And every position index
+	if (header->positionCount > 0) {
+		const unsigned int* positionIndices = (const unsigned int*)(m_data + header->positionIndexOffset);
+		for (uint32_t i = 0; i < header->indexCount; i++) {
+			if (positionIndices[i] >= header->positionCount) return;
+		}
+	}
+
+	m_header = header;
+}
+
+bool MeshCacheFile::IsValid() const { return m_header != nullptr; }
+const MeshCacheHeader* MeshCacheFile::GetHeader() const { return m_header; }
+const MeshCacheReadStats& MeshCacheFile::GetReadStats() const { return m_readStats; }
+const Vertex* MeshCacheFile::GetVertices() const { return (const Vertex*)(m_data + m_header->vertexOffset); }
+const unsigned int* MeshCacheFile::GetIndices() const { return (const unsigned int*)(m_data + m_header->indexOffset); }
+const MeshLod* MeshCacheFile::GetLods() const { return (const MeshLod*)(m_data + m_header->lodOffset); }
+const Meshlet* MeshCacheFile::GetMeshlets() const { return (const Meshlet*)(m_data + m_header->meshletOffset); }
+const XMFLOAT3* MeshCacheFile::GetPositions() const { return (const XMFLOAT3*)(m_data + m_header->positionOffset); }
+const unsigned int* MeshCacheFile::GetPositionIndices() const { return (const unsigned int*)(m_data + m_header->positionIndexOffset); }
+const MeshSubmesh* MeshCacheFile::GetSubmeshes() const { return (const MeshSubmesh*)(m_data + m_header->submeshOffset); }
+
+std::vector<std::string> MeshCacheFile::GetMaterialLibraries() const
+{
+	std::vector<std::string> libraries;
+	const char* name = m_data + m_header->materialLibraryOffset;
+	const char* end = name + m_header->materialLibraryBytes;
+	for (; name < end; name += strlen(name) + 1)
+		libraries.push_back(name);
+	return libraries;
+}
+
+
+std::string MeshCache::GetCachePath(const char* sourcePath)
+{
+	return std::string(sourcePath) + ".meshcache";
+}
+
+uint64_t MeshCache::HashContents(const char* data, size_t size)
+{
+	const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+	const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+	uint64_t hash = prime1 ^ (size * prime2);
+
+	// Eight bytes at a time
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash ^= RotateLeft(word * prime2, 31) * prime1;
+		hash = RotateLeft(hash, 27) * prime1 + prime2;
+	}
+
+	// Then whatever is left over
+	for (; i < size; i++) {
+		hash ^= (uint64_t)(unsigned char)data[i] * prime1;
+		hash = RotateLeft(hash, 11) * prime2;
+	}
+
+	return Avalanche(hash);
+}
+
+bool MeshCache::HashFile(const char* pathToFile, uint64_t* hash)
+{
+	MappedFile file(pathToFile);
+	if (!file.IsOpen())
+		return false;
+
+	*hash = HashContents(file.GetData(), file.GetSize());
+	return true;
+}
+
+bool MeshCache::MatchesBuild(const MeshCacheHeader& header, uint32_t buildFlags, const LodSettings& lodSettings)
+{
+	if (header.buildFlags != buildFlags)
+		return false;
+	if (!(buildFlags & MeshBuild_Lods))
+		return true;
+
+	return header.lodSettings.maxLevels == lodSettings.maxLevels &&
+		header.lodSettings.triangleRatio == lodSettings.triangleRatio &&
+		header.lodSettings.maxError == lodSettings.maxError;
+}
+
+bool MeshCache::Write(const char* pathToFile, uint64_t sourceHash, uint32_t buildFlags, const LodSettings& lodSettings, const MeshGeometry& geometry)
+{
+	// Plain meshes still get a (full detail) level
+	std::vector<MeshLod> lods(geometry.lods);
+	if (lods.empty())
+		lods.push_back(MeshLod{ 0, (uint32_t)geometry.indices.size(), 0.0f });
+
+	MeshCacheHeader header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = FormatVersion;
+	header.sourceHash = sourceHash;
+	header.buildFlags = buildFlags;
+	if (buildFlags & MeshBuild_Lods)
+		header.lodSettings = lodSettings;
+	header.vertexStride = sizeof(Vertex);
+	header.vertexCount = (uint32_t)geometry.vertices.size();
+	header.indexCount = (uint32_t)geometry.indices.size();
+	header.lodCount = (uint32_t)lods.size();
+	header.meshletCount = (uint32_t)geometry.meshlets.size();
+	header.positionCount = (uint32_t)geometry.positions.size();
+	header.submeshCount = (uint32_t)geometry.submeshes.size();
+	header.vertexOffset = AlignUp(sizeof(MeshCacheHeader));
+	header.indexOffset = AlignUp(header.vertexOffset + (uint64_t)header.vertexCount * sizeof(Vertex));
+	header.lodOffset = AlignUp(header.indexOffset + (uint64_t)header.indexCount * sizeof(unsigned int));
+	header.meshletOffset = AlignUp(header.lodOffset + (uint64_t)header.lodCount * sizeof(MeshLod));
+	header.positionOffset = AlignUp(header.meshletOffset + (uint64_t)header.meshletCount * sizeof(Meshlet));
+	header.positionIndexOffset = AlignUp(header.positionOffset + (uint64_t)header.positionCount * sizeof(XMFLOAT3));
+	header.submeshOffset = AlignUp(header.positionCount > 0 ? header.positionIndexOffset + (uint64_t)header.indexCount * sizeof(unsigned int) : header.positionOffset);
+	header.materialLibraryOffset = header.submeshOffset + (uint64_t)header.submeshCount * sizeof(MeshSubmesh);
+	for (const std::string& library : geometry.materialLibraries)
+		header.materialLibraryBytes += (uint32_t)library.size() + 1;
+	header.fileSize = header.materialLibraryOffset + header.materialLibraryBytes;
+
+	// Bounds of the positions
+	XMVECTOR boundsMin = XMVectorReplicate(geometry.vertices.empty() ? 0.0f : FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(geometry.vertices.empty() ? 0.0f : -FLT_MAX);
+	for (const Vertex& v : geometry.vertices) {
+		XMVECTOR pos = XMLoadFloat3(&v.Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+	XMStoreFloat3(&header.boundsMin, boundsMin);
+	XMStoreFloat3(&header.boundsMax, boundsMax);
+
+	// Write everything to a temporary file
+	std::string tempPath = std::string(pathToFile) + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		PadTo(out, header.vertexOffset);
+		if (header.vertexCount > 0)
+			out.write((const char*)geometry.vertices.data(), (std::streamsize)(header.vertexCount * sizeof(Vertex)));
+		PadTo(out, header.indexOffset);
+		if (header.indexCount > 0)
+			out.write((const char*)geometry.indices.data(), (std::streamsize)(header.indexCount * sizeof(unsigned int)));
+		PadTo(out, header.lodOffset);
+		out.write((const char*)lods.data(), (std::streamsize)(header.lodCount * sizeof(MeshLod)));
+		PadTo(out, header.meshletOffset);
+		if (header.meshletCount > 0)
+			out.write((const char*)geometry.meshlets.data(), (std::streamsize)(header.meshletCount * sizeof(Meshlet)));
+		if (header.positionCount > 0) {
+			PadTo(out, header.positionOffset);
+			out.write((const char*)geometry.positions.data(), (std::streamsize)(header.positionCount * sizeof(XMFLOAT3)));
+			PadTo(out, header.positionIndexOffset);
+			out.write((const char*)geometry.positionIndices.data(), (std::streamsize)(header.indexCount * sizeof(unsigned int)));
+		}
+		PadTo(out, header.submeshOffset);
+		if (header.submeshCount > 0)
+			out.write((const char*)geometry.submeshes.data(), (std::streamsize)(header.submeshCount * sizeof(MeshSubmesh)));
+		for (const std::string& library : geometry.materialLibraries)
+			out.write(library.c_str(), (std::streamsize)library.size() + 1);
+
+		if (!out.good()) {
+			out.close();
+			DeleteFileA(tempPath.c_str());
+			return false;
+		}
+	}
+
+	// Then swap it in for the real one
+	if (!MoveFileExA(tempPath.c_str(), pathToFile, MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileA(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::Cook(const char* sourcePath, const char* cachePath, uint32_t buildFlags, const LodSettings& lodSettings)
+{
+	uint64_t sourceHash = 0;
+	if (!HashFile(sourcePath, &sourceHash))
+		return false;
+
+	MeshGeometry geometry;
+	if (!MeshBuilder::BuildFromObjFile(sourcePath, geometry))
+		return false;
+
+	if (buildFlags & MeshBuild_Lods)
+		MeshSimplifier::BuildLodChain(geometry, lodSettings);
+	if (buildFlags & MeshBuild_Optimize)
+		MeshOptimizer::Optimize(geometry);
+	if (buildFlags & MeshBuild_Meshlets)
+		MeshBuilder::BuildMeshlets(geometry);
+	if (buildFlags & MeshBuild_PositionStream)
+		MeshBuilder::BuildPositionStream(geometry);
+
+	return Write(cachePath, sourceHash, buildFlags, lodSettings, geometry);
+}
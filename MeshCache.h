@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "Vertex.h"
+#include <vector>
+#include "MappedFile.h"
+#include "CompressedStream.h"
+#include "MeshBuilder.h"
+
+// --------------------------------------------------------
+// Header at the start of every cooked mesh file
+//
+// Layout of the file:
+//   MeshCacheHeader
+//   Vertex  vertices[vertexCount]	(at vertexOffset, 16 byte aligned)
+//   uint32  indices[indexCount]	(at indexOffset, 16 byte aligned)
+//   MeshLod lods[lodCount]		(at lodOffset, 16 byte aligned)
+//   Meshlet meshlets[meshletCount]	(at meshletOffset, 16 byte aligned)
+//   XMFLOAT3 positions[positionCount]	(at positionOffset, 16 byte aligned)
+//   uint32  positionIndices[indexCount]	(at positionIndexOffset, only if positionCount > 0)
+//   MeshSubmesh submeshes[submeshCount]	(at submeshOffset, 16 byte aligned)
+//   char    materialLibraries[materialLibraryBytes]	(at materialLibraryOffset, each name null terminated)
+//
+// - Vertices are final (welded, with tangents), so they can
+//   be handed straight to the GPU from the mapped file.
+// - There is always at least one level of detail (the full
+//   detail one, which covers the start of the indices).
+// --------------------------------------------------------
+struct MeshCacheHeader
+{
+	char magic[4];				// Always "MESH"
+	uint32_t version;			// MeshCache::FormatVersion when it was written
+	uint64_t sourceHash;		// MeshCache::HashContents of the source model file
+	uint32_t buildFlags;		// MeshBuildFlags the mesh was built with (0 = plain)
+	LodSettings lodSettings;	// How the levels of detail were built (only with MeshBuild_Lods)
+	uint32_t vertexStride;		// sizeof(Vertex) when it was written
+	uint32_t vertexCount;
+	uint32_t indexCount;		// Of all levels of detail together
+	uint32_t lodCount;
+	uint32_t meshletCount;		// 0 unless built with MeshBuild_Meshlets
+	uint32_t positionCount;		// 0 unless built with MeshBuild_PositionStream
+	uint32_t submeshCount;		// Of all levels of detail together (0 if the model has no materials)
+	uint32_t materialLibraryBytes;	// The OBJ's "mtllib" names, so the materials can be found without it
+	DirectX::XMFLOAT3 boundsMin;	// Local space bounds of the vertex positions
+	DirectX::XMFLOAT3 boundsMax;
+	uint64_t vertexOffset;		// Byte offsets from the start of the file
+	uint64_t indexOffset;
+	uint64_t lodOffset;
+	uint64_t meshletOffset;
+	uint64_t positionOffset;
+	uint64_t positionIndexOffset;
+	uint64_t submeshOffset;
+	uint64_t materialLibraryOffset;
+	uint64_t fileSize;			// Total size, to catch truncated files
+};
+
+// How a cooked mesh file was read.
+struct MeshCacheReadStats
+{
+	StreamCompression compression = StreamCompression_None;
+	StreamStats stream;		// Only timed for compressed files (mapped ones are paged in as they're used)
+};
+
+// --------------------------------------------------------
+// A cooked mesh file, mapped read only
+//
+// - Nothing is parsed or copied, the vertex and index pointers
+//   point straight into the mapped file.
+// - Unless it's gzip compressed (found from its contents, not its
+//   name): then it's inflated a block at a time into memory of
+//   its own, and the pointers point there instead.
+// --------------------------------------------------------
+class MeshCacheFile
+{
+public:
+	MeshCacheFile(const char* pathToFile);
+
+	// True if the file exists, is the current format version
+	// and isn't truncated or otherwise malformed.
+	bool IsValid() const;
+
+	// Getters (only meaningful when valid)
+	const MeshCacheHeader* GetHeader() const;
+	const Vertex* GetVertices() const;
+	const unsigned int* GetIndices() const;
+	const MeshLod* GetLods() const;
+	const Meshlet* GetMeshlets() const;
+	const DirectX::XMFLOAT3* GetPositions() const;
+	const unsigned int* GetPositionIndices() const;
+	const MeshSubmesh* GetSubmeshes() const;
+	std::vector<std::string> GetMaterialLibraries() const;	// Copied out (see MeshGeometry::materialLibraries)
+	const MeshCacheReadStats& GetReadStats() const;
+
+private:
+	MappedFile m_file;
+	std::vector<char> m_inflated;		// The whole file, if it was compressed
+	const char* m_data;				// The mapped file or m_inflated
+	size_t m_size;
+	MeshCacheReadStats m_readStats;
+	const MeshCacheHeader* m_header;
+};
+
+// --------------------------------------------------------
+// Reading and writing of cooked (binary) mesh files
+// --------------------------------------------------------
+class MeshCache
+{
+public:
+	// Bump this whenever the file layout, the Vertex struct or the way
+	// the cooked data is calculated changes.
+	// - 2: degenerate triangles no longer give NaN tangents
+	// - 3: levels of detail
+	// - 4: meshlets
+	// - 5: position streams
+	// - 6: submeshes
+	// - 7: material library names
+	static const uint32_t FormatVersion = 7;
+
+	// The cooked file that goes with a source model ("model.obj" -> "model.obj.meshcache").
+	static std::string GetCachePath(const char* sourcePath);
+
+	// 64 bit hash of a file's contents, used to key the cache to its source.
+	static uint64_t HashContents(const char* data, size_t size);
+	static bool HashFile(const char* pathToFile, uint64_t* hash);
+
+	// Write a cooked mesh file (to a temporary file first, so readers never see half a file).
+	static bool Write(const char* pathToFile, uint64_t sourceHash, uint32_t buildFlags, const LodSettings& lodSettings, const MeshGeometry& geometry);
+
+	// Parse an OBJ and write its cooked version (buildFlags are MeshBuildFlags).
+	static bool Cook(const char* sourcePath, const char* cachePath, uint32_t buildFlags = MeshBuild_None, const LodSettings& lodSettings = LodSettings());
+
+	// True if a cooked file was built the way the given flags and settings ask for.
+	static bool MatchesBuild(const MeshCacheHeader& header, uint32_t buildFlags, const LodSettings& lodSettings);
+};
@@ -0,0 +1,419 @@
+#include "MeshOptimizer.h"
+#include <Windows.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Size of the LRU cache that Forsyth's scoring models.
+	const int ModelCacheSize = 32;
+
+	// Tuning values from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// Remaining valences with a precalculated score.
+	const unsigned int MaxValenceScore = 32;
+
+	// Marks "no triangle" and "no vertex".
+	const unsigned int None = 0xFFFFFFFF;
+
+	// Scores of a vertex for every cache position and (small) remaining valence.
+	struct ScoreTable
+	{
+		float cache[ModelCacheSize];
+		float valence[MaxValenceScore];
+
+		ScoreTable()
+		{
+			for (int i = 0; i < ModelCacheSize; i++) {
+				// The three vertices of the last triangle get a fixed score,
+				// so there's no preference for which way round it continues
+				cache[i] = (i < 3) ? LastTriangleScore :
+					powf(1.0f - (i - 3) * (1.0f / (ModelCacheSize - 3)), CacheDecayPower);
+			}
+			for (unsigned int i = 0; i < MaxValenceScore; i++)
+				valence[i] = (i == 0) ? 0.0f : ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+		}
+
+		// How much a vertex wants its triangles drawn next.
+		// - Low valences are boosted, so lone triangles get finished off
+		//   rather than left behind for a cache miss later.
+		float Score(int cachePosition, unsigned int remainingValence) const
+		{
+			if (remainingValence == 0) return -1.0f;
+
+			float score = (cachePosition >= 0 && cachePosition < ModelCacheSize) ? cache[cachePosition] : 0.0f;
+			score += (remainingValence < MaxValenceScore) ? valence[remainingValence] :
+				ValenceBoostScale * powf((float)remainingValence, -ValenceBoostPower);
+			return score;
+		}
+	};
+
+	// A FIFO post-transform cache.
+	// - A vertex is in the cache if fewer than "size" vertices were
+	//   added since it was, which only needs one timestamp per vertex.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, unsigned int size)
+			: m_timestamps(vertexCount, 0), m_timestamp(size + 1), m_size(size) { }
+
+		// Uses a vertex, returning 1 if it had to be transformed.
+		unsigned int Touch(unsigned int vertex)
+		{
+			if (m_timestamp - m_timestamps[vertex] <= m_size) return 0;
+			m_timestamps[vertex] = m_timestamp++;
+			return 1;
+		}
+
+		// Uses the three vertices of a triangle, returning the misses.
+		unsigned int Touch(const unsigned int* triangle)
+		{
+			return Touch(triangle[0]) + Touch(triangle[1]) + Touch(triangle[2]);
+		}
+
+		// Empties the cache.
+		void Flush() { m_timestamp += m_size + 1; }
+
+	private:
+		std::vector<size_t> m_timestamps;
+		size_t m_timestamp;
+		size_t m_size;
+	};
+}
+
+
+double VertexCacheStats::GetACMR() const
+{
+	if (triangleCount == 0) return 0.0;
+	return (double)transformCount / (double)triangleCount;
+}
+
+double VertexCacheStats::GetATVR() const
+{
+	if (vertexCount == 0) return 0.0;
+	return (double)transformCount / (double)vertexCount;
+}
+
+
+void MeshOptimizer::Optimize(MeshGeometry& geometry, MeshOptimizeStats* stats)
+{
+	LARGE_INTEGER frequency, start, stop;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	MeshOptimizeStats result;
+	size_t indexCount = geometry.indices.size();
+	size_t vertexCount = geometry.vertices.size();
+	size_t fullCount = geometry.lods.empty() ? indexCount : geometry.lods[0].indexCount;
+	result.before = AnalyzeVertexCache(geometry.indices.data(), fullCount, vertexCount);
+
+	if (indexCount >= 3 && vertexCount > 0) {
+		// Triangles only move around within their own level (and submesh)
+		std::vector<MeshLod> ranges(geometry.lods);
+		if (!geometry.submeshes.empty()) {
+			ranges.clear();
+			for (const MeshSubmesh& submesh : geometry.submeshes)
+				ranges.push_back(MeshLod{ submesh.indexOffset, submesh.indexCount, 0.0f });
+		}
+		else if (ranges.empty()) {
+			ranges.push_back(MeshLod{ 0, (uint32_t)indexCount, 0.0f });
+		}
+		for (const MeshLod& range : ranges) {
+			if (range.indexCount < 3) continue;
+			OptimizeVertexCache(&geometry.indices[range.indexOffset], range.indexCount, vertexCount);
+			OptimizeOverdraw(&geometry.indices[range.indexOffset], range.indexCount, &geometry.vertices[0], vertexCount);
+		}
+
+		// Vertices are shared by every level, so they're ordered by all of them (full detail first)
+		geometry.vertices.resize(OptimizeVertexFetch(&geometry.vertices[0], vertexCount, &geometry.indices[0], indexCount));
+	}
+
+	result.after = AnalyzeVertexCache(geometry.indices.data(), fullCount, geometry.vertices.size());
+
+	QueryPerformanceCounter(&stop);
+	result.seconds = (double)(stop.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+	if (stats != nullptr) *stats = result;
+}
+
+// Reorders triangles for the post-transform vertex cache
+// - Tom Forsyth's algorithm: every vertex gets a score from its position
+//   in a modelled LRU cache and how many triangles still need it, and
+//   the triangle with the best total score is drawn next.
+// - Only triangles touching the cache are rescored after each step, so
+//   the whole thing is (close to) linear in the number of triangles.
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	static const ScoreTable scores;
+
+	// The triangles using each vertex (the first "valence" of them are
+	// still waiting to be drawn)
+	std::vector<unsigned int> valence(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		valence[indices[i]]++;
+
+	std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + valence[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	{
+		std::vector<size_t> cursor(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			adjacency[cursor[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	// Starting scores (nothing is in the cache yet)
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScore[v] = scores.Score(-1, valence[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	unsigned int best = None;
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (best == None || triangleScore[t] > triangleScore[best])
+			best = (unsigned int)t;
+	}
+
+	std::vector<bool> drawn(triangleCount, false);
+	std::vector<unsigned int> result(triangleCount * 3);
+
+	unsigned int cache[ModelCacheSize + 3];
+	unsigned int newCache[ModelCacheSize + 3];
+	int cacheCount = 0;
+	size_t nextUndrawn = 0;
+
+	for (size_t out = 0; out < triangleCount; out++)
+	{
+		// Nothing in the cache is useful, so start on whatever is left
+		if (best == None) {
+			while (drawn[nextUndrawn]) nextUndrawn++;
+			best = (unsigned int)nextUndrawn;
+		}
+
+		const unsigned int* triangle = indices + (size_t)best * 3;
+		result[out * 3] = triangle[0];
+		result[out * 3 + 1] = triangle[1];
+		result[out * 3 + 2] = triangle[2];
+		drawn[best] = true;
+
+		// It's no longer waiting on its vertices
+		for (int corner = 0; corner < 3; corner++) {
+			unsigned int v = triangle[corner];
+			unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int i = 0; i < valence[v]; i++) {
+				if (list[i] == best) {
+					list[i] = list[valence[v] - 1];
+					break;
+				}
+			}
+			valence[v]--;
+		}
+
+		// Its vertices move to the front of the cache, pushing the rest back
+		int newCount = 0;
+		for (int corner = 0; corner < 3; corner++) {
+			unsigned int v = triangle[corner];
+			if (std::find(newCache, newCache + newCount, v) == newCache + newCount)
+				newCache[newCount++] = v;
+		}
+		int triangleVertexCount = newCount;
+		for (int i = 0; i < cacheCount; i++) {
+			unsigned int v = cache[i];
+			if (std::find(newCache, newCache + triangleVertexCount, v) == newCache + triangleVertexCount)
+				newCache[newCount++] = v;
+		}
+
+		// Rescore everything that moved (including anything that fell out)
+		for (int i = 0; i < newCount; i++) {
+			unsigned int v = newCache[i];
+			cachePosition[v] = (i < ModelCacheSize) ? i : -1;
+
+			float score = scores.Score(cachePosition[v], valence[v]);
+			float change = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			const unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < valence[v]; j++)
+				triangleScore[list[j]] += change;
+		}
+
+		cacheCount = (newCount < ModelCacheSize) ? newCount : ModelCacheSize;
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		// The best triangle touching the cache goes next
+		best = None;
+		float bestScore = -1.0f;
+		for (int i = 0; i < cacheCount; i++) {
+			unsigned int v = cache[i];
+			const unsigned int* list = &adjacency[adjacencyStart[v]];
+			for (unsigned int j = 0; j < valence[v]; j++) {
+				if (triangleScore[list[j]] > bestScore) {
+					bestScore = triangleScore[list[j]];
+					best = list[j];
+				}
+			}
+		}
+	}
+
+	std::copy(result.begin(), result.end(), indices);
+}
+
+// Reorders triangles to reduce overdraw
+// - Follows Sander et al's "Fast Triangle Reordering for Vertex Locality
+//   and Reduced Overdraw" (Tipsify): the triangles are split into
+//   clusters where the cache order already has a break (every vertex is
+//   a miss), and then further wherever a cluster's own ACMR stays under
+//   the threshold.
+// - Clusters are sorted so the ones facing out from the middle of the
+//   mesh draw first, since they're the ones most likely to hide others.
+//   The triangle order inside a cluster doesn't change.
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2 || vertexCount == 0)
+		return;
+
+	// Hard boundaries: triangles where the cache starts over anyway
+	FifoCache cache(vertexCount, DefaultCacheSize);
+	std::vector<size_t> hardBoundaries;
+	for (size_t t = 0; t < triangleCount; t++) {
+		if (cache.Touch(indices + t * 3) == 3 || t == 0)
+			hardBoundaries.push_back(t);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries: splits inside those that don't cost too many misses
+	std::vector<size_t> clusterStarts;
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+		size_t begin = hardBoundaries[h];
+		size_t end = hardBoundaries[h + 1];
+
+		// The ACMR of the whole cluster
+		cache.Flush();
+		size_t misses = 0;
+		for (size_t t = begin; t < end; t++)
+			misses += cache.Touch(indices + t * 3);
+		double limit = threshold * (double)misses / (double)(end - begin);
+
+		// Split off the start of the cluster as soon as it's under the limit on its own
+		cache.Flush();
+		clusterStarts.push_back(begin);
+		size_t start = begin;
+		misses = 0;
+		for (size_t t = begin; t < end; t++) {
+			misses += cache.Touch(indices + t * 3);
+			if (t + 1 < end && (double)misses / (double)(t + 1 - start) <= limit) {
+				clusterStarts.push_back(t + 1);
+				start = t + 1;
+				misses = 0;
+				cache.Flush();
+			}
+		}
+	}
+	size_t clusterCount = clusterStarts.size();
+	clusterStarts.push_back(triangleCount);
+
+	// Middle of the mesh
+	XMVECTOR meshCenter = XMVectorZero();
+	for (size_t v = 0; v < vertexCount; v++)
+		meshCenter = XMVectorAdd(meshCenter, XMLoadFloat3(&vertices[v].Position));
+	meshCenter = XMVectorScale(meshCenter, 1.0f / (float)vertexCount);
+
+	// Sort key of each cluster: how far its (area weighted) center
+	// is along its (area weighted) normal from the middle of the mesh
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		XMVECTOR center = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+
+			// Clockwise front faces in a left handed space, so this points out of the front
+			XMVECTOR cross = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float triangleArea = XMVectorGetX(XMVector3Length(cross));
+
+			center = XMVectorAdd(center, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), triangleArea / 3.0f));
+			normal = XMVectorAdd(normal, cross);
+			area += triangleArea;
+		}
+
+		if (area <= 0.0f) {
+			sortKeys[c] = 0.0f;
+			continue;
+		}
+
+		center = XMVectorScale(center, 1.0f / area);
+		normal = XMVector3Normalize(normal);
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, meshCenter), normal));
+	}
+
+	// Outward facing clusters first (stable, so ties keep the cache order)
+	std::vector<unsigned int> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = (unsigned int)c;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+	for (unsigned int c : order)
+		result.insert(result.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+
+	std::copy(result.begin(), result.end(), indices);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	// New number of every vertex, handed out as they're first used
+	std::vector<unsigned int> remap(vertexCount, None);
+	std::vector<Vertex> result;
+	result.reserve(vertexCount);
+
+	for (size_t i = 0; i < indexCount; i++) {
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == None) {
+			newIndex = (unsigned int)result.size();
+			result.push_back(vertices[indices[i]]);
+		}
+		indices[i] = newIndex;
+	}
+
+	std::copy(result.begin(), result.end(), vertices);
+	return result.size();
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	stats.triangleCount = indexCount / 3;
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	for (size_t i = 0; i < stats.triangleCount * 3; i++) {
+		stats.transformCount += cache.Touch(indices[i]);
+		if (!used[indices[i]]) {
+			used[indices[i]] = true;
+			stats.vertexCount++;
+		}
+	}
+
+	return stats;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Vertex.h"
+#include "MeshBuilder.h"
+
+// How well an index buffer uses a (simulated) post-transform vertex cache.
+struct VertexCacheStats
+{
+	size_t triangleCount = 0;
+	size_t vertexCount = 0;			// Vertices referenced by the indices.
+	size_t transformCount = 0;		// Cache misses, i.e. vertex shader runs.
+
+	// Average cache miss ratio: vertex shader runs per triangle (3.0 is the worst, ~0.5 the best).
+	double GetACMR() const;
+
+	// Average transform to vertex ratio: vertex shader runs per vertex (1.0 is the best).
+	double GetATVR() const;
+};
+
+// Results of a full optimization pass.
+struct MeshOptimizeStats
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+	double seconds = 0.0;
+};
+
+// --------------------------------------------------------
+// Reorders indexed geometry so the GPU does less work
+//
+// - Triangles are reordered for the post-transform vertex
+//   cache (Forsyth's linear-speed algorithm), then clusters of
+//   them are sorted so outward facing ones draw first and hide
+//   the rest (Tipsify-style overdraw reduction).
+// - Vertices are then renumbered into the order the indices
+//   first use them, so fetching them walks through memory.
+// - Nothing is added or removed (except unused vertices), so
+//   the mesh looks exactly the same.
+// - The cache simulator below measures all of this on the CPU.
+// --------------------------------------------------------
+class MeshOptimizer
+{
+public:
+	// Size of the FIFO cache the stats are measured with.
+	static const unsigned int DefaultCacheSize = 16;
+
+	// Runs all three passes below, in order, on the geometry.
+	// - Each level of detail (and submesh) is reordered on its own, and the stats
+	//   are for the full detail one.
+	static void Optimize(MeshGeometry& geometry, MeshOptimizeStats* stats = nullptr);
+
+	// Reorder triangles for the post-transform vertex cache.
+	static void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+	// Reorder clusters of triangles to reduce overdraw.
+	// - Expects indices that were already optimized for the vertex cache.
+	// - threshold is how much worse the ACMR is allowed to get (1.05 = 5%)
+	//   in exchange for smaller clusters that can sort more freely.
+	static void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold = 1.05f);
+
+	// Renumber vertices in the order the indices first use them (dropping unused ones).
+	// - Returns the new number of vertices.
+	static size_t OptimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount);
+
+	// Run the indices through a simulated FIFO post-transform cache.
+	static VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DefaultCacheSize);
+};
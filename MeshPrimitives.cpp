@@ -0,0 +1,450 @@
+#include "MeshPrimitives.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	// Tessellation after raising it to what each shape needs.
+	struct Tessellation
+	{
+		uint32_t slices;
+		uint32_t stacks;
+		uint32_t subdivisions;
+	};
+
+	Tessellation GetTessellation(const PrimitiveSettings& settings)
+	{
+		Tessellation t;
+		t.slices = settings.slices < 3 ? 3 : settings.slices;
+		t.subdivisions = settings.subdivisions < 1 ? 1 : settings.subdivisions;
+
+		uint32_t minStacks = 1;
+		if (settings.shape == PrimitiveShape_Sphere) minStacks = 2;
+		if (settings.shape == PrimitiveShape_Torus) minStacks = 3;
+		t.stacks = settings.stacks < minStacks ? minStacks : settings.stacks;
+		return t;
+	}
+
+	// cos and sin of every step around a circle, and once more for the seam.
+	// - Build and GetBounds both use these, so the bounds come out exactly
+	//   the same as the vertices.
+	// - The seam repeats the first step exactly (2 pi doesn't quite give a
+	//   sin of 0), so its vertices land on the same positions.
+	struct Circle
+	{
+		std::vector<double> cos;
+		std::vector<double> sin;
+		double minCos = 1.0, maxCos = -1.0;
+		double minSin = 1.0, maxSin = -1.0;
+	};
+
+	Circle GetCircle(uint32_t count)
+	{
+		Circle circle;
+		circle.cos.resize(count + 1);
+		circle.sin.resize(count + 1);
+		for (uint32_t i = 0; i < count; i++) {
+			double angle = 2.0 * Pi * i / count;
+			circle.cos[i] = cos(angle);
+			circle.sin[i] = sin(angle);
+			circle.minCos = fmin(circle.minCos, circle.cos[i]);
+			circle.maxCos = fmax(circle.maxCos, circle.cos[i]);
+			circle.minSin = fmin(circle.minSin, circle.sin[i]);
+			circle.maxSin = fmax(circle.maxSin, circle.sin[i]);
+		}
+		circle.cos[count] = circle.cos[0];
+		circle.sin[count] = circle.sin[0];
+		return circle;
+	}
+
+	// sin of the angle from the top pole of ring i of a sphere (exactly 0 at both poles).
+	inline double GetRingSin(uint32_t i, uint32_t stacks)
+	{
+		return (i == 0 || i == stacks) ? 0.0 : sin(Pi * i / stacks);
+	}
+
+	void AddVertex(MeshGeometry& out, double x, double y, double z, double nx, double ny, double nz, double u, double v)
+	{
+		Vertex vertex;
+		vertex.Position = XMFLOAT3((float)x, (float)y, (float)z);
+		vertex.Normal = XMFLOAT3((float)nx, (float)ny, (float)nz);
+		vertex.UV = XMFLOAT2((float)u, (float)v);
+		vertex.Tangent = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		out.vertices.push_back(vertex);
+	}
+
+	// Adds a triangle, wound so it faces the way its vertices' normals do
+	// (clockwise from the front). Triangles with no area are left out.
+	void AddTriangle(MeshGeometry& out, unsigned int a, unsigned int b, unsigned int c)
+	{
+		const Vertex& va = out.vertices[a];
+		const Vertex& vb = out.vertices[b];
+		const Vertex& vc = out.vertices[c];
+		float abx = vb.Position.x - va.Position.x, aby = vb.Position.y - va.Position.y, abz = vb.Position.z - va.Position.z;
+		float acx = vc.Position.x - va.Position.x, acy = vc.Position.y - va.Position.y, acz = vc.Position.z - va.Position.z;
+		float faceX = aby * acz - abz * acy;
+		float faceY = abz * acx - abx * acz;
+		float faceZ = abx * acy - aby * acx;
+		if (faceX == 0.0f && faceY == 0.0f && faceZ == 0.0f)
+			return;
+
+		float facing =
+			faceX * (va.Normal.x + vb.Normal.x + vc.Normal.x) +
+			faceY * (va.Normal.y + vb.Normal.y + vc.Normal.y) +
+			faceZ * (va.Normal.z + vb.Normal.z + vc.Normal.z);
+		bool flip = facing < 0.0f;
+
+		out.indices.push_back(a);
+		out.indices.push_back(flip ? c : b);
+		out.indices.push_back(flip ? b : c);
+	}
+
+	// Drops vertices no triangle uses (the corner of a pole's row whose
+	// triangles had no area), keeping the rest in order.
+	void RemoveUnusedVertices(MeshGeometry& out)
+	{
+		const unsigned int Unused = 0xffffffff;
+		std::vector<unsigned int> remap(out.vertices.size(), Unused);
+		for (unsigned int index : out.indices)
+			remap[index] = 0;
+
+		unsigned int used = 0;
+		for (size_t i = 0; i < out.vertices.size(); i++) {
+			if (remap[i] == Unused)
+				continue;
+			remap[i] = used;
+			out.vertices[used++] = out.vertices[i];
+		}
+		out.vertices.resize(used);
+		for (unsigned int& index : out.indices)
+			index = remap[index];
+	}
+
+	// Two triangles for every cell of a grid of vertices, starting at "first" and
+	// laid out row by row with columns + 1 vertices in each.
+	void AddGrid(MeshGeometry& out, unsigned int first, uint32_t rows, uint32_t columns)
+	{
+		for (uint32_t row = 0; row < rows; row++) {
+			for (uint32_t column = 0; column < columns; column++) {
+				unsigned int a = first + row * (columns + 1) + column;
+				unsigned int b = a + 1;
+				unsigned int c = a + columns + 1;
+				unsigned int d = c + 1;
+				AddTriangle(out, a, b, c);
+				AddTriangle(out, b, d, c);
+			}
+		}
+	}
+
+	// One face of a cube (or a plane): a grid on the square "size" across, "distance"
+	// along the normal n, with u running along uAxis and v along vAxis.
+	void AddFace(MeshGeometry& out, XMFLOAT3 n, XMFLOAT3 uAxis, XMFLOAT3 vAxis, double size, double distance, uint32_t subdivisions)
+	{
+		unsigned int first = (unsigned int)out.vertices.size();
+		double half = size * 0.5;
+		for (uint32_t row = 0; row <= subdivisions; row++) {
+			double v = (double)row / subdivisions;
+			double b = half * (2.0 * v - 1.0);
+			for (uint32_t column = 0; column <= subdivisions; column++) {
+				double u = (double)column / subdivisions;
+				double a = half * (2.0 * u - 1.0);
+
+				// Each axis only ever gets one of the three terms, so edges land exactly on +-half
+				AddVertex(out,
+					n.x * distance + uAxis.x * a + vAxis.x * b,
+					n.y * distance + uAxis.y * a + vAxis.y * b,
+					n.z * distance + uAxis.z * a + vAxis.z * b,
+					n.x, n.y, n.z, u, v);
+			}
+		}
+		AddGrid(out, first, subdivisions, subdivisions);
+	}
+
+	void BuildCube(const PrimitiveSettings& settings, const Tessellation& t, MeshGeometry& out)
+	{
+		// Normal, then the directions u and v run in (right and down, seen from outside)
+		const XMFLOAT3 faces[6][3] = {
+			{ XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1), XMFLOAT3(0, -1, 0) },
+			{ XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 0, -1), XMFLOAT3(0, -1, 0) },
+			{ XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1) },
+			{ XMFLOAT3(0, -1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, 1) },
+			{ XMFLOAT3(0, 0, 1), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, -1, 0) },
+			{ XMFLOAT3(0, 0, -1), XMFLOAT3(1, 0, 0), XMFLOAT3(0, -1, 0) },
+		};
+		for (int face = 0; face < 6; face++)
+			AddFace(out, faces[face][0], faces[face][1], faces[face][2], settings.size, settings.size * 0.5, t.subdivisions);
+	}
+
+	// u of a vertex in a row of a grid that's all one point (a pole or a cone's tip).
+	// - Each of them ends up in one triangle (see AddGrid), so it gets the u of
+	//   the middle of that triangle's slice, instead of an edge.
+	inline double GetPointU(uint32_t slice, uint32_t slices, bool top)
+	{
+		return (top ? slice - 0.5 : slice + 0.5) / slices;
+	}
+
+	void BuildSphere(const PrimitiveSettings& settings, const Tessellation& t, MeshGeometry& out)
+	{
+		double r = settings.radius;
+		Circle around = GetCircle(t.slices);
+		out.vertices.reserve((t.stacks + 1) * (t.slices + 1));
+		out.indices.reserve(t.stacks * t.slices * 6);
+		for (uint32_t ring = 0; ring <= t.stacks; ring++) {
+			double ringSin = GetRingSin(ring, t.stacks);
+			double ringCos = cos(Pi * ring / t.stacks);
+			for (uint32_t slice = 0; slice <= t.slices; slice++) {
+				double c = around.cos[slice];
+				double s = around.sin[slice];
+				AddVertex(out, r * ringSin * c, r * ringCos, r * ringSin * s,
+					ringSin * c, ringCos, ringSin * s,
+					ring == 0 ? GetPointU(slice, t.slices, true) : ring == t.stacks ? GetPointU(slice, t.slices, false) : (double)slice / t.slices,
+					(double)ring / t.stacks);
+			}
+		}
+		AddGrid(out, 0, t.stacks, t.slices);
+	}
+
+	// A flat disc closing off one end of a cylinder or cone, facing up or down.
+	void AddCap(MeshGeometry& out, double radius, double y, double normalY, const Circle& around, uint32_t slices)
+	{
+		unsigned int center = (unsigned int)out.vertices.size();
+		AddVertex(out, 0.0, y, 0.0, 0.0, normalY, 0.0, 0.5, 0.5);
+		for (uint32_t slice = 0; slice <= slices; slice++) {
+			double c = around.cos[slice];
+			double s = around.sin[slice];
+			AddVertex(out, radius * c, y, radius * s, 0.0, normalY, 0.0, 0.5 + 0.5 * c, 0.5 - 0.5 * s * normalY);
+		}
+		for (uint32_t slice = 0; slice < slices; slice++)
+			AddTriangle(out, center, center + 1 + slice, center + 2 + slice);
+	}
+
+	// The side of a cylinder (topRadius == radius) or a cone (topRadius == 0).
+	void BuildTube(const PrimitiveSettings& settings, const Tessellation& t, double topRadius, MeshGeometry& out)
+	{
+		double r = settings.radius;
+		double h = settings.height;
+
+		// Slope of the side, so the normals lean up by as much as it leans in
+		double slope = (r - topRadius) / h;
+		double normalScale = 1.0 / sqrt(1.0 + slope * slope);
+		Circle around = GetCircle(t.slices);
+
+		for (uint32_t ring = 0; ring <= t.stacks; ring++) {
+			double along = (double)ring / t.stacks;
+			double ringRadius = topRadius + (r - topRadius) * along;
+			double y = h * 0.5 - h * along;
+			for (uint32_t slice = 0; slice <= t.slices; slice++) {
+				double c = around.cos[slice];
+				double s = around.sin[slice];
+				AddVertex(out, ringRadius * c, y, ringRadius * s,
+					c * normalScale, slope * normalScale, s * normalScale,
+					(topRadius == 0.0 && ring == 0) ? GetPointU(slice, t.slices, true) : (double)slice / t.slices, along);
+			}
+		}
+		AddGrid(out, 0, t.stacks, t.slices);
+
+		if (topRadius > 0.0)
+			AddCap(out, topRadius, h * 0.5, 1.0, around, t.slices);
+		AddCap(out, r, -h * 0.5, -1.0, around, t.slices);
+	}
+
+	void BuildTorus(const PrimitiveSettings& settings, const Tessellation& t, MeshGeometry& out)
+	{
+		double radius = settings.radius;
+		double tube = settings.tubeRadius;
+		Circle around = GetCircle(t.slices);
+		Circle across = GetCircle(t.stacks);
+		out.vertices.reserve((t.stacks + 1) * (t.slices + 1));
+		out.indices.reserve(t.stacks * t.slices * 6);
+		for (uint32_t ring = 0; ring <= t.stacks; ring++) {
+			double tubeCos = across.cos[ring];
+			double tubeSin = across.sin[ring];
+			double distance = radius + tube * tubeCos;
+			for (uint32_t slice = 0; slice <= t.slices; slice++) {
+				double c = around.cos[slice];
+				double s = around.sin[slice];
+				AddVertex(out, distance * c, tube * tubeSin, distance * s,
+					tubeCos * c, tubeSin, tubeCos * s,
+					(double)slice / t.slices, (double)ring / t.stacks);
+			}
+		}
+		AddGrid(out, 0, t.stacks, t.slices);
+	}
+}
+
+
+PrimitiveSettings MeshPrimitives::Cube(float size, uint32_t subdivisions)
+{
+	PrimitiveSettings settings;
+	settings.shape = PrimitiveShape_Cube;
+	settings.size = size;
+	settings.subdivisions = subdivisions;
+	return settings;
+}
+
+PrimitiveSettings MeshPrimitives::Plane(float size, uint32_t subdivisions)
+{
+	PrimitiveSettings settings;
+	settings.shape = PrimitiveShape_Plane;
+	settings.size = size;
+	settings.subdivisions = subdivisions;
+	return settings;
+}
+
+PrimitiveSettings MeshPrimitives::Sphere(float radius, uint32_t slices, uint32_t stacks)
+{
+	PrimitiveSettings settings;
+	settings.shape = PrimitiveShape_Sphere;
+	settings.radius = radius;
+	settings.slices = slices;
+	settings.stacks = stacks;
+	return settings;
+}
+
+PrimitiveSettings MeshPrimitives::Cylinder(float radius, float height, uint32_t slices, uint32_t stacks)
+{
+	PrimitiveSettings settings;
+	settings.shape = PrimitiveShape_Cylinder;
+	settings.radius = radius;
+	settings.height = height;
+	settings.slices = slices;
+	settings.stacks = stacks;
+	return settings;
+}
+
+PrimitiveSettings MeshPrimitives::Cone(float radius, float height, uint32_t slices, uint32_t stacks)
+{
+	PrimitiveSettings settings = Cylinder(radius, height, slices, stacks);
+	settings.shape = PrimitiveShape_Cone;
+	return settings;
+}
+
+PrimitiveSettings MeshPrimitives::Torus(float radius, float tubeRadius, uint32_t slices, uint32_t stacks)
+{
+	PrimitiveSettings settings;
+	settings.shape = PrimitiveShape_Torus;
+	settings.radius = radius;
+	settings.tubeRadius = tubeRadius;
+	settings.slices = slices;
+	settings.stacks = stacks;
+	return settings;
+}
+
+void MeshPrimitives::Build(const PrimitiveSettings& settings, MeshGeometry& out)
+{
+	out = MeshGeometry();
+	Tessellation t = GetTessellation(settings);
+
+	switch (settings.shape) {
+	case PrimitiveShape_Cube: BuildCube(settings, t, out); break;
+	case PrimitiveShape_Plane: AddFace(out, XMFLOAT3(0, 1, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 0, -1), settings.size, 0.0, t.subdivisions); break;
+	case PrimitiveShape_Sphere: BuildSphere(settings, t, out); break;
+	case PrimitiveShape_Cylinder: BuildTube(settings, t, settings.radius, out); break;
+	case PrimitiveShape_Cone: BuildTube(settings, t, 0.0, out); break;
+	case PrimitiveShape_Torus: BuildTorus(settings, t, out); break;
+	}
+
+	RemoveUnusedVertices(out);
+	if (!out.indices.empty())
+		MeshBuilder::CalculateTangents(&out.vertices[0], (int)out.vertices.size(), &out.indices[0], (int)out.indices.size());
+}
+
+LocalBounds MeshPrimitives::GetBounds(const PrimitiveSettings& settings)
+{
+	Tessellation t = GetTessellation(settings);
+	Circle around = GetCircle(t.slices);
+	double boxMin[3] = {};
+	double boxMax[3] = {};
+	double sphereRadius = 0.0;
+
+	// Same expressions (and order of operations) as the vertices, so the float results match
+	switch (settings.shape) {
+	case PrimitiveShape_Cube:
+	case PrimitiveShape_Plane: {
+		double half = settings.size * 0.5;
+		for (int axis = 0; axis < 3; axis++) {
+			boxMin[axis] = -half;
+			boxMax[axis] = half;
+		}
+		if (settings.shape == PrimitiveShape_Plane)
+			boxMin[1] = boxMax[1] = 0.0;
+		sphereRadius = half * sqrt(settings.shape == PrimitiveShape_Plane ? 2.0 : 3.0);
+		break;
+	}
+	case PrimitiveShape_Sphere: {
+		double r = settings.radius;
+		double ringSin = 0.0;
+		for (uint32_t ring = 0; ring <= t.stacks; ring++)
+			ringSin = fmax(ringSin, GetRingSin(ring, t.stacks));
+		boxMin[0] = r * ringSin * around.minCos;
+		boxMax[0] = r * ringSin * around.maxCos;
+		boxMin[1] = r * cos(Pi);
+		boxMax[1] = r;
+		boxMin[2] = r * ringSin * around.minSin;
+		boxMax[2] = r * ringSin * around.maxSin;
+		sphereRadius = r;
+		break;
+	}
+	case PrimitiveShape_Cylinder:
+	case PrimitiveShape_Cone: {
+		// The base ring is the widest either way
+		double r = settings.radius;
+		double h = settings.height;
+		boxMin[0] = r * around.minCos;
+		boxMax[0] = r * around.maxCos;
+		boxMin[1] = -h * 0.5;
+		boxMax[1] = h * 0.5;
+		boxMin[2] = r * around.minSin;
+		boxMax[2] = r * around.maxSin;
+		sphereRadius = sqrt(r * r + h * h * 0.25);
+		break;
+	}
+	case PrimitiveShape_Torus: {
+		// The outside of the tube is the farthest out (for a tube no wider than the ring)
+		Circle tube = GetCircle(t.stacks);
+		double distance = settings.radius + settings.tubeRadius * tube.maxCos;
+		boxMin[0] = distance * around.minCos;
+		boxMax[0] = distance * around.maxCos;
+		boxMin[1] = settings.tubeRadius * tube.minSin;
+		boxMax[1] = settings.tubeRadius * tube.maxSin;
+		boxMin[2] = distance * around.minSin;
+		boxMax[2] = distance * around.maxSin;
+		sphereRadius = (double)settings.radius + settings.tubeRadius;
+		break;
+	}
+	}
+
+	// Rounded to float the same way the vertices are, then the center and extents of that
+	XMFLOAT3 low((float)boxMin[0], (float)boxMin[1], (float)boxMin[2]);
+	XMFLOAT3 high((float)boxMax[0], (float)boxMax[1], (float)boxMax[2]);
+	XMVECTOR lowVector = XMLoadFloat3(&low);
+	XMVECTOR highVector = XMLoadFloat3(&high);
+
+	LocalBounds bounds;
+	XMStoreFloat3(&bounds.boxCenter, XMVectorScale(XMVectorAdd(lowVector, highVector), 0.5f));
+	XMStoreFloat3(&bounds.boxExtents, XMVectorScale(XMVectorSubtract(highVector, lowVector), 0.5f));
+	bounds.sphereCenter = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	bounds.sphereRadius = (float)sphereRadius;
+	return bounds;
+}
+
+std::string MeshPrimitives::GetName(const PrimitiveSettings& settings)
+{
+	Tessellation t = GetTessellation(settings);
+	char name[64];
+	switch (settings.shape) {
+	case PrimitiveShape_Cube: snprintf(name, sizeof(name), "cube %ux%u", t.subdivisions, t.subdivisions); break;
+	case PrimitiveShape_Plane: snprintf(name, sizeof(name), "plane %ux%u", t.subdivisions, t.subdivisions); break;
+	case PrimitiveShape_Sphere: snprintf(name, sizeof(name), "sphere %ux%u", t.slices, t.stacks); break;
+	case PrimitiveShape_Cylinder: snprintf(name, sizeof(name), "cylinder %ux%u", t.slices, t.stacks); break;
+	case PrimitiveShape_Cone: snprintf(name, sizeof(name), "cone %ux%u", t.slices, t.stacks); break;
+	case PrimitiveShape_Torus: snprintf(name, sizeof(name), "torus %ux%u", t.slices, t.stacks); break;
+	default: snprintf(name, sizeof(name), "primitive"); break;
+	}
+	return name;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "MeshBounds.h"
+#include "MeshBuilder.h"
+
+// The shapes MeshPrimitives can build.
+enum PrimitiveShape
+{
+	PrimitiveShape_Cube,
+	PrimitiveShape_Plane,		// Flat on the XZ plane, facing +Y
+	PrimitiveShape_Sphere,
+	PrimitiveShape_Cylinder,	// Capped, along Y
+	PrimitiveShape_Cone,		// Capped, point up (+Y)
+	PrimitiveShape_Torus,		// Around Y
+};
+
+// What to build (see the MeshPrimitives helpers for each shape's defaults).
+// - Everything is centered on the origin.
+struct PrimitiveSettings
+{
+	PrimitiveShape shape = PrimitiveShape_Cube;
+	float size = 1.0f;			// Edge length (cube, plane)
+	float radius = 0.5f;		// Sphere, cylinder and cone radius, or distance from the center to the middle of the tube (torus)
+	float height = 1.0f;		// Cylinder, cone
+	float tubeRadius = 0.2f;	// Torus
+	uint32_t slices = 20;		// Around the Y axis (sphere, cylinder, cone, torus)
+	uint32_t stacks = 20;		// Pole to pole (sphere), around the tube (torus) or down the side (cylinder, cone)
+	uint32_t subdivisions = 1;	// Quads along each edge of a face (cube, plane)
+};
+
+// --------------------------------------------------------
+// Builds simple shapes straight into indexed geometry, with
+// no file to read or parse
+//
+// - Vertices come out final (DirectX conventions, tangents
+//   calculated), the same as MeshBuilder::BuildFromObjFile.
+// - Seams (and the rows at a sphere's poles or a cone's point)
+//   get vertices of their own, so UVs and normals don't wrap or
+//   average; triangles that would have no area are left out.
+// - Bounds are worked out from the settings alone, and match
+//   what MeshBounds::Calculate finds in the vertices exactly
+//   (checked by MeshCook primitives).
+// --------------------------------------------------------
+class MeshPrimitives
+{
+public:
+	// Settings for each shape (the defaults match the models in Assets/Models).
+	static PrimitiveSettings Cube(float size = 1.0f, uint32_t subdivisions = 1);
+	static PrimitiveSettings Plane(float size = 1.0f, uint32_t subdivisions = 1);
+	static PrimitiveSettings Sphere(float radius = 0.5f, uint32_t slices = 20, uint32_t stacks = 20);
+	static PrimitiveSettings Cylinder(float radius = 0.5f, float height = 1.0f, uint32_t slices = 20, uint32_t stacks = 1);
+	static PrimitiveSettings Cone(float radius = 0.5f, float height = 1.0f, uint32_t slices = 20, uint32_t stacks = 1);
+	static PrimitiveSettings Torus(float radius = 0.5f, float tubeRadius = 0.2f, uint32_t slices = 20, uint32_t stacks = 20);
+
+	// Build a shape (replacing anything already in "out").
+	// - Tessellation below the least a shape needs is raised to it.
+	static void Build(const PrimitiveSettings& settings, MeshGeometry& out);
+
+	// The bounds of what Build makes for these settings.
+	// - The box is exact; the sphere is centered on the origin.
+	static LocalBounds GetBounds(const PrimitiveSettings& settings);
+
+	// A short description, like "sphere 20x20".
+	static std::string GetName(const PrimitiveSettings& settings);
+};
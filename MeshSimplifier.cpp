@@ -0,0 +1,411 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Border edges are held in place by planes this much stronger than the surface ones.
+	const double BorderWeight = 10.0;
+
+	// A level has to lose at least this share of the triangles of the one before to be kept.
+	const float MinLodReduction = 0.1f;
+
+	// What each vertex is allowed to do.
+	enum VertexKind : unsigned char
+	{
+		Kind_Manifold,		// Inside a surface, can collapse onto any neighbour
+		Kind_Border,		// On an open border, can only collapse along it
+		Kind_Locked,		// On a seam (or worse), never moves
+	};
+
+	// Sum of squared distances to a set of planes, weighted by area.
+	struct Quadric
+	{
+		double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+		double weight;
+	};
+
+	Quadric PlaneQuadric(double a, double b, double c, double d, double weight)
+	{
+		Quadric q;
+		q.a2 = a * a * weight;  q.b2 = b * b * weight;  q.c2 = c * c * weight;
+		q.ab = a * b * weight;  q.ac = a * c * weight;  q.bc = b * c * weight;
+		q.ad = a * d * weight;  q.bd = b * d * weight;  q.cd = c * d * weight;
+		q.d2 = d * d * weight;
+		q.weight = weight;
+		return q;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a2 += other.a2;  q.b2 += other.b2;  q.c2 += other.c2;
+		q.ab += other.ab;  q.ac += other.ac;  q.bc += other.bc;
+		q.ad += other.ad;  q.bd += other.bd;  q.cd += other.cd;
+		q.d2 += other.d2;
+		q.weight += other.weight;
+	}
+
+	// Average squared distance of a point to the planes.
+	double QuadricError(const Quadric& q, const XMFLOAT3& p)
+	{
+		if (q.weight <= 0.0) return 0.0;
+
+		double x = p.x, y = p.y, z = p.z;
+		double rx = q.a2 * x + q.ab * y + q.ac * z;
+		double ry = q.ab * x + q.b2 * y + q.bc * z;
+		double rz = q.ac * x + q.bc * y + q.c2 * z;
+		double error = rx * x + ry * y + rz * z + 2.0 * (q.ad * x + q.bd * y + q.cd * z) + q.d2;
+		return fabs(error) / q.weight;
+	}
+
+	inline XMVECTOR LoadPosition(const Vertex* vertices, unsigned int index) { return XMLoadFloat3(&vertices[index].Position); }
+
+	// Packs a directed edge between two positions into one sortable value.
+	inline uint64_t EdgeKey(unsigned int from, unsigned int to) { return ((uint64_t)from << 32) | to; }
+
+	inline bool HasEdge(const std::vector<uint64_t>& sortedEdges, unsigned int from, unsigned int to)
+	{
+		return std::binary_search(sortedEdges.begin(), sortedEdges.end(), EdgeKey(from, to));
+	}
+
+	// Every directed edge of the triangles, by position, sorted.
+	void GatherEdges(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& positionIds, std::vector<uint64_t>& edges)
+	{
+		edges.resize(indices.size());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+			for (int e = 0; e < 3; e++) {
+				unsigned int from = positionIds[indices[t + e]];
+				unsigned int to = positionIds[indices[t + (e + 1) % 3]];
+				edges[t + e] = EdgeKey(from, to);
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+	}
+
+	// A possible collapse of one vertex onto another.
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double error;
+	};
+
+	// Would moving "from" onto "to" turn any of the (other) triangles around it over?
+	bool FlipsTriangles(const Vertex* vertices, const unsigned int* indices, const unsigned int* triangles, size_t triangleCount, unsigned int from, unsigned int to)
+	{
+		XMVECTOR target = LoadPosition(vertices, to);
+
+		for (size_t i = 0; i < triangleCount; i++) {
+			const unsigned int* triangle = indices + (size_t)triangles[i] * 3;
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				continue;	// Collapses away entirely
+
+			XMVECTOR p[3], moved[3];
+			for (int corner = 0; corner < 3; corner++) {
+				p[corner] = LoadPosition(vertices, triangle[corner]);
+				moved[corner] = (triangle[corner] == from) ? target : p[corner];
+			}
+
+			XMVECTOR before = XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0]));
+			XMVECTOR after = XMVector3Cross(XMVectorSubtract(moved[1], moved[0]), XMVectorSubtract(moved[2], moved[0]));
+			if (XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f)
+				return true;
+		}
+		return false;
+	}
+}
+
+
+// Simplifies a mesh by collapsing edges
+// - Done in passes: every possible collapse is scored, then the cheapest
+//   ones are applied, as long as none of them share a triangle (so each
+//   one is checked against the mesh as it really is).
+// - Position ids group vertices that only differ by their attributes,
+//   which is how seams and borders are found.
+float MeshSimplifier::Simplify(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+	size_t targetIndexCount, float maxError, std::vector<unsigned int>& out)
+{
+	out.assign(indices, indices + indexCount / 3 * 3);
+	if (vertexCount == 0 || out.size() <= targetIndexCount)
+		return 0.0f;
+
+	// Group vertices by position
+	std::vector<unsigned int> sorted(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		sorted[v] = (unsigned int)v;
+	auto positionLess = [&](unsigned int a, unsigned int b) {
+		const XMFLOAT3& pa = vertices[a].Position;
+		const XMFLOAT3& pb = vertices[b].Position;
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	};
+	std::sort(sorted.begin(), sorted.end(), positionLess);
+
+	std::vector<unsigned int> positionIds(vertexCount);
+	std::vector<unsigned int> wedgeCounts;
+	for (size_t i = 0; i < vertexCount; i++) {
+		if (i == 0 || positionLess(sorted[i - 1], sorted[i]))
+			wedgeCounts.push_back(0);
+		positionIds[sorted[i]] = (unsigned int)(wedgeCounts.size() - 1);
+		wedgeCounts.back()++;
+	}
+
+	// Find the borders (edges with no twin) and anything non-manifold (edges used twice the same way)
+	std::vector<uint64_t> edges;
+	GatherEdges(out, positionIds, edges);
+
+	std::vector<bool> onBorder(wedgeCounts.size(), false);
+	std::vector<bool> nonManifold(wedgeCounts.size(), false);
+	for (size_t i = 0; i < edges.size(); i++) {
+		unsigned int from = (unsigned int)(edges[i] >> 32);
+		unsigned int to = (unsigned int)(edges[i] & 0xFFFFFFFF);
+		if (i + 1 < edges.size() && edges[i + 1] == edges[i])
+			nonManifold[from] = nonManifold[to] = true;
+		if (!HasEdge(edges, to, from))
+			onBorder[from] = onBorder[to] = true;
+	}
+
+	std::vector<VertexKind> kinds(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		unsigned int id = positionIds[v];
+		if (wedgeCounts[id] > 1 || nonManifold[id]) kinds[v] = Kind_Locked;
+		else if (onBorder[id]) kinds[v] = Kind_Border;
+		else kinds[v] = Kind_Manifold;
+	}
+
+	// Quadrics of the triangle planes, plus planes along the borders to hold them in place
+	std::vector<Quadric> quadrics(wedgeCounts.size(), PlaneQuadric(0, 0, 0, 0, 0));
+	for (size_t t = 0; t < out.size(); t += 3) {
+		XMVECTOR p0 = LoadPosition(vertices, out[t]);
+		XMVECTOR p1 = LoadPosition(vertices, out[t + 1]);
+		XMVECTOR p2 = LoadPosition(vertices, out[t + 2]);
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		float area = XMVectorGetX(XMVector3Length(normal)) * 0.5f;
+		if (area <= 0.0f)
+			continue;
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, XMVector3Normalize(normal));
+		double d = -XMVectorGetX(XMVector3Dot(XMVector3Normalize(normal), p0));
+		Quadric q = PlaneQuadric(n.x, n.y, n.z, d, area);
+		for (int corner = 0; corner < 3; corner++)
+			AddQuadric(quadrics[positionIds[out[t + corner]]], q);
+
+		for (int e = 0; e < 3; e++) {
+			unsigned int from = out[t + e];
+			unsigned int to = out[t + (e + 1) % 3];
+			if (HasEdge(edges, positionIds[to], positionIds[from]))
+				continue;
+
+			XMVECTOR a = LoadPosition(vertices, from);
+			XMVECTOR edge = XMVectorSubtract(LoadPosition(vertices, to), a);
+			float lengthSq = XMVectorGetX(XMVector3Dot(edge, edge));
+			XMFLOAT3 borderNormal;
+			XMVECTOR planeNormal = XMVector3Normalize(XMVector3Cross(edge, normal));
+			XMStoreFloat3(&borderNormal, planeNormal);
+			double borderD = -XMVectorGetX(XMVector3Dot(planeNormal, a));
+			Quadric border = PlaneQuadric(borderNormal.x, borderNormal.y, borderNormal.z, borderD, lengthSq * BorderWeight);
+			AddQuadric(quadrics[positionIds[from]], border);
+			AddQuadric(quadrics[positionIds[to]], border);
+		}
+	}
+
+	double maxErrorSq = (double)maxError * (double)maxError;
+	double resultError = 0.0;
+
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> locked(vertexCount);
+	std::vector<unsigned int> triangleStart(vertexCount + 1);
+	std::vector<unsigned int> triangles;
+
+	while (out.size() > targetIndexCount)
+	{
+		size_t triangleCount = out.size() / 3;
+		GatherEdges(out, positionIds, edges);
+
+		// The triangles around each vertex
+		std::fill(triangleStart.begin(), triangleStart.end(), 0);
+		for (unsigned int index : out)
+			triangleStart[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			triangleStart[v + 1] += triangleStart[v];
+		triangles.resize(out.size());
+		{
+			std::vector<unsigned int> cursor(triangleStart.begin(), triangleStart.end() - 1);
+			for (size_t i = 0; i < out.size(); i++)
+				triangles[cursor[out[i]]++] = (unsigned int)(i / 3);
+		}
+
+		// Every allowed collapse, cheapest first
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (int e = 0; e < 3; e++) {
+				unsigned int from = out[t * 3 + e];
+				unsigned int to = out[t * 3 + (e + 1) % 3];
+
+				for (int direction = 0; direction < 2; direction++) {
+					if (direction == 1) std::swap(from, to);
+
+					if (kinds[from] == Kind_Locked)
+						continue;
+					if (kinds[from] == Kind_Border) {
+						bool borderEdge = !HasEdge(edges, positionIds[to], positionIds[from]) || !HasEdge(edges, positionIds[from], positionIds[to]);
+						if (!borderEdge) continue;
+					}
+
+					double error = QuadricError(quadrics[positionIds[from]], vertices[to].Position);
+					if (error <= maxErrorSq)
+						collapses.push_back(Collapse{ from, to, error });
+				}
+			}
+		}
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		// Each collapse removes about two triangles, so don't overshoot the target by much
+		size_t wantedCollapses = (triangleCount - targetIndexCount / 3 + 1) / 2;
+		if (wantedCollapses < 1) wantedCollapses = 1;
+
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (unsigned int)v;
+		std::fill(locked.begin(), locked.end(), false);
+
+		size_t collapsed = 0;
+		for (const Collapse& c : collapses) {
+			if (collapsed >= wantedCollapses)
+				break;
+			if (locked[c.from] || locked[c.to])
+				continue;
+
+			const unsigned int* around = triangles.data() + triangleStart[c.from];
+			size_t aroundCount = triangleStart[c.from + 1] - triangleStart[c.from];
+			if (FlipsTriangles(vertices, out.data(), around, aroundCount, c.from, c.to))
+				continue;
+
+			remap[c.from] = c.to;
+			AddQuadric(quadrics[positionIds[c.to]], quadrics[positionIds[c.from]]);
+			resultError = std::max(resultError, c.error);
+			collapsed++;
+
+			// Nothing else touching these triangles can change in this pass
+			for (size_t i = 0; i < aroundCount; i++) {
+				const unsigned int* triangle = out.data() + (size_t)around[i] * 3;
+				locked[triangle[0]] = locked[triangle[1]] = locked[triangle[2]] = true;
+			}
+		}
+		if (collapsed == 0)
+			break;
+
+		// Apply the collapses and drop the triangles that disappeared
+		size_t written = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			unsigned int a = remap[out[t * 3]];
+			unsigned int b = remap[out[t * 3 + 1]];
+			unsigned int c = remap[out[t * 3 + 2]];
+			if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] || positionIds[a] == positionIds[c])
+				continue;
+
+			out[written++] = a;
+			out[written++] = b;
+			out[written++] = c;
+		}
+		out.resize(written);
+	}
+
+	return (float)sqrt(resultError);
+}
+
+void MeshSimplifier::BuildLodChain(MeshGeometry& geometry, const LodSettings& settings)
+{
+	// Only the full detail indices (and submeshes) are kept
+	uint32_t fullCount = geometry.lods.empty() ? (uint32_t)geometry.indices.size() : geometry.lods[0].indexCount;
+	geometry.submeshes.resize(MeshBuilder::GetSubmeshesPerLevel(geometry));
+	geometry.indices.resize(fullCount);
+	geometry.lods.clear();
+	geometry.lods.push_back(MeshLod{ 0, fullCount, 0.0f });
+	if (geometry.vertices.empty() || fullCount < 3)
+		return;
+
+	// The error limit is relative to the size of the mesh
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	for (const Vertex& v : geometry.vertices) {
+		XMVECTOR pos = XMLoadFloat3(&v.Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+	float radius = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsMin)));
+	float maxError = settings.maxError * radius;
+
+	// Each submesh is simplified on its own, so every level keeps one range
+	// per material (a mesh without any is one big range)
+	std::vector<MeshSubmesh> fullRanges(geometry.submeshes);
+	if (fullRanges.empty()) {
+		fullRanges.resize(1);
+		memset(&fullRanges[0], 0, sizeof(MeshSubmesh));
+		fullRanges[0].indexCount = fullCount;
+	}
+	std::vector<MeshSubmesh> previous(fullRanges);
+
+	std::vector<unsigned int> fullDetail(geometry.indices);
+	std::vector<unsigned int> simplified;
+	std::vector<unsigned int> levelIndices;
+	std::vector<MeshSubmesh> levelRanges(fullRanges);
+	size_t previousCount = fullCount;
+
+	for (uint32_t level = 1; level < settings.maxLevels; level++) {
+		float error = geometry.lods.back().error;
+		levelIndices.clear();
+		for (size_t i = 0; i < previous.size(); i++) {
+			// Ranges that can't get any smaller stay as they were
+			const MeshSubmesh& full = fullRanges[i];
+			size_t target = (size_t)(previous[i].indexCount / 3 * settings.triangleRatio) * 3;
+			simplified.clear();
+			if (target >= 3)
+				error = std::max(error, Simplify(geometry.vertices.data(), geometry.vertices.size(), fullDetail.data() + full.indexOffset, full.indexCount, target, maxError, simplified));
+			if (simplified.empty())
+				simplified.assign(geometry.indices.begin() + previous[i].indexOffset, geometry.indices.begin() + previous[i].indexOffset + previous[i].indexCount);
+
+			levelRanges[i].indexOffset = (uint32_t)(geometry.indices.size() + levelIndices.size());
+			levelRanges[i].indexCount = (uint32_t)simplified.size();
+			levelIndices.insert(levelIndices.end(), simplified.begin(), simplified.end());
+		}
+		if (levelIndices.size() > previousCount * (1.0f - MinLodReduction))
+			break;
+
+		// Selection expects the errors to only grow along the chain
+		geometry.lods.push_back(MeshLod{ (uint32_t)geometry.indices.size(), (uint32_t)levelIndices.size(), error });
+		geometry.indices.insert(geometry.indices.end(), levelIndices.begin(), levelIndices.end());
+		if (!geometry.submeshes.empty())
+			geometry.submeshes.insert(geometry.submeshes.end(), levelRanges.begin(), levelRanges.end());
+		previous = levelRanges;
+		previousCount = levelIndices.size();
+	}
+}
+
+float MeshSimplifier::GetPixelsPerUnit(float fovAngle, float screenHeight)
+{
+	return screenHeight / (2.0f * tanf(fovAngle * 0.5f));
+}
+
+unsigned int MeshSimplifier::SelectLod(const MeshLod* lods, size_t lodCount, float distance, float worldScale, float pixelsPerUnit, float maxPixelError)
+{
+	if (lodCount == 0 || distance <= 0.0f)
+		return 0;
+
+	// Errors only grow along the chain, so look from the coarsest level down
+	for (size_t level = lodCount - 1; level > 0; level--) {
+		float pixels = lods[level].error * worldScale * pixelsPerUnit / distance;
+		if (pixels <= maxPixelError)
+			return (unsigned int)level;
+	}
+	return 0;
+}
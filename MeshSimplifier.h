@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+#include "MeshBuilder.h"
+
+// --------------------------------------------------------
+// Reduces the triangle count of indexed geometry, and
+// builds and picks levels of detail from the results
+//
+// - Edge collapses are ordered by Garland and Heckbert's
+//   quadric error metric, so each vertex moves onto the
+//   neighbour that changes the surface the least.
+// - Vertices only ever move onto existing ones, so every
+//   level only needs new indices, not new vertices.
+// - Open borders only collapse along themselves, and vertices
+//   split by a UV or normal seam never move, so textures and
+//   silhouettes hold up.  Collapses that would flip a triangle
+//   over are skipped.
+// --------------------------------------------------------
+class MeshSimplifier
+{
+public:
+	// Simplify towards targetIndexCount indices, without any vertex moving further than maxError.
+	// - Returns the error (in model units) of the result, which goes in "out".
+	static float Simplify(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		size_t targetIndexCount, float maxError, std::vector<unsigned int>& out);
+
+	// Append a chain of levels of detail to the geometry's indices (replacing any that are there).
+	// - Every level is simplified from the full detail one, so each error is
+	//   measured against the real surface.
+	// - The chain stops early once a level can't get meaningfully smaller
+	//   within the error limit.
+	// - Submeshes are simplified one at a time, and each level gets a
+	//   submesh for every one of the full detail level's.
+	static void BuildLodChain(MeshGeometry& geometry, const LodSettings& settings);
+
+	// Screen pixels covered by one model unit, one unit in front of a camera.
+	static float GetPixelsPerUnit(float fovAngle, float screenHeight);
+
+	// The coarsest level whose error, projected onto the screen at the
+	// given distance, covers at most maxPixelError pixels.
+	// - worldScale scales the errors, for scaled entities.
+	static unsigned int SelectLod(const MeshLod* lods, size_t lodCount, float distance, float worldScale, float pixelsPerUnit, float maxPixelError = 1.0f);
+};
@@ -0,0 +1,285 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// How many new vertices a triangle facing the opposite way is worth, when
+	// picking the next one to add (trades vertex reuse for narrower cones).
+	const float ConeWeight = 1.0f;
+
+	// Marks "no meshlet".
+	const unsigned int None = 0xFFFFFFFF;
+
+	// A plane as a unit normal and distance: inside when dot(normal, p) + d >= 0.
+	struct Plane
+	{
+		float x, y, z, d;
+	};
+
+	// The 6 planes of the view frustum, in the space the matrix transforms from.
+	// - Gribb and Hartmann's method, for DirectX's 0 to w depth range.
+	void ExtractFrustum(const XMFLOAT4X4& m, Plane planes[6])
+	{
+		for (int p = 0; p < 6; p++) {
+			int column = (p < 2) ? 0 : (p < 4) ? 1 : 2;
+			float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+			float w = (p == 4) ? 0.0f : 1.0f;	// The near plane is just z >= 0
+
+			Plane plane;
+			plane.x = m.m[0][3] * w + m.m[0][column] * sign;
+			plane.y = m.m[1][3] * w + m.m[1][column] * sign;
+			plane.z = m.m[2][3] * w + m.m[2][column] * sign;
+			plane.d = m.m[3][3] * w + m.m[3][column] * sign;
+
+			float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			float scale = (length > 0.0f) ? 1.0f / length : 0.0f;
+			plane.x *= scale; plane.y *= scale; plane.z *= scale; plane.d *= scale;
+			planes[p] = plane;
+		}
+	}
+
+	// True if the meshlet is entirely on the outside of any of the planes.
+	// - The sphere is cheaper, the box is tighter, so the box only gets
+	//   checked against planes the sphere crosses.
+	bool OutsideFrustum(const Meshlet& meshlet, const Plane planes[6])
+	{
+		for (int p = 0; p < 6; p++) {
+			const Plane& plane = planes[p];
+			float distance = plane.x * meshlet.center.x + plane.y * meshlet.center.y + plane.z * meshlet.center.z + plane.d;
+			if (distance < -meshlet.radius)
+				return true;
+			if (distance >= meshlet.radius)
+				continue;
+
+			// The corner of the box furthest along the plane's normal
+			float x = (plane.x >= 0.0f) ? meshlet.boundsMax.x : meshlet.boundsMin.x;
+			float y = (plane.y >= 0.0f) ? meshlet.boundsMax.y : meshlet.boundsMin.y;
+			float z = (plane.z >= 0.0f) ? meshlet.boundsMax.z : meshlet.boundsMin.z;
+			if (plane.x * x + plane.y * y + plane.z * z + plane.d < 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	// True if every triangle of the meshlet faces away from the camera.
+	// - Every point of the sphere has to see the back of the whole cone.
+	bool Backfacing(const Meshlet& meshlet, const XMFLOAT3& camera)
+	{
+		if (meshlet.coneCutoff >= 1.0f)
+			return false;
+
+		float dx = meshlet.center.x - camera.x;
+		float dy = meshlet.center.y - camera.y;
+		float dz = meshlet.center.z - camera.z;
+		float along = dx * meshlet.coneAxis.x + dy * meshlet.coneAxis.y + dz * meshlet.coneAxis.z;
+		return along >= meshlet.coneCutoff * sqrtf(dx * dx + dy * dy + dz * dz) + meshlet.radius;
+	}
+
+	// Bounds and normal cone of a finished meshlet.
+	void CalculateBounds(Meshlet& meshlet, const unsigned int* indices, const Vertex* vertices, const std::vector<XMFLOAT3>& normals)
+	{
+		const unsigned int* first = indices + meshlet.indexOffset;
+		size_t indexCount = (size_t)meshlet.triangleCount * 3;
+
+		XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+		for (size_t i = 0; i < indexCount; i++) {
+			XMVECTOR pos = XMLoadFloat3(&vertices[first[i]].Position);
+			boundsMin = XMVectorMin(boundsMin, pos);
+			boundsMax = XMVectorMax(boundsMax, pos);
+		}
+		XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+
+		float radiusSq = 0.0f;
+		for (size_t i = 0; i < indexCount; i++) {
+			XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&vertices[first[i]].Position), center);
+			radiusSq = fmaxf(radiusSq, XMVectorGetX(XMVector3Dot(offset, offset)));
+		}
+
+		XMStoreFloat3(&meshlet.boundsMin, boundsMin);
+		XMStoreFloat3(&meshlet.boundsMax, boundsMax);
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = sqrtf(radiusSq);
+
+		// The cone is around the average normal, as wide as the furthest one
+		// - Degenerate triangles (zero normals) face nowhere, so they don't count
+		size_t triangleStart = meshlet.indexOffset / 3;
+		XMVECTOR axis = XMVectorZero();
+		for (size_t t = 0; t < meshlet.triangleCount; t++)
+			axis = XMVectorAdd(axis, XMLoadFloat3(&normals[triangleStart + t]));
+		axis = XMVector3Normalize(axis);
+
+		float minDot = 1.0f;
+		bool anyNormal = false;
+		for (size_t t = 0; t < meshlet.triangleCount; t++) {
+			XMVECTOR normal = XMLoadFloat3(&normals[triangleStart + t]);
+			if (XMVectorGetX(XMVector3Dot(normal, normal)) == 0.0f)
+				continue;
+			minDot = fminf(minDot, XMVectorGetX(XMVector3Dot(normal, axis)));
+			anyNormal = true;
+		}
+
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		meshlet.coneCutoff = (anyNormal && minDot > 0.0f) ? sqrtf(fmaxf(0.0f, 1.0f - minDot * minDot)) : 1.0f;
+	}
+}
+
+
+double MeshletCullStats::GetCulledRatio() const
+{
+	return triangleCount > 0 ? 1.0 - (double)visibleTriangles / triangleCount : 0.0;
+}
+
+void MeshletBuilder::Build(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, std::vector<Meshlet>& out,
+	unsigned int maxVertices, unsigned int maxTriangles)
+{
+	out.clear();
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+	if (maxVertices < 3) maxVertices = 3;
+	if (maxTriangles < 1) maxTriangles = 1;
+
+	// Facing of every triangle (with room for them again in the new order)
+	std::vector<XMFLOAT3> normals(triangleCount);
+	normals.reserve(triangleCount * 2);
+	for (size_t t = 0; t < triangleCount; t++) {
+		XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+		XMStoreFloat3(&normals[t], XMVector3Normalize(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0))));
+	}
+
+	// The triangles using each vertex
+	std::vector<unsigned int> triangleStart(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		triangleStart[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		triangleStart[v + 1] += triangleStart[v];
+	std::vector<unsigned int> vertexTriangles(triangleCount * 3);
+	{
+		std::vector<unsigned int> cursor(triangleStart.begin(), triangleStart.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			vertexTriangles[cursor[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	// Grow the meshlets, writing their triangles out in order
+	std::vector<unsigned int> ordered;
+	ordered.reserve(triangleCount * 3);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> vertexMeshlet(vertexCount, None);
+	std::vector<unsigned int> meshletVertices;
+	size_t nextSeed = 0;
+
+	Meshlet meshlet = {};
+	XMVECTOR axis = XMVectorZero();
+
+	auto newVertexCount = [&](size_t t) {
+		unsigned int current = (unsigned int)out.size();
+		return (vertexMeshlet[indices[t * 3]] != current) +
+			(vertexMeshlet[indices[t * 3 + 1]] != current) +
+			(vertexMeshlet[indices[t * 3 + 2]] != current);
+	};
+
+	auto finish = [&]() {
+		if (meshlet.triangleCount == 0) return;
+		out.push_back(meshlet);
+		meshletVertices.clear();
+		meshlet = {};
+		meshlet.indexOffset = (uint32_t)ordered.size();
+		axis = XMVectorZero();
+	};
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		// The best neighbour of the meshlet: adding the fewest vertices, and facing the same way
+		size_t best = None;
+		float bestCost = FLT_MAX;
+		XMVECTOR direction = XMVector3Normalize(axis);
+		for (unsigned int v : meshletVertices) {
+			for (unsigned int i = triangleStart[v]; i < triangleStart[v + 1]; i++) {
+				unsigned int t = vertexTriangles[i];
+				if (emitted[t]) continue;
+
+				int added = newVertexCount(t);
+				if (meshlet.vertexCount + added > maxVertices) continue;
+
+				float dot = XMVectorGetX(XMVector3Dot(direction, XMLoadFloat3(&normals[t])));
+				float cost = added + ConeWeight * (1.0f - dot);
+				if (cost < bestCost) {
+					best = t;
+					bestCost = cost;
+				}
+			}
+		}
+
+		// Nothing connected fits, so start a new meshlet at the next triangle left
+		if (best == None) {
+			finish();
+			while (emitted[nextSeed]) nextSeed++;
+			best = nextSeed;
+		}
+
+		// Add it
+		emitted[best] = true;
+		for (int corner = 0; corner < 3; corner++) {
+			unsigned int v = indices[best * 3 + corner];
+			if (vertexMeshlet[v] != (unsigned int)out.size()) {
+				vertexMeshlet[v] = (unsigned int)out.size();
+				meshletVertices.push_back(v);
+				meshlet.vertexCount++;
+			}
+			ordered.push_back(v);
+		}
+		normals.push_back(normals[best]);	// Kept in the new order after the old ones
+		axis = XMVectorAdd(axis, XMLoadFloat3(&normals[best]));
+		meshlet.triangleCount++;
+
+		if (meshlet.triangleCount >= maxTriangles || meshlet.vertexCount >= maxVertices)
+			finish();
+	}
+	finish();
+
+	// Swap in the new order, then the bounds can be worked out from it
+	memcpy(indices, ordered.data(), ordered.size() * sizeof(unsigned int));
+	normals.erase(normals.begin(), normals.begin() + triangleCount);
+	for (Meshlet& m : out)
+		CalculateBounds(m, indices, vertices, normals);
+}
+
+void MeshletBuilder::Cull(const Meshlet* meshlets, size_t meshletCount, const unsigned int* indices,
+	const XMFLOAT4X4& worldViewProj, const XMFLOAT3& cameraPosition,
+	std::vector<unsigned int>& out, MeshletCullStats* stats)
+{
+	Plane planes[6];
+	ExtractFrustum(worldViewProj, planes);
+
+	MeshletCullStats result;
+	result.meshletCount = meshletCount;
+	for (size_t i = 0; i < meshletCount; i++) {
+		const Meshlet& meshlet = meshlets[i];
+		result.triangleCount += meshlet.triangleCount;
+
+		if (Backfacing(meshlet, cameraPosition)) {
+			result.backfaceMeshlets++;
+			result.backfaceTriangles += meshlet.triangleCount;
+			continue;
+		}
+		if (OutsideFrustum(meshlet, planes)) {
+			result.frustumMeshlets++;
+			result.frustumTriangles += meshlet.triangleCount;
+			continue;
+		}
+
+		const unsigned int* first = indices + meshlet.indexOffset;
+		out.insert(out.end(), first, first + (size_t)meshlet.triangleCount * 3);
+		result.visibleMeshlets++;
+		result.visibleTriangles += meshlet.triangleCount;
+	}
+
+	if (stats != nullptr) *stats = result;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+
+// A small cluster of triangles, with what's needed to cull it as a whole.
+// - Its triangles are contiguous in the index buffer.
+struct Meshlet
+{
+	uint32_t indexOffset;
+	uint32_t triangleCount;
+	uint32_t vertexCount;			// Unique vertices its triangles use.
+	DirectX::XMFLOAT3 center;		// Bounding sphere
+	float radius;
+	DirectX::XMFLOAT3 boundsMin;	// Bounding box
+	DirectX::XMFLOAT3 boundsMax;
+	DirectX::XMFLOAT3 coneAxis;		// Normal cone: the average facing of its triangles,
+	float coneCutoff;				// and the sine of the widest angle from it (1 = can't be culled by facing).
+};
+
+// Results of culling one set of meshlets.
+struct MeshletCullStats
+{
+	size_t meshletCount = 0;
+	size_t triangleCount = 0;
+	size_t visibleMeshlets = 0;
+	size_t visibleTriangles = 0;
+	size_t backfaceMeshlets = 0;	// Culled for facing away from the camera
+	size_t frustumMeshlets = 0;		// Culled for being outside the view
+	size_t backfaceTriangles = 0;
+	size_t frustumTriangles = 0;
+
+	// Share of the triangles that didn't need to be drawn.
+	double GetCulledRatio() const;
+};
+
+// --------------------------------------------------------
+// Splits indexed geometry into meshlets and culls them
+//
+// - Meshlets grow greedily from a starting triangle through
+//   its neighbours, preferring ones that add no new vertices
+//   and face the same way, so each one stays compact (tight
+//   bounds) and flat (a narrow normal cone).
+// - Culling is done in model space: the frustum planes come
+//   straight out of the world-view-projection matrix, and
+//   facing doesn't change under affine transforms.
+// - Both tests are conservative, so nothing visible is culled.
+// --------------------------------------------------------
+class MeshletBuilder
+{
+public:
+	// Limits on the size of a meshlet (those of a typical mesh shader workgroup).
+	static const unsigned int DefaultMaxVertices = 64;
+	static const unsigned int DefaultMaxTriangles = 124;
+
+	// Reorder the triangles into meshlets, and return them.
+	static void Build(unsigned int* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, std::vector<Meshlet>& out,
+		unsigned int maxVertices = DefaultMaxVertices, unsigned int maxTriangles = DefaultMaxTriangles);
+
+	// Append the indices of every meshlet that may be visible to "out".
+	// - cameraPosition is in model space (the same space as the vertices).
+	static void Cull(const Meshlet* meshlets, size_t meshletCount, const unsigned int* indices,
+		const DirectX::XMFLOAT4X4& worldViewProj, const DirectX::XMFLOAT3& cameraPosition,
+		std::vector<unsigned int>& out, MeshletCullStats* stats = nullptr);
+};
@@ -0,0 +1,638 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+using namespace DirectX;
+
+bool ObjParser::s_reportThroughput = false;
+unsigned int ObjParser::s_threadCount = 0;
+
+namespace
+{
+	// Every power of ten a double can hold exactly, used by the float scanner.
+	const double s_powersOfTen[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+	inline bool IsDigit(char c) { return (unsigned char)(c - '0') < 10; }
+
+	inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p)) p++;
+		return p;
+	}
+
+	// Finds the end of the line starting at p (not including any "\r\n").
+	// - Also returns where the next line starts.
+	inline const char* FindLineEnd(const char* p, const char* end, const char** nextLine)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (lineEnd == nullptr) lineEnd = end;
+		*nextLine = (lineEnd < end) ? lineEnd + 1 : end;
+
+		if (lineEnd > p && lineEnd[-1] == '\r') lineEnd--;
+		return lineEnd;
+	}
+
+	// Reads a decimal float (with optional sign, fraction and exponent).
+	// - Up to 19 significant digits are kept, which is far more than a float needs.
+	// - Returns a pointer to the first character after the number.
+	const char* ScanFloat(const char* p, const char* end, float& out)
+	{
+		p = SkipSpaces(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = (*p == '-');
+			p++;
+		}
+
+		unsigned long long mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+
+		// Whole part
+		for (; p < end && IsDigit(*p); p++) {
+			if (significantDigits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0) significantDigits++;
+			}
+			else {
+				exponent++;
+			}
+		}
+
+		// Fractional part
+		if (p < end && *p == '.') {
+			for (p++; p < end && IsDigit(*p); p++) {
+				if (significantDigits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa != 0) significantDigits++;
+					exponent--;
+				}
+			}
+		}
+
+		// Exponent
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			p++;
+			bool negativeExponent = false;
+			if (p < end && (*p == '-' || *p == '+')) {
+				negativeExponent = (*p == '-');
+				p++;
+			}
+
+			int value = 0;
+			for (; p < end && IsDigit(*p); p++) {
+				if (value < 10000) value = value * 10 + (*p - '0');
+			}
+			exponent += negativeExponent ? -value : value;
+		}
+
+		// Scale by the exponent (exact whenever the power of ten is exact)
+		double result = (double)mantissa;
+		if (exponent < 0) {
+			result = (-exponent <= 22) ? result / s_powersOfTen[-exponent] : result * pow(10.0, exponent);
+		}
+		else if (exponent > 0) {
+			result = (exponent <= 22) ? result * s_powersOfTen[exponent] : result * pow(10.0, exponent);
+		}
+
+		out = (float)(negative ? -result : result);
+		return p;
+	}
+
+	// Reads a (possibly negative) decimal integer.
+	// - Returns a pointer to the first character after the number.
+	inline const char* ScanInt(const char* p, const char* end, int& out)
+	{
+		bool negative = false;
+		if (p < end && *p == '-') {
+			negative = true;
+			p++;
+		}
+
+		int value = 0;
+		for (; p < end && IsDigit(*p); p++) {
+			value = value * 10 + (*p - '0');
+		}
+
+		out = negative ? -value : value;
+		return p;
+	}
+
+	// Converts a 1-based (or negative, relative) OBJ index into a 0-based index.
+	// - Returns -1 for missing or out of range indices.
+	inline int ResolveIndex(int index, size_t count)
+	{
+		if (index > 0)
+			return ((size_t)index <= count) ? index - 1 : -1;
+		if (index < 0)
+			return ((size_t)-index <= count) ? (int)count + index : -1;
+		return -1;
+	}
+
+	// True if a face token starting with this character is read as a corner.
+	inline bool IsCornerStart(char c) { return IsDigit(c) || c == '-'; }
+
+	// Counts the corners of a face (whitespace separated tokens that start like an index).
+	inline int CountCorners(const char* p, const char* end)
+	{
+		int corners = 0;
+		bool inToken = false;
+		for (; p < end; p++) {
+			bool space = IsSpace(*p);
+			if (!space && !inToken && IsCornerStart(*p)) corners++;
+			inToken = !space;
+		}
+		return corners;
+	}
+
+	// True if the line at p starts with this keyword, followed by whitespace.
+	inline bool IsKeyword(const char* p, const char* lineEnd, const char* keyword, size_t length)
+	{
+		return (size_t)(lineEnd - p) > length && memcmp(p, keyword, length) == 0 && IsSpace(p[length]);
+	}
+
+	// The rest of a line, without the whitespace around it.
+	inline std::string ReadRest(const char* p, const char* lineEnd)
+	{
+		p = SkipSpaces(p, lineEnd);
+		while (lineEnd > p && IsSpace(lineEnd[-1])) lineEnd--;
+		return std::string(p, lineEnd);
+	}
+
+	// The file name of an MTL texture record: its last token, after any "-option value" pairs.
+	inline std::string ReadTextureName(const char* p, const char* lineEnd)
+	{
+		while (lineEnd > p && IsSpace(lineEnd[-1])) lineEnd--;
+		const char* nameStart = lineEnd;
+		while (nameStart > p && !IsSpace(nameStart[-1])) nameStart--;
+		return std::string(nameStart, lineEnd);
+	}
+
+	// Reads an MTL color (a single value means grey).
+	inline void ScanColor(const char* p, const char* lineEnd, XMFLOAT3& out)
+	{
+		p = ScanFloat(p, lineEnd, out.x);
+		if (SkipSpaces(p, lineEnd) >= lineEnd) {
+			out.y = out.z = out.x;
+			return;
+		}
+		p = ScanFloat(p, lineEnd, out.y);
+		ScanFloat(p, lineEnd, out.z);
+	}
+
+	// Files smaller than this (per thread) aren't worth splitting up.
+	const size_t MinChunkBytes = 64 * 1024;
+
+	// A run of whole lines of the file, parsed on its own.
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+
+		// Records in this chunk
+		size_t positionCount;
+		size_t normalCount;
+		size_t uvCount;
+		size_t indexCount;
+
+		// Where they go in the output (the totals of all earlier chunks)
+		size_t positionStart;
+		size_t normalStart;
+		size_t uvStart;
+		size_t indexStart;
+	};
+
+	// Material records of one chunk, added to the output in chunk order once every chunk is parsed.
+	struct ObjChunkMaterials
+	{
+		std::vector<std::string> libraries;
+		std::vector<ObjMaterialUse> uses;
+	};
+
+	// Counts the records in a chunk.
+	// - This only looks at the first couple characters of most lines, and
+	//   face lines are just split on whitespace, so it's much cheaper than the parse.
+	// - Must agree exactly with ParseChunk, which fills in exactly this many of each.
+	void CountChunk(ObjChunk& chunk)
+	{
+		const char* end = chunk.end;
+		const char* next = nullptr;
+		for (const char* p = chunk.begin; p < end; p = next) {
+			const char* lineEnd = FindLineEnd(p, end, &next);
+			p = SkipSpaces(p, lineEnd);
+			if (lineEnd - p < 2) continue;
+
+			if (p[0] == 'v') {
+				if (IsSpace(p[1])) chunk.positionCount++;
+				else if (p[1] == 't') chunk.uvCount++;
+				else if (p[1] == 'n') chunk.normalCount++;
+			}
+			else if (p[0] == 'f' && IsSpace(p[1])) {
+				int corners = CountCorners(p + 1, lineEnd);
+				if (corners >= 3) chunk.indexCount += (size_t)(corners - 2) * 3;
+			}
+		}
+	}
+
+	// Parses a chunk into its part of the (already sized) output.
+	// - Face indices are resolved against everything read so far, including
+	//   all earlier chunks, so the result is the same as one big parse.
+	void ParseChunk(const ObjChunk& chunk, ObjData& out, ObjChunkMaterials& materials)
+	{
+		XMFLOAT3* positions = out.positions.data() + chunk.positionStart;
+		XMFLOAT3* normals = out.normals.data() + chunk.normalStart;
+		XMFLOAT2* uvs = out.uvs.data() + chunk.uvStart;
+		ObjIndex* indices = out.indices.data() + chunk.indexStart;
+
+		size_t positionCount = chunk.positionStart;
+		size_t normalCount = chunk.normalStart;
+		size_t uvCount = chunk.uvStart;
+
+		// Corners of the current face, reused for every face.
+		std::vector<ObjIndex> polygon;
+		polygon.reserve(8);
+
+		const char* end = chunk.end;
+		const char* next = nullptr;
+		for (const char* p = chunk.begin; p < end; p = next) {
+			const char* lineEnd = FindLineEnd(p, end, &next);
+			p = SkipSpaces(p, lineEnd);
+			if (lineEnd - p < 2) continue;
+
+			if (p[0] == 'v' && IsSpace(p[1]))
+			{
+				XMFLOAT3 pos;
+				p = ScanFloat(p + 1, lineEnd, pos.x);
+				p = ScanFloat(p, lineEnd, pos.y);
+				p = ScanFloat(p, lineEnd, pos.z);
+				*positions++ = pos;
+				positionCount++;
+			}
+			else if (p[0] == 'v' && p[1] == 't')
+			{
+				// A third (w) component is allowed, but never used.
+				XMFLOAT2 uv;
+				p = ScanFloat(p + 2, lineEnd, uv.x);
+				p = ScanFloat(p, lineEnd, uv.y);
+				*uvs++ = uv;
+				uvCount++;
+			}
+			else if (p[0] == 'v' && p[1] == 'n')
+			{
+				XMFLOAT3 norm;
+				p = ScanFloat(p + 2, lineEnd, norm.x);
+				p = ScanFloat(p, lineEnd, norm.y);
+				p = ScanFloat(p, lineEnd, norm.z);
+				*normals++ = norm;
+				normalCount++;
+			}
+			else if (p[0] == 'f' && IsSpace(p[1]))
+			{
+				// Read every corner of the face (v, v/t, v//n or v/t/n).
+				polygon.clear();
+				p++;
+				while (true)
+				{
+					p = SkipSpaces(p, lineEnd);
+					if (p >= lineEnd) break;
+
+					// Not an index, skip the whole token.
+					if (!IsCornerStart(*p)) {
+						while (p < lineEnd && !IsSpace(*p)) p++;
+						continue;
+					}
+
+					int position = 0, uv = 0, normal = 0;
+					p = ScanInt(p, lineEnd, position);
+					if (p < lineEnd && *p == '/') {
+						p++;
+						if (p < lineEnd && *p != '/') p = ScanInt(p, lineEnd, uv);
+						if (p < lineEnd && *p == '/') p = ScanInt(p + 1, lineEnd, normal);
+					}
+
+					ObjIndex corner;
+					corner.position = ResolveIndex(position, positionCount);
+					corner.uv = ResolveIndex(uv, uvCount);
+					corner.normal = ResolveIndex(normal, normalCount);
+					polygon.push_back(corner);
+
+					// Skip anything unexpected left in the token.
+					while (p < lineEnd && !IsSpace(*p)) p++;
+				}
+
+				// Fan the polygon into triangles.
+				for (size_t i = 2; i < polygon.size(); i++) {
+					*indices++ = polygon[0];
+					*indices++ = polygon[i - 1];
+					*indices++ = polygon[i];
+				}
+			}
+			else if (p[0] == 'u' && IsKeyword(p, lineEnd, "usemtl", 6))
+			{
+				materials.uses.push_back(ObjMaterialUse{ ReadRest(p + 6, lineEnd), (size_t)(indices - out.indices.data()) });
+			}
+			else if (p[0] == 'm' && IsKeyword(p, lineEnd, "mtllib", 6))
+			{
+				// Any number of file names (none with spaces in them)
+				for (p = SkipSpaces(p + 6, lineEnd); p < lineEnd; p = SkipSpaces(p, lineEnd)) {
+					const char* nameEnd = p;
+					while (nameEnd < lineEnd && !IsSpace(*nameEnd)) nameEnd++;
+					materials.libraries.push_back(std::string(p, nameEnd));
+					p = nameEnd;
+				}
+			}
+		}
+	}
+
+	// Parses whole lines of OBJ text onto the end of what's already in "out".
+	void AppendLines(const char* text, size_t length, ObjData& out, unsigned int threadCount)
+	{
+		// Split the text into chunks of whole lines.
+		// - A few more chunks than threads, so a chunk full of (slower) face
+		//   lines doesn't leave the other threads waiting on it.
+		size_t chunkCount = 1;
+		if (threadCount > 1) {
+			chunkCount = length / MinChunkBytes;
+			if (chunkCount > (size_t)threadCount * 4) chunkCount = (size_t)threadCount * 4;
+			if (chunkCount < 1) chunkCount = 1;
+		}
+
+		std::vector<ObjChunk> chunks(chunkCount);
+		const char* end = text + length;
+		const char* p = text;
+		for (size_t i = 0; i < chunkCount; i++) {
+			const char* chunkEnd = end;
+			if (i + 1 < chunkCount) {
+				chunkEnd = text + length / chunkCount * (i + 1);
+				if (chunkEnd < p) chunkEnd = p;
+				FindLineEnd(chunkEnd, end, &chunkEnd);
+			}
+
+			chunks[i] = ObjChunk();
+			chunks[i].begin = p;
+			chunks[i].end = chunkEnd;
+			p = chunkEnd;
+		}
+
+		// Count the records in every chunk.
+		ParallelFor(chunkCount, threadCount, [&](size_t i) { CountChunk(chunks[i]); });
+
+		// Prefix sum of the counts (after whatever is already in the output) gives where
+		// each chunk's records start, which is also how many of each came before it (needed to resolve indices).
+		size_t positionCount = out.positions.size();
+		size_t normalCount = out.normals.size();
+		size_t uvCount = out.uvs.size();
+		size_t indexCount = out.indices.size();
+		for (ObjChunk& chunk : chunks) {
+			chunk.positionStart = positionCount;
+			chunk.normalStart = normalCount;
+			chunk.uvStart = uvCount;
+			chunk.indexStart = indexCount;
+
+			positionCount += chunk.positionCount;
+			normalCount += chunk.normalCount;
+			uvCount += chunk.uvCount;
+			indexCount += chunk.indexCount;
+		}
+
+		// Size the output exactly, then let every chunk fill in its own part of it.
+		out.positions.resize(positionCount);
+		out.normals.resize(normalCount);
+		out.uvs.resize(uvCount);
+		out.indices.resize(indexCount);
+
+		std::vector<ObjChunkMaterials> chunkMaterials(chunkCount);
+		ParallelFor(chunkCount, threadCount, [&](size_t i) { ParseChunk(chunks[i], out, chunkMaterials[i]); });
+
+		for (ObjChunkMaterials& materials : chunkMaterials) {
+			out.materialLibraries.insert(out.materialLibraries.end(), materials.libraries.begin(), materials.libraries.end());
+			out.materialUses.insert(out.materialUses.end(), materials.uses.begin(), materials.uses.end());
+		}
+	}
+}
+
+
+double ObjParseStats::GetMegabytesPerSecond() const
+{
+	if (seconds <= 0.0) return 0.0;
+	return (bytes / (1024.0 * 1024.0)) / seconds;
+}
+
+
+bool ObjParser::ParseFile(const char* pathToFile, ObjData& out, ObjParseStats* stats)
+{
+	// Compressed files are streamed, anything else is mapped and parsed in one go
+	CompressedStream stream(pathToFile);
+	if (!stream.IsOpen())
+		return false;
+
+	ObjParseStats result;
+	if (stream.GetCompression() != StreamCompression_None) {
+		if (!ParseStream(stream, out, &result))
+			return false;
+	}
+	else {
+		MappedFile file(pathToFile);
+		if (!file.IsOpen())
+			return false;
+
+		// Time only the parse itself.
+		LARGE_INTEGER frequency, start, stop;
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&start);
+
+		Parse(file.GetData(), file.GetSize(), out);
+
+		QueryPerformanceCounter(&stop);
+
+		result.bytes = file.GetSize();
+		result.fileBytes = file.GetSize();
+		result.seconds = (double)(stop.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+	}
+	if (stats != nullptr) *stats = result;
+
+	if (s_reportThroughput) {
+		// Just the file name, the full path is usually very long.
+		const char* fileName = pathToFile;
+		for (const char* c = pathToFile; *c != '\0'; c++) {
+			if (*c == '/' || *c == '\\') fileName = c + 1;
+		}
+
+		if (result.compression == StreamCompression_None) {
+			printf("ObjParser: %s - %.2f MB in %.2f ms (%.1f MB/s)\n",
+				fileName,
+				result.bytes / (1024.0 * 1024.0),
+				result.seconds * 1000.0,
+				result.GetMegabytesPerSecond());
+		}
+		else {
+			printf("ObjParser: %s - %.2f MB read in %.2f ms, inflated to %.2f MB in %.2f ms, parsed in %.2f ms (%.1f MB/s)\n",
+				fileName,
+				result.fileBytes / (1024.0 * 1024.0),
+				result.readSeconds * 1000.0,
+				result.bytes / (1024.0 * 1024.0),
+				result.decompressSeconds * 1000.0,
+				result.seconds * 1000.0,
+				result.GetMegabytesPerSecond());
+		}
+	}
+
+	return true;
+}
+
+bool ObjParser::ParseStream(CompressedStream& stream, ObjData& out, ObjParseStats* stats)
+{
+	unsigned int threadCount = (s_threadCount > 0) ? s_threadCount : GetHardwareThreadCount();
+	out = ObjData();
+
+	LARGE_INTEGER frequency, start, stop;
+	QueryPerformanceFrequency(&frequency);
+	double parseSeconds = 0.0;
+
+	// A block of text at a time, carrying any partial line at the end of one over to the next
+	std::vector<char> block(StreamBlockSize);
+	size_t carried = 0;
+	size_t parsedBytes = 0;
+	while (true) {
+		size_t wanted = block.size() - carried;
+		size_t length = carried + stream.Read(block.data() + carried, wanted);
+		bool atEnd = (length - carried < wanted);
+
+		size_t whole = length;
+		if (!atEnd) {
+			while (whole > 0 && block[whole - 1] != '\n') whole--;
+
+			// A single line longer than the block, so make room for the rest of it
+			if (whole == 0) {
+				carried = length;
+				block.resize(block.size() * 2);
+				continue;
+			}
+		}
+
+		QueryPerformanceCounter(&start);
+		AppendLines(block.data(), whole, out, threadCount);
+
+		// Guess the totals from the first block, so the output doesn't keep growing (and copying)
+		if (parsedBytes == 0 && !atEnd && stream.GetSizeHint() > whole) {
+			double scale = (double)stream.GetSizeHint() / whole * 1.05;
+			out.positions.reserve((size_t)(out.positions.size() * scale));
+			out.normals.reserve((size_t)(out.normals.size() * scale));
+			out.uvs.reserve((size_t)(out.uvs.size() * scale));
+			out.indices.reserve((size_t)(out.indices.size() * scale));
+		}
+		parsedBytes += whole;
+
+		QueryPerformanceCounter(&stop);
+		parseSeconds += (double)(stop.QuadPart - start.QuadPart) / (double)frequency.QuadPart;
+
+		if (atEnd)
+			break;
+		carried = length - whole;
+		memmove(block.data(), block.data() + whole, carried);
+	}
+
+	if (stats != nullptr) {
+		const StreamStats& streamStats = stream.GetStats();
+		stats->bytes = streamStats.bytes;
+		stats->seconds = parseSeconds;
+		stats->compression = stream.GetCompression();
+		stats->fileBytes = streamStats.fileBytes;
+		stats->readSeconds = streamStats.readSeconds;
+		stats->decompressSeconds = streamStats.decompressSeconds;
+	}
+	return !stream.HasFailed();
+}
+
+void ObjParser::Parse(const char* text, size_t length, ObjData& out)
+{
+	out.positions.clear();
+	out.normals.clear();
+	out.uvs.clear();
+	out.indices.clear();
+	out.materialLibraries.clear();
+	out.materialUses.clear();
+	AppendLines(text, length, out, (s_threadCount > 0) ? s_threadCount : GetHardwareThreadCount());
+}
+
+bool ObjParser::ParseMaterialFile(const char* pathToFile, std::vector<ObjMaterial>& out)
+{
+	MappedFile file(pathToFile);
+	if (!file.IsOpen())
+		return false;
+
+	ParseMaterials(file.GetData(), file.GetSize(), out);
+	return true;
+}
+
+void ObjParser::ParseMaterials(const char* text, size_t length, std::vector<ObjMaterial>& out)
+{
+	size_t current = out.size();
+	bool hasOpacity = false;
+
+	const char* end = text + length;
+	const char* next = nullptr;
+	for (const char* p = text; p < end; p = next) {
+		const char* lineEnd = FindLineEnd(p, end, &next);
+		p = SkipSpaces(p, lineEnd);
+
+		if (IsKeyword(p, lineEnd, "newmtl", 6)) {
+			current = out.size();
+			out.push_back(ObjMaterial());
+			out[current].name = ReadRest(p + 6, lineEnd);
+			hasOpacity = false;
+			continue;
+		}
+
+		// Anything before the first material has nothing to go in
+		if (current >= out.size())
+			continue;
+
+		ObjMaterial& material = out[current];
+		if (IsKeyword(p, lineEnd, "Kd", 2)) ScanColor(p + 2, lineEnd, material.diffuse);
+		else if (IsKeyword(p, lineEnd, "Ks", 2)) ScanColor(p + 2, lineEnd, material.specular);
+		else if (IsKeyword(p, lineEnd, "Ns", 2)) ScanFloat(p + 2, lineEnd, material.specularExponent);
+		else if (IsKeyword(p, lineEnd, "d", 1)) {
+			ScanFloat(p + 1, lineEnd, material.opacity);
+			hasOpacity = true;
+		}
+		else if (IsKeyword(p, lineEnd, "Tr", 2) && !hasOpacity) {
+			// Transparency, the opposite of "d" (which wins if there's both)
+			float transparency = 0.0f;
+			ScanFloat(p + 2, lineEnd, transparency);
+			material.opacity = 1.0f - transparency;
+		}
+		else if (IsKeyword(p, lineEnd, "map_Kd", 6)) material.diffuseMap = ReadTextureName(p + 6, lineEnd);
+		else if (IsKeyword(p, lineEnd, "map_bump", 8)) material.normalMap = ReadTextureName(p + 8, lineEnd);
+		else if (IsKeyword(p, lineEnd, "bump", 4)) material.normalMap = ReadTextureName(p + 4, lineEnd);
+		else if (IsKeyword(p, lineEnd, "norm", 4)) material.normalMap = ReadTextureName(p + 4, lineEnd);
+	}
+}
+
+bool ObjParser::ParseMaterialLibraries(const char* objPath, const std::vector<std::string>& libraries, std::vector<ObjMaterial>& out)
+{
+	// Library names are relative to the folder the OBJ file is in
+	std::string folder = objPath;
+	size_t slash = folder.find_last_of("/\\");
+	folder.resize(slash == std::string::npos ? 0 : slash + 1);
+
+	bool found = true;
+	for (const std::string& library : libraries) {
+		if (!ParseMaterialFile((folder + library).c_str(), out))
+			found = false;
+	}
+	return found;
+}
+
+void ObjParser::SetReportThroughput(bool report) { s_reportThroughput = report; }
+bool ObjParser::GetReportThroughput() { return s_reportThroughput; }
+
+void ObjParser::SetThreadCount(unsigned int threadCount) { s_threadCount = threadCount; }
+unsigned int ObjParser::GetThreadCount() { return s_threadCount; }
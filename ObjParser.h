@@ -0,0 +1,125 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+#include "CompressedStream.h"
+
+// One corner of an OBJ face, as 0-based indices into the ObjData arrays.
+// - A value of -1 means the corner doesn't reference that attribute.
+struct ObjIndex
+{
+	int position;
+	int uv;
+	int normal;
+};
+
+// A "usemtl" record: the triangles from firstIndex up to the next one use this material.
+struct ObjMaterialUse
+{
+	std::string name;
+	size_t firstIndex;		// Into ObjData::indices (a multiple of 3)
+};
+
+// A material from an MTL file (just what the renderer has any use for).
+struct ObjMaterial
+{
+	std::string name;
+	DirectX::XMFLOAT3 diffuse = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);	// Kd
+	DirectX::XMFLOAT3 specular = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);	// Ks
+	float specularExponent = 0.0f;		// Ns
+	float opacity = 1.0f;				// d (or 1 - Tr)
+	std::string diffuseMap;				// map_Kd, as written in the file
+	std::string normalMap;				// map_bump, bump or norm
+};
+
+// Raw data read from an OBJ file, before any vertices are assembled.
+// - Faces are fanned into triangles as they're read, so every
+//   three entries of "indices" make up one triangle.
+// - Nothing is converted (handedness, UV origin, etc), the values
+//   are exactly what the file contains.
+struct ObjData
+{
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<DirectX::XMFLOAT2> uvs;
+	std::vector<ObjIndex> indices;
+	std::vector<std::string> materialLibraries;		// "mtllib" file names, relative to the OBJ file
+	std::vector<ObjMaterialUse> materialUses;		// In file order (empty if it never says)
+};
+
+// Timing information about a single parse.
+// - Reading and inflating a compressed file are timed apart from
+//   the parse, so the three can be weighed against each other.
+struct ObjParseStats
+{
+	size_t bytes = 0;		// Size of the text that was parsed.
+	double seconds = 0.0;	// Time spent parsing (not including opening/mapping the file).
+	StreamCompression compression = StreamCompression_None;
+	size_t fileBytes = 0;			// Read from disk (the same as bytes unless it's compressed)
+	double readSeconds = 0.0;		// Only for compressed files (mapped ones are paged in as they're parsed)
+	double decompressSeconds = 0.0;
+
+	double GetMegabytesPerSecond() const;
+};
+
+// --------------------------------------------------------
+// Reads Wavefront OBJ text into an ObjData
+//
+// - Files are memory mapped and tokenized in a single pass
+//   with a hand-written number scanner (no sscanf, no per-line
+//   copies, no limit on line length).
+// - A quick pre-count of the records is used to size the
+//   output vectors, so they never grow while parsing.
+// - Large files are split into chunks at line boundaries and
+//   the chunks are parsed on several threads at once, each into
+//   its own part of the output (found with a prefix sum of the
+//   per-chunk counts). The result is identical to a serial parse.
+// - Supports "v", "vt", "vn" and "f" records, with any of the
+//   v, v/t, v//n or v/t/n face formats and negative (relative)
+//   indices, plus "mtllib" and "usemtl". Everything else is skipped.
+// - MTL files are read separately (they're small, so on one thread).
+// - gzip compressed files are streamed instead: they're inflated
+//   StreamBlockSize bytes at a time and each block's whole lines
+//   are parsed (as above) before the next is inflated, so the whole
+//   text is never in memory at once.
+// --------------------------------------------------------
+class ObjParser
+{
+public:
+	// Text inflated and parsed at a time when streaming (longer lines still work).
+	static const size_t StreamBlockSize = 1024 * 1024;
+
+	// Parse a file from disk, compressed or not.
+	// - Returns false if the file can't be opened (or is corrupt or in a format that can't be read).
+	static bool ParseFile(const char* pathToFile, ObjData& out, ObjParseStats* stats = nullptr);
+
+	// Parse OBJ text from a stream, a block at a time. Returns false if the stream fails.
+	static bool ParseStream(CompressedStream& stream, ObjData& out, ObjParseStats* stats = nullptr);
+
+	// Parse OBJ text that is already in memory (does not need to be null terminated).
+	static void Parse(const char* text, size_t length, ObjData& out);
+
+	// Parse an MTL file, adding its materials to "out". Returns false if the file can't be opened.
+	static bool ParseMaterialFile(const char* pathToFile, std::vector<ObjMaterial>& out);
+
+	// Parse MTL text that is already in memory.
+	static void ParseMaterials(const char* text, size_t length, std::vector<ObjMaterial>& out);
+
+	// Parse the material libraries an OBJ file refers to (ObjData::materialLibraries, found next to it).
+	// - Returns false if any of them can't be opened (the rest are still read).
+	static bool ParseMaterialLibraries(const char* objPath, const std::vector<std::string>& libraries, std::vector<ObjMaterial>& out);
+
+	// When enabled, ParseFile prints the parse throughput (MB/s) of every file.
+	static void SetReportThroughput(bool report);
+	static bool GetReportThroughput();
+
+	// The most threads a single parse will use (0, the default, means one per hardware thread).
+	// - Files under 64 KB per thread are split into fewer chunks, down to a single one.
+	static void SetThreadCount(unsigned int threadCount);
+	static unsigned int GetThreadCount();
+
+private:
+	static bool s_reportThroughput;
+	static unsigned int s_threadCount;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// The number of threads the hardware can actually run at once (at least 1).
+inline unsigned int GetHardwareThreadCount()
+{
+	unsigned int count = std::thread::hardware_concurrency();
+	return (count > 0) ? count : 1;
+}
+
+// --------------------------------------------------------
+// Calls body(i) for every i in [0, count), spread across threads
+//
+// - threadCount of 0 means one thread per hardware thread.
+// - The calling thread does work too, so a threadCount of 1
+//   (or a count of 1) runs everything inline, with no threads.
+// - Items are handed out one at a time as threads finish, so
+//   uneven items still balance out. Make each item a decent
+//   amount of work (a chunk, not a single element).
+// - Returns once every item is done.
+// --------------------------------------------------------
+template<typename Body>
+void ParallelFor(size_t count, unsigned int threadCount, const Body& body)
+{
+	if (threadCount == 0)
+		threadCount = GetHardwareThreadCount();
+	if (threadCount > count)
+		threadCount = (unsigned int)count;
+
+	if (threadCount <= 1) {
+		for (size_t i = 0; i < count; i++)
+			body(i);
+		return;
+	}
+
+	std::atomic<size_t> nextItem(0);
+	auto worker = [&]() {
+		for (size_t i = nextItem++; i < count; i = nextItem++)
+			body(i);
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (unsigned int t = 1; t < threadCount; t++)
+		threads.emplace_back(worker);
+
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+}
@@ -7,16 +7,22 @@ class Player
 {
 private:
 	// Objects describing this player
+	Transform m_root;		// Where the player is; the entity and camera are attached to it
 	std::shared_ptr<GameEntity> m_gameEntity;
 	std::unique_ptr<Camera> m_camera;
 
 	// Vars
 	float m_movementSpeed = 4.0f;
+
+	// The last box GetMinMaxARBB worked out, and what it was worked out from
+	DirectX::BoundingBox m_bounds;
+	uint64_t m_boundsGeneration = 0;	// Of the entity's transform (0 before the first)
+	bool m_boundsExactHull = false;
 public:
 	Player(DirectX::XMFLOAT3 position, std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material, float windowAspectRatio);
 	void Update(float dt, HWND windowHandle);
 	void Teleport(DirectX::XMFLOAT3 position);
-	DirectX::BoundingBox GetMinMaxARBB();
+	DirectX::BoundingBox GetMinMaxARBB(bool exactHull = false);	// See Mesh::GetWorldBoundingBox
 
 	// Getters and setters
 	Camera* GetCamera();
@@ -46,6 +46,33 @@ struct VertexShaderInput
 	float3 tangent		: TANGENT;		// Tangent to the UV
 };
 
+// Smaller versions of VertexShaderInput
+// - These match PackedVertex and QuantizedVertex in Vertex.h
+// - The input layout is built from these types, so everything
+//   packed is read as raw uints and unpacked by hand below
+struct VertexShaderInputPacked
+{
+	float3 position		: POSITION;
+	uint normal			: NORMAL;		// Octahedral, 2x 16 bit snorm
+	uint uv				: TEXCOORD;		// 2x half
+	uint tangent		: TANGENT;		// Octahedral, 2x 16 bit snorm
+};
+
+struct VertexShaderInputQuantized
+{
+	uint2 position		: POSITION;		// XYZ as 16 bit unorms across the mesh bounds
+	uint normal			: NORMAL;
+	uint uv				: TEXCOORD;
+	uint tangent		: TANGENT;
+};
+
+// Just the position, for depth only passes (shadows)
+// - Matches a mesh's position stream, and the start of a full Vertex
+struct VertexShaderInputPosition
+{
+	float3 position		: POSITION;
+};
+
 // Struct representing the data we expect to receive from earlier pipeline stages
 // - Should match the output of our corresponding vertex shader
 // - The name of the struct itself is unimportant
@@ -110,6 +137,124 @@ struct VertexToPixelSky
 // Vertex Shader Includes
 // -------------------------------------------------------------- //
 
+// Unpacking of the smaller vertex formats (must match VertexPacker on the CPU)
+
+// Two 16 bit snorms, x in the low half
+float2 UnpackSnorm16x2(uint packed)
+{
+	int2 bits = int2(asint(packed << 16) >> 16, asint(packed) >> 16);
+	return max(bits / 32767.0f, -1.0f);
+}
+
+// Octahedral encoded unit vector
+float3 UnpackOctahedral(uint packed)
+{
+	float2 e = UnpackSnorm16x2(packed);
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+
+	// Unfold the lower half of the octahedron
+	float t = saturate(-n.z);
+	n.x += (n.x >= 0.0f) ? -t : t;
+	n.y += (n.y >= 0.0f) ? -t : t;
+	return normalize(n);
+}
+
+// Two halfs, x in the low half
+float2 UnpackHalf2(uint packed)
+{
+	return f16tof32(uint2(packed, packed >> 16));
+}
+
+// Position quantized across the mesh bounds (position = min + quantized * scale)
+float3 UnpackQuantizedPosition(uint2 packed, float3 positionMin, float3 positionScale)
+{
+	uint3 quantized = uint3(packed.x & 0xFFFF, packed.x >> 16, packed.y & 0xFFFF);
+	return positionMin + quantized * positionScale;
+}
+
+// Full VertexShaderInputs, so the rest of a shader doesn't change
+VertexShaderInput UnpackVertex(VertexShaderInputPacked packed)
+{
+	VertexShaderInput input;
+	input.position = packed.position;
+	input.normal = UnpackOctahedral(packed.normal);
+	input.uv = UnpackHalf2(packed.uv);
+	input.tangent = UnpackOctahedral(packed.tangent);
+	return input;
+}
+
+VertexShaderInput UnpackVertex(VertexShaderInputQuantized packed, float3 positionMin, float3 positionScale)
+{
+	VertexShaderInput input;
+	input.position = UnpackQuantizedPosition(packed.position, positionMin, positionScale);
+	input.normal = UnpackOctahedral(packed.normal);
+	input.uv = UnpackHalf2(packed.uv);
+	input.tangent = UnpackOctahedral(packed.tangent);
+	return input;
+}
+
+// Shared by the normal map vertex shaders (VS_Normal, VS_NormalPacked, VS_NormalQuantized),
+// which define NORMAL_MAP_VERTEX_SHADER before including this
+// - One constant buffer for all of them, so Game::SetMaterial sets the same
+//   variables whatever the mesh's vertex format
+#ifdef NORMAL_MAP_VERTEX_SHADER
+
+// Constant buffer for data
+cbuffer ExternalData : register(b0)
+{
+	float4 colorTint;
+	row_major float3x4 worldMatrix;	// Affine, the top three rows (see AffineMatrix in AffineMatrix.h)
+	row_major float3x4 normalMatrix;	// Inverse transpose of worldMatrix (see AffineMatrix::GetNormalMatrix)
+	matrix worldViewProj;	// World, then the camera's view and projection (see WorldViewProjBatch)
+	float4 specular;	// The specular value of the vertex (gets passed directly to the pixel shader, value is the x value).
+	
+	// Shadow things
+	float numOfObjects;
+
+	// Dequantization of the positions (from Mesh::GetPositionQuantization, only used by VS_NormalQuantized)
+	float3 positionMin;
+	float3 positionScale;
+}
+
+// Everything the normal map vertex shaders do once their vertex is unpacked
+VertexToPixelNormalMap TransformVertex(VertexShaderInput input)
+{
+	// Set up output struct
+	VertexToPixelNormalMap output;
+
+
+	// Here we're essentially passing the input position directly through to the next
+	// stage (rasterizer), though it needs to be a 4-component vector now.  
+	// - To be considered within the bounds of the screen, the X and Y components 
+	//   must be between -1 and 1.  
+	// - The Z component must be between 0 and 1.  
+	// - Each of these components is then automatically divided by the W component, 
+	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
+	//   a perspective projection matrix, which we'll get to in future assignments).
+	output.position = mul(worldViewProj, float4(input.position, 1.0f));
+
+
+	// Calculate the world position of the vertex.
+	output.worldPos = mul(worldMatrix, float4(input.position, 1.0f));
+
+
+	// Pass the normal and tangent vector through with minor changes
+	// - The normal goes through the normal matrix, so it stays at right angles to the
+	//   surface when it's scaled unevenly; the tangent lies along it, so it uses the world matrix
+	// - Since we don't care about translations, cast as a 3x3
+	output.normal = mul((float3x3) normalMatrix, input.normal);
+	output.tangent = normalize(mul((float3x3) worldMatrix, input.tangent));
+
+
+	// Pass the color, specular, and uv through
+	output.color = colorTint;
+	output.specular = specular;
+	output.uv = input.uv;
+
+	return output;
+}
+
+#endif
 
 
 
@@ -117,26 +117,32 @@ void Shadow::Draw(std::vector<std::shared_ptr<GameEntity>> entities,
 	m_vertexShader->SetShader();
 	context->PSSetShader(0, 0, 0); // Turns OFF the pixel shader!
 
-	// Render each entity to each light.
+	// Every entity's world * view * projection from every light, all at once
+	m_batch.Clear();
 	for (auto& light : lights) {
 
 		if (light == nullptr) break;	// Failsafe, as size is returning capacity for some reason.
 
 		// Get the view and proj matrix from the light.
 		ViewAndProjMatrices vpMatrices = light->GetMatrices();
-		m_vertexShader->SetMatrix4x4("viewMatrix", vpMatrices.View);
-		m_vertexShader->SetMatrix4x4("projMatrix", vpMatrices.Proj);
+		m_batch.AddView(vpMatrices.View, vpMatrices.Proj);
+	}
+	for (auto& e : entities)
+		m_batch.AddWorld(e->GetTransform()->GetWorldAffine());
+	m_batch.Compute();
+
+	// Render each entity to each light.
+	for (uint32_t light = 0; light < m_batch.GetViewCount(); light++) {
 
 		// Loop and render all entities
-		for (auto& e : entities)
+		for (uint32_t i = 0; i < entities.size(); i++)
 		{
-			// Grab this entity's world matrix and
-			// send to the VS
-			m_vertexShader->SetMatrix4x4("worldMatrix", e->GetTransform()->GetWorldMatrix());
+			// Send this entity's matrix from this light to the VS
+			m_vertexShader->SetMatrix4x4("worldViewProj", m_batch.Get(light, i));
 			m_vertexShader->CopyAllBufferData();
 
-			// Only draw the current entity
-			e->GetMesh()->Draw(context);
+			// Only draw the current entity (just its positions)
+			entities[i]->GetMesh()->DrawPositions(context);
 		}
 	}
 
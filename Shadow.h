@@ -3,6 +3,7 @@
 #include "SimpleShader.h"
 #include "GameEntity.h"
 #include "Light.h"
+#include "WorldViewProjBatch.h"
 
 class Shadow
 {
@@ -11,6 +12,9 @@ private:
 	DirectX::XMFLOAT4X4 m_viewMatrix;
 	DirectX::XMFLOAT4X4 m_projMatrix;
 
+	// World * view * projection of every entity from every light (kept to reuse its memory)
+	WorldViewProjBatch m_batch;
+
 	// ComPtrs for all of the DirectX vars
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> m_sampler;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> m_rasterizer;
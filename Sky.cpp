@@ -62,15 +62,9 @@ void Sky::Draw(Camera* camera, ID3D11DeviceContext* context)
 void Sky::DrawMesh(Mesh* mesh, ID3D11DeviceContext* context)
 {
 	// Set buffers in the input assembler
-	//  - Do this ONCE PER OBJECT you're drawing, since each object might
-	//    have different geometry.
-	//  - for this demo, this step *could* simply be done once during Init(),
-	//    but I'm doing it here because it's often done multiple times per frame
-	//    in a larger application/game
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	context->IASetVertexBuffers(0, 1, mesh->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
+	//  - Only changes them if the last mesh drawn was in a different pool
+	//    (or had its own buffers)
+	mesh->Bind(context);
 
 
 	// Finally do the actual drawing
@@ -80,6 +74,6 @@ void Sky::DrawMesh(Mesh* mesh, ID3D11DeviceContext* context)
 	//     vertices in the currently set VERTEX BUFFER
 	context->DrawIndexed(
 		mesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+		mesh->GetFirstIndex(),     // Offset to the first index we want to use
+		mesh->GetBaseVertex());    // Offset to add to each index when looking up vertices
 }
\ No newline at end of file
@@ -0,0 +1,2068 @@
+// --------------------------------------------------------
+// MeshCook - command line tool for cooked (binary) meshes
+//
+// Builds the same .meshcache files the game writes on first
+// load, so they can be made ahead of deployment, and prints
+// what's inside existing ones.  Also hosts the benchmarks for
+// the CPU side of mesh loading and of transforms.
+//
+// Everything it builds from the game's folder has no D3D in
+// it, so it can be run and checked here on its own: mesh
+// loading and cooking, GeometryAllocator (bench-pool),
+// TransformHierarchy (bench-hierarchy), TransformSystem
+// (bench-entities) and WorldViewProjBatch (bench-wvp).
+// --------------------------------------------------------
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include "GeometryAllocator.h"
+#include "MeshBounds.h"
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshPrimitives.h"
+#include "MeshSimplifier.h"
+#include "ObjParser.h"
+#include "ParallelFor.h"
+#include "TransformHierarchy.h"
+#include "TransformSystem.h"
+#include "VertexPacker.h"
+#include "VertexTransform.h"
+#include "WorldViewProjBatch.h"
+
+// Only used as a reference for bench-import
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "Include/tiny_obj_loader.h"
+
+using namespace DirectX;
+
+namespace
+{
+	void PrintUsage()
+	{
+		printf("Usage:\n");
+		printf("  MeshCook cook [-optimize] [-lods] [-meshlets] [-positions] <model.obj> [...]\n");
+		printf("                                                       Cook next to each model (model.obj.meshcache)\n");
+		printf("  MeshCook cook [-optimize] [-lods] [-meshlets] [-positions] <model.obj> -o <file>\n");
+		printf("                                                       Cook to a specific file\n");
+		printf("  MeshCook inspect <file.meshcache> [<model.obj>]      Print a cooked file (and check it against its model)\n");
+		printf("  MeshCook synth <out.obj> <triangles>                 Write a synthetic grid model with (at least) that many triangles\n");
+		printf("  MeshCook bench-parse [-threads N] <model.obj> [...]  Time the OBJ parser on 1, 2, 4, ... N threads\n");
+		printf("  MeshCook bench-tangents <model.obj> [...]            Time the tangent calculation (and check it against the scalar version)\n");
+		printf("  MeshCook bench-optimize <model.obj> [...]            Time the mesh optimizer and print ACMR/ATVR before and after\n");
+		printf("  MeshCook pack <model.obj> [...]                      Print the size and error of each packed vertex format\n");
+		printf("  MeshCook lod <model.obj> [...]                       Build the levels of detail and print their size, error and selection\n");
+		printf("  MeshCook bench-meshlets <model.obj> [...]            Build meshlets and time culling them along scripted camera paths\n");
+		printf("  MeshCook bounds <model.obj> [...]                    Check and time world space boxes from every vertex, the hull and the local box\n");
+		printf("  MeshCook bench-transform <model.obj> [...]           Time transforming every vertex one at a time and as streams\n");
+		printf("  MeshCook bench-pool <model.obj> [...]                Fill a geometry pool with the models, churn it, and print occupancy and fragmentation\n");
+		printf("  MeshCook positions <model.obj> [...]                 Build and check the position stream, and compare what a depth pass fetches\n");
+		printf("  MeshCook bench-import <model.obj> [...]              Time importing with and without materials (and with tiny_obj_loader), and check the submeshes\n");
+		printf("  MeshCook bench-load <file> [...]                     Time reading, inflating and parsing models or cooked files (plain or gzip)\n");
+		printf("  MeshCook primitives [<models folder>]                Build and check every primitive shape (and time them against the models of the same shapes)\n");
+		printf("  MeshCook bench-hierarchy [nodes]                     Time updating deep, wide and random transform hierarchies (100000 nodes by default)\n");
+		printf("  MeshCook affine [matrices]                           Check 3x4 affine matrices and their normal matrices against XMMATRIX, and time both (100000 by default)\n");
+		printf("  MeshCook bench-entities [entities]                   Time building world matrices for 16 up to that many entities (1048576 by default), one object at a time and packed\n");
+		printf("  MeshCook bench-wvp [entities]                        Time world * view * projection for 16 up to that many entities (65536 by default) from a camera and 4 shadows, one at a time and batched\n");
+	}
+
+	// High resolution timer, in seconds.
+	double GetSeconds()
+	{
+		LARGE_INTEGER frequency, counter;
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&counter);
+		return (double)counter.QuadPart / (double)frequency.QuadPart;
+	}
+
+	// The best time of a few runs of body, calling setup(run) (untimed) before each.
+	template<typename Setup, typename Body>
+	double TimeBest(int runs, const Setup& setup, const Body& body)
+	{
+		double best = 0.0;
+		for (int run = 0; run < runs; run++) {
+			setup(run);
+			double start = GetSeconds();
+			body();
+			double seconds = GetSeconds() - start;
+			if (run == 0 || seconds < best) best = seconds;
+		}
+		return best;
+	}
+
+	template<typename Body>
+	double TimeBest(int runs, const Body& body)
+	{
+		return TimeBest(runs, [](int) {}, body);
+	}
+
+	// The sizes a benchmark goes through: 16, then 16 times more each time, ending with maxCount.
+	uint32_t GetNextCount(uint32_t count, uint32_t maxCount)
+	{
+		return (count < maxCount && count * 16 > maxCount) ? maxCount : count * 16;
+	}
+
+	template<typename T>
+	bool SameContents(const std::vector<T>& a, const std::vector<T>& b)
+	{
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	bool SameMaterialUses(const std::vector<ObjMaterialUse>& a, const std::vector<ObjMaterialUse>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); i++) {
+			if (a[i].name != b[i].name || a[i].firstIndex != b[i].firstIndex)
+				return false;
+		}
+		return true;
+	}
+
+	const char* GetCompressionName(StreamCompression compression)
+	{
+		switch (compression) {
+		case StreamCompression_Gzip: return "gzip";
+		case StreamCompression_Zstd: return "zstd";
+		default: return "none";
+		}
+	}
+
+	int Cook(int argc, char* argv[])
+	{
+		uint32_t buildFlags = MeshBuild_None;
+		while (argc >= 1 && argv[0][0] == '-') {
+			if (strcmp(argv[0], "-optimize") == 0) buildFlags |= MeshBuild_Optimize;
+			else if (strcmp(argv[0], "-lods") == 0) buildFlags |= MeshBuild_Lods;
+			else if (strcmp(argv[0], "-meshlets") == 0) buildFlags |= MeshBuild_Meshlets;
+			else if (strcmp(argv[0], "-positions") == 0) buildFlags |= MeshBuild_PositionStream;
+			else break;
+			argc--;
+			argv++;
+		}
+
+		// Single model with an explicit output?
+		if (argc == 3 && strcmp(argv[1], "-o") == 0) {
+			if (!MeshCache::Cook(argv[0], argv[2], buildFlags)) {
+				printf("Failed to cook %s\n", argv[0]);
+				return 1;
+			}
+			printf("Cooked %s -> %s\n", argv[0], argv[2]);
+			return 0;
+		}
+
+		int failures = 0;
+		for (int i = 0; i < argc; i++) {
+			std::string cachePath = MeshCache::GetCachePath(argv[i]);
+			if (MeshCache::Cook(argv[i], cachePath.c_str(), buildFlags)) {
+				printf("Cooked %s -> %s\n", argv[i], cachePath.c_str());
+			}
+			else {
+				printf("Failed to cook %s\n", argv[i]);
+				failures++;
+			}
+		}
+		return failures > 0 ? 1 : 0;
+	}
+
+	int Inspect(const char* cachePath, const char* sourcePath)
+	{
+		MeshCacheFile cache(cachePath);
+		if (!cache.IsValid()) {
+			printf("%s: missing, malformed or not format version %u\n", cachePath, MeshCache::FormatVersion);
+			return 1;
+		}
+
+		const MeshCacheHeader* header = cache.GetHeader();
+		printf("%s\n", cachePath);
+		printf("  Version:      %u\n", header->version);
+		printf("  Source hash:  %016llx\n", (unsigned long long)header->sourceHash);
+		printf("  Build flags:  0x%08x\n", header->buildFlags);
+		printf("  Vertices:     %u (%u bytes each)\n", header->vertexCount, header->vertexStride);
+		printf("  Indices:      %u (%u triangles)\n", header->indexCount, header->indexCount / 3);
+		if (header->buildFlags & MeshBuild_Lods) {
+			printf("  LOD settings: %u levels, triangle ratio %g, max error %g\n",
+				header->lodSettings.maxLevels, header->lodSettings.triangleRatio, header->lodSettings.maxError);
+		}
+		for (uint32_t i = 0; i < header->lodCount; i++) {
+			const MeshLod& lod = cache.GetLods()[i];
+			printf("  LOD %u:        %u triangles at index %u, error %g\n", i, lod.indexCount / 3, lod.indexOffset, lod.error);
+		}
+		if (header->meshletCount > 0)
+			printf("  Meshlets:     %u (%.1f triangles each)\n", header->meshletCount, (double)cache.GetLods()[0].indexCount / 3 / header->meshletCount);
+		uint32_t submeshesPerLevel = header->submeshCount / header->lodCount;
+		for (uint32_t i = 0; i < submeshesPerLevel; i++) {
+			const MeshSubmesh& submesh = cache.GetSubmeshes()[i];
+			printf("  Submesh %u:    %-16s %u triangles at index %u\n", i, submesh.material, submesh.indexCount / 3, submesh.indexOffset);
+		}
+		for (const std::string& library : cache.GetMaterialLibraries())
+			printf("  Materials:    %s\n", library.c_str());
+		if (header->positionCount > 0) {
+			// Every corner must land where the full vertex does
+			const unsigned int* indices = cache.GetIndices();
+			const unsigned int* positionIndices = cache.GetPositionIndices();
+			uint32_t mismatches = 0;
+			for (uint32_t i = 0; i < header->indexCount; i++) {
+				if (memcmp(&cache.GetPositions()[positionIndices[i]], &cache.GetVertices()[indices[i]].Position, sizeof(XMFLOAT3)) != 0)
+					mismatches++;
+			}
+			printf("  Positions:    %u (%s)\n", header->positionCount, mismatches == 0 ? "every corner matches" : "MISMATCHED");
+		}
+		printf("  Bounds min:   (%f, %f, %f)\n", header->boundsMin.x, header->boundsMin.y, header->boundsMin.z);
+		printf("  Bounds max:   (%f, %f, %f)\n", header->boundsMax.x, header->boundsMax.y, header->boundsMax.z);
+		printf("  File size:    %llu bytes\n", (unsigned long long)header->fileSize);
+		const MeshCacheReadStats& readStats = cache.GetReadStats();
+		if (readStats.compression != StreamCompression_None)
+			printf("  Compressed:   %zu bytes (%.2fx)\n", readStats.stream.fileBytes, readStats.stream.GetRatio());
+
+		VertexCacheStats cacheStats = MeshOptimizer::AnalyzeVertexCache(cache.GetIndices() + cache.GetLods()[0].indexOffset, cache.GetLods()[0].indexCount, header->vertexCount);
+		printf("  Vertex cache: ACMR %.3f, ATVR %.3f\n", cacheStats.GetACMR(), cacheStats.GetATVR());
+
+		// Compare against the source model, if there is one
+		std::string source = (sourcePath != nullptr) ? sourcePath : "";
+		const char* suffix = ".meshcache";
+		size_t length = strlen(cachePath);
+		if (source.empty() && length > strlen(suffix) && strcmp(cachePath + length - strlen(suffix), suffix) == 0)
+			source.assign(cachePath, length - strlen(suffix));
+
+		uint64_t sourceHash = 0;
+		if (!source.empty() && MeshCache::HashFile(source.c_str(), &sourceHash)) {
+			printf("  Source:       %s (%s)\n", source.c_str(), sourceHash == header->sourceHash ? "up to date" : "STALE");
+		}
+		return 0;
+	}
+
+	int Synth(const char* outPath, const char* triangleText)
+	{
+		// A square grid of quads, two triangles each
+		double triangles = atof(triangleText);
+		int size = (int)ceil(sqrt((triangles > 2 ? triangles : 2) / 2.0));
+		int side = size + 1;
+
+		FILE* file = nullptr;
+		if (fopen_s(&file, outPath, "wb") != 0 || file == nullptr) {
+			printf("Couldn't open %s\n", outPath);
+			return 1;
+		}
+
+		// Format into a big buffer, one write at a time
+		std::vector<char> buffer(1 << 20);
+		size_t used = 0;
+		auto flush = [&](size_t needed) {
+			if (used + needed > buffer.size()) {
+				fwrite(buffer.data(), 1, used, file);
+				used = 0;
+			}
+		};
+
+		fprintf(file, "# Synthetic %dx%d grid (%lld triangles)\n", size, size, 2LL * size * size);
+		for (int y = 0; y < side; y++) {
+			for (int x = 0; x < side; x++) {
+				flush(128);
+				used += sprintf_s(&buffer[used], buffer.size() - used, "v %.6f %.6f %.6f\nvt %.6f %.6f\n",
+					x - size * 0.5f, sinf(x * 0.1f) * cosf(y * 0.1f), y - size * 0.5f,
+					(float)x / size, (float)y / size);
+			}
+		}
+		flush(128);
+		used += sprintf_s(&buffer[used], buffer.size() - used, "vn 0.000000 1.000000 0.000000\n");
+
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				long long a = (long long)y * side + x + 1;
+				long long b = a + 1;
+				long long c = a + side + 1;
+				long long d = a + side;
+				flush(128);
+				used += sprintf_s(&buffer[used], buffer.size() - used, "f %lld/%lld/1 %lld/%lld/1 %lld/%lld/1 %lld/%lld/1\n",
+					a, a, b, b, c, c, d, d);
+			}
+		}
+		flush(buffer.size());
+		fclose(file);
+
+		printf("Wrote %s (%lld vertices, %lld triangles)\n", outPath, (long long)side * side, 2LL * size * size);
+		return 0;
+	}
+
+	int BenchParse(int argc, char* argv[])
+	{
+		const int runs = 3;
+		unsigned int maxThreads = GetHardwareThreadCount();
+		if (argc >= 2 && strcmp(argv[0], "-threads") == 0) {
+			maxThreads = (unsigned int)atoi(argv[1]);
+			if (maxThreads < 1) maxThreads = 1;
+			argc -= 2;
+			argv += 2;
+		}
+		printf("%u hardware threads, up to %u used, best of %d runs\n", GetHardwareThreadCount(), maxThreads, runs);
+
+		for (int i = 0; i < argc; i++) {
+			ObjData reference;
+			double serialSeconds = 0.0;
+			size_t bytes = 0;
+
+			printf("%s\n", argv[i]);
+			for (unsigned int threads = 1; ; threads = (threads * 2 < maxThreads) ? threads * 2 : maxThreads) {
+				ObjParser::SetThreadCount(threads);
+
+				ObjData data;
+				ObjParseStats best;
+				for (int run = 0; run < runs; run++) {
+					ObjParseStats stats;
+					if (!ObjParser::ParseFile(argv[i], data, &stats)) {
+						printf("  Couldn't open the file\n");
+						return 1;
+					}
+					if (run == 0 || stats.seconds < best.seconds) best = stats;
+				}
+
+				// Everything is checked against the single threaded parse
+				bool identical = true;
+				if (threads == 1) {
+					reference = std::move(data);
+					serialSeconds = best.seconds;
+					bytes = best.bytes;
+				}
+				else {
+					identical = SameContents(data.positions, reference.positions) &&
+						SameContents(data.normals, reference.normals) &&
+						SameContents(data.uvs, reference.uvs) &&
+						SameContents(data.indices, reference.indices) &&
+						SameMaterialUses(data.materialUses, reference.materialUses);
+				}
+
+				printf("  %2u threads: %9.2f ms %8.1f MB/s  %5.2fx%s\n",
+					threads,
+					best.seconds * 1000.0,
+					best.GetMegabytesPerSecond(),
+					best.seconds > 0.0 ? serialSeconds / best.seconds : 0.0,
+					identical ? "" : "  MISMATCH");
+				if (!identical)
+					return 1;
+
+				if (threads >= maxThreads) break;
+			}
+
+			printf("  %.2f MB, %zu positions, %zu triangles\n",
+				bytes / (1024.0 * 1024.0), reference.positions.size(), reference.indices.size() / 3);
+		}
+
+		ObjParser::SetThreadCount(0);
+		return 0;
+	}
+
+	// The tangent calculation as it was before MeshBuilder::CalculateTangents (one thread, DirectXMath), to compare against.
+	void CalculateTangentsScalar(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+	{
+		for (int i = 0; i < numVerts; i++)
+			verts[i].Tangent = XMFLOAT3(0, 0, 0);
+
+		for (int i = 0; i + 2 < numIndices; i += 3) {
+			Vertex* v1 = &verts[indices[i]];
+			Vertex* v2 = &verts[indices[i + 1]];
+			Vertex* v3 = &verts[indices[i + 2]];
+
+			float x1 = v2->Position.x - v1->Position.x;
+			float y1 = v2->Position.y - v1->Position.y;
+			float z1 = v2->Position.z - v1->Position.z;
+			float x2 = v3->Position.x - v1->Position.x;
+			float y2 = v3->Position.y - v1->Position.y;
+			float z2 = v3->Position.z - v1->Position.z;
+			float s1 = v2->UV.x - v1->UV.x;
+			float t1 = v2->UV.y - v1->UV.y;
+			float s2 = v3->UV.x - v1->UV.x;
+			float t2 = v3->UV.y - v1->UV.y;
+
+			float r = 1.0f / (s1 * t2 - s2 * t1);
+			float tx = (t2 * x1 - t1 * x2) * r;
+			float ty = (t2 * y1 - t1 * y2) * r;
+			float tz = (t2 * z1 - t1 * z2) * r;
+
+			for (Vertex* v : { v1, v2, v3 }) {
+				v->Tangent.x += tx;
+				v->Tangent.y += ty;
+				v->Tangent.z += tz;
+			}
+		}
+
+		for (int i = 0; i < numVerts; i++) {
+			XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+			XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+			XMStoreFloat3(&verts[i].Tangent, XMVector3Normalize(tangent - normal * XMVector3Dot(normal, tangent)));
+		}
+	}
+
+	// How many representable floats apart two (finite) floats are.
+	uint32_t GetUlpDistance(float a, float b)
+	{
+		int32_t ia, ib;
+		memcpy(&ia, &a, sizeof(float));
+		memcpy(&ib, &b, sizeof(float));
+		if (ia < 0) ia = INT32_MIN - ia;
+		if (ib < 0) ib = INT32_MIN - ib;
+		return (ia > ib) ? (uint32_t)ia - (uint32_t)ib : (uint32_t)ib - (uint32_t)ia;
+	}
+
+	int BenchTangents(int argc, char* argv[])
+	{
+		// How far the tangents may be from the scalar version's (see MeshBuilder::CalculateTangents)
+		const double maxDegrees = 0.0001;
+
+		const int runs = 10;
+		printf("%u hardware threads, best of %d runs\n", GetHardwareThreadCount(), runs);
+		bool valid = true;
+
+		for (int i = 0; i < argc; i++) {
+			ObjData obj;
+			if (!ObjParser::ParseFile(argv[i], obj)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+
+			MeshGeometry geometry;
+			MeshBuilder::BuildFromObj(obj, geometry);
+			if (geometry.indices.empty())
+				continue;
+
+			double best = TimeBest(runs, [&]() {
+				MeshBuilder::CalculateTangents(&geometry.vertices[0], (int)geometry.vertices.size(), &geometry.indices[0], (int)geometry.indices.size());
+			});
+
+			std::vector<Vertex> scalar = geometry.vertices;
+			double scalarStart = GetSeconds();
+			CalculateTangentsScalar(&scalar[0], (int)scalar.size(), &geometry.indices[0], (int)geometry.indices.size());
+			double scalarSeconds = GetSeconds() - scalarStart;
+
+			// Only where the scalar version had a tangent at all (it gave NaNs for degenerate uvs)
+			uint32_t worstUlps = 0;
+			double worstDegrees = 0.0;
+			size_t compared = 0;
+			for (size_t v = 0; v < scalar.size(); v++) {
+				const XMFLOAT3& a = scalar[v].Tangent;
+				const XMFLOAT3& b = geometry.vertices[v].Tangent;
+				if (!std::isfinite(a.x) || !std::isfinite(a.y) || !std::isfinite(a.z) || (a.x == 0.0f && a.y == 0.0f && a.z == 0.0f))
+					continue;
+
+				compared++;
+				worstUlps = std::max(worstUlps, std::max(GetUlpDistance(a.x, b.x), std::max(GetUlpDistance(a.y, b.y), GetUlpDistance(a.z, b.z))));
+				double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+				double lengths = sqrt(((double)a.x * a.x + (double)a.y * a.y + (double)a.z * a.z) * ((double)b.x * b.x + (double)b.y * b.y + (double)b.z * b.z));
+				double cosine = std::min(1.0, std::max(-1.0, dot / lengths));
+				worstDegrees = std::max(worstDegrees, acos(cosine) * 180.0 / 3.14159265358979);
+			}
+			bool matches = worstDegrees <= maxDegrees;
+			valid = valid && matches;
+
+			size_t triangles = geometry.indices.size() / 3;
+			printf("%s: %zu vertices, %zu triangles - %.3f ms (%.1f M triangles/s), scalar %.3f ms\n",
+				argv[i],
+				geometry.vertices.size(),
+				triangles,
+				best * 1000.0,
+				best > 0.0 ? triangles / best / 1e6 : 0.0,
+				scalarSeconds * 1000.0);
+			printf("  vs scalar: %zu tangents, at most %u ulp, %.7f degrees apart  %s\n",
+				compared,
+				worstUlps,
+				worstDegrees,
+				matches ? "OK" : "MISMATCH");
+		}
+		return valid ? 0 : 1;
+	}
+
+	int BenchOptimize(int argc, char* argv[])
+	{
+		printf("FIFO cache of %u vertices\n", MeshOptimizer::DefaultCacheSize);
+
+		for (int i = 0; i < argc; i++) {
+			MeshGeometry geometry;
+			if (!MeshBuilder::BuildFromObjFile(argv[i], geometry)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+
+			MeshOptimizeStats stats;
+			MeshOptimizer::Optimize(geometry, &stats);
+
+			printf("%s: %zu vertices, %zu triangles - %.3f ms\n",
+				argv[i],
+				stats.before.vertexCount,
+				stats.before.triangleCount,
+				stats.seconds * 1000.0);
+			printf("  ACMR %.3f -> %.3f\n", stats.before.GetACMR(), stats.after.GetACMR());
+			printf("  ATVR %.3f -> %.3f\n", stats.before.GetATVR(), stats.after.GetATVR());
+		}
+		return 0;
+	}
+
+	int Pack(int argc, char* argv[])
+	{
+		const VertexFormat formats[] = { VertexFormat_Packed, VertexFormat_Quantized };
+		const char* names[] = { "Packed", "Quantized" };
+
+		for (int i = 0; i < argc; i++) {
+			MeshGeometry geometry;
+			if (!MeshBuilder::BuildFromObjFile(argv[i], geometry)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+
+			size_t fullSize = geometry.vertices.size() * sizeof(Vertex);
+			printf("%s: %zu vertices, %zu bytes as Vertex\n", argv[i], geometry.vertices.size(), fullSize);
+
+			for (int f = 0; f < 2; f++) {
+				std::vector<unsigned char> packed;
+				VertexPackError error;
+				VertexPacker::PackAs(formats[f], geometry.vertices.data(), geometry.vertices.size(), packed, nullptr, &error);
+
+				printf("  %-10s %2u bytes/vertex, %zu bytes (%.0f%%) - max error: normal %.4f deg, tangent %.4f deg, position %g, uv %g\n",
+					names[f],
+					VertexPacker::GetStride(formats[f]),
+					packed.size(),
+					fullSize > 0 ? 100.0 * packed.size() / fullSize : 0.0,
+					error.normalDegrees,
+					error.tangentDegrees,
+					error.position,
+					error.uv);
+			}
+		}
+		return 0;
+	}
+
+	int Lod(int argc, char* argv[])
+	{
+		// The game's camera and window
+		const float fovAngle = 3.14159265f / 4.0f;
+		const float screenHeight = 720.0f;
+		const float distances[] = { 1.0f, 2.0f, 5.0f, 10.0f, 20.0f, 50.0f, 100.0f };
+		float pixelsPerUnit = MeshSimplifier::GetPixelsPerUnit(fovAngle, screenHeight);
+
+		LodSettings settings;
+		printf("%u levels, triangle ratio %g, max error %g of the radius\n", settings.maxLevels, settings.triangleRatio, settings.maxError);
+
+		for (int i = 0; i < argc; i++) {
+			MeshGeometry geometry;
+			if (!MeshBuilder::BuildFromObjFile(argv[i], geometry)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+
+			double start = GetSeconds();
+			MeshSimplifier::BuildLodChain(geometry, settings);
+			double seconds = GetSeconds() - start;
+
+			printf("%s: %zu vertices - %.3f ms\n", argv[i], geometry.vertices.size(), seconds * 1000.0);
+			for (size_t level = 0; level < geometry.lods.size(); level++) {
+				const MeshLod& lod = geometry.lods[level];
+
+				// Every level has to be drawable with the shared vertices
+				bool valid = true;
+				for (uint32_t j = lod.indexOffset; j < lod.indexOffset + lod.indexCount; j++)
+					valid = valid && geometry.indices[j] < geometry.vertices.size();
+
+				printf("  LOD %zu: %7u triangles (%5.1f%%), error %g%s\n",
+					level,
+					lod.indexCount / 3,
+					100.0 * lod.indexCount / geometry.lods[0].indexCount,
+					lod.error,
+					valid ? "" : "  INVALID INDICES");
+				if (!valid)
+					return 1;
+			}
+
+			printf("  Selected at %.0f pixels per unit:", pixelsPerUnit);
+			for (float distance : distances)
+				printf(" %gm->%u", distance, MeshSimplifier::SelectLod(geometry.lods.data(), geometry.lods.size(), distance, 1.0f, pixelsPerUnit));
+			printf("\n");
+		}
+		return 0;
+	}
+
+	// A camera for one frame of a scripted path.
+	struct CameraFrame
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 target;
+	};
+
+	// Camera paths around a mesh (a bounding sphere of center/radius), frameCount frames each.
+	// - Orbits look at the mesh from all sides, the flyby passes right
+	//   through it looking ahead, so most of it is off screen.
+	void MakeCameraPath(int path, const XMFLOAT3& c, float r, int frameCount, std::vector<CameraFrame>& frames)
+	{
+		frames.resize(frameCount);
+		for (int f = 0; f < frameCount; f++) {
+			float t = (float)f / frameCount;
+			float angle = t * 6.2831853f;
+			CameraFrame& frame = frames[f];
+			if (path == 0 || path == 1) {
+				float distance = r * ((path == 0) ? 3.0f : 1.2f);
+				frame.position = XMFLOAT3(c.x + cosf(angle) * distance, c.y + sinf(angle * 2.0f) * r * 0.5f, c.z + sinf(angle) * distance);
+				frame.target = c;
+			}
+			else {
+				float z = c.z + (t * 2.0f - 1.0f) * r * 2.0f;
+				frame.position = XMFLOAT3(c.x + r * 0.25f, c.y, z);
+				frame.target = XMFLOAT3(c.x + r * 0.25f + sinf(angle) * r, c.y, z + r);
+			}
+		}
+	}
+
+	// Checks culling against every triangle on its own: nothing culled may be
+	// both front facing and not entirely off one side of the clip volume.
+	size_t CountWronglyCulled(const Meshlet* meshlets, size_t meshletCount, const unsigned int* indices, const Vertex* vertices,
+		const std::vector<unsigned int>& visible, const XMFLOAT4X4& viewProj, const XMFLOAT3& camera)
+	{
+		size_t wrong = 0;
+		size_t cursor = 0;
+		XMMATRIX matrix = XMLoadFloat4x4(&viewProj);
+
+		for (size_t m = 0; m < meshletCount; m++) {
+			// Visible meshlets were copied out whole and in order
+			const unsigned int* first = indices + meshlets[m].indexOffset;
+			size_t count = (size_t)meshlets[m].triangleCount * 3;
+			if (cursor + count <= visible.size() && memcmp(&visible[cursor], first, count * sizeof(unsigned int)) == 0) {
+				cursor += count;
+				continue;
+			}
+
+			for (uint32_t t = 0; t < meshlets[m].triangleCount; t++) {
+				XMVECTOR p[3];
+				XMFLOAT4 clip[3];
+				for (int corner = 0; corner < 3; corner++) {
+					p[corner] = XMLoadFloat3(&vertices[first[t * 3 + corner]].Position);
+					XMStoreFloat4(&clip[corner], XMVector4Transform(XMVectorSetW(p[corner], 1.0f), matrix));
+				}
+
+				XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0]));
+				bool frontFacing = XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(XMLoadFloat3(&camera), p[0]))) > 0.0f;
+
+				bool outside = false;
+				for (int plane = 0; plane < 6 && !outside; plane++) {
+					int out = 0;
+					for (int corner = 0; corner < 3; corner++) {
+						const XMFLOAT4& v = clip[corner];
+						float value = (plane == 0) ? v.w + v.x : (plane == 1) ? v.w - v.x : (plane == 2) ? v.w + v.y :
+							(plane == 3) ? v.w - v.y : (plane == 4) ? v.z : v.w - v.z;
+						out += (value < 0.0f);
+					}
+					outside = (out == 3);
+				}
+
+				if (frontFacing && !outside) wrong++;
+			}
+		}
+		return wrong;
+	}
+
+	int BenchMeshlets(int argc, char* argv[])
+	{
+		const char* pathNames[] = { "orbit", "close orbit", "flyby" };
+		const int frameCount = 64;
+		const int runs = 20;
+		printf("Up to %u vertices and %u triangles per meshlet, %d frames per path, best of %d runs\n",
+			MeshletBuilder::DefaultMaxVertices, MeshletBuilder::DefaultMaxTriangles, frameCount, runs);
+
+		for (int i = 0; i < argc; i++) {
+			MeshGeometry geometry;
+			if (!MeshBuilder::BuildFromObjFile(argv[i], geometry)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+			if (geometry.indices.empty())
+				continue;
+			MeshOptimizer::Optimize(geometry);
+
+			// Build them the way the game does
+			std::vector<Meshlet> meshlets;
+			double start = GetSeconds();
+			MeshletBuilder::Build(&geometry.indices[0], geometry.indices.size(), &geometry.vertices[0], geometry.vertices.size(), meshlets);
+			double buildSeconds = GetSeconds() - start;
+
+			size_t vertexTotal = 0, coneCount = 0;
+			XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX), boundsMax = XMVectorReplicate(-FLT_MAX);
+			for (const Meshlet& m : meshlets) {
+				vertexTotal += m.vertexCount;
+				coneCount += (m.coneCutoff < 1.0f);
+				boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&m.boundsMin));
+				boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&m.boundsMax));
+			}
+			printf("%s: %zu triangles in %zu meshlets (%.1f triangles, %.1f vertices each, %.0f%% with a usable cone) - %.3f ms\n",
+				argv[i],
+				geometry.indices.size() / 3,
+				meshlets.size(),
+				(double)geometry.indices.size() / 3 / meshlets.size(),
+				(double)vertexTotal / meshlets.size(),
+				100.0 * coneCount / meshlets.size(),
+				buildSeconds * 1000.0);
+
+			XMFLOAT3 center;
+			XMStoreFloat3(&center, XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f));
+			float radius = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(boundsMax, boundsMin)));
+
+			// The game's projection, with the clip planes scaled to the mesh
+			XMMATRIX proj = XMMatrixPerspectiveFovLH(3.14159265f / 4.0f, 1280.0f / 720.0f, radius * 0.01f, radius * 100.0f);
+
+			std::vector<unsigned int> visible;
+			visible.reserve(geometry.indices.size());
+			for (int path = 0; path < 3; path++) {
+				std::vector<CameraFrame> frames;
+				MakeCameraPath(path, center, radius, frameCount, frames);
+
+				std::vector<XMFLOAT4X4> viewProjs(frames.size());
+				for (size_t f = 0; f < frames.size(); f++) {
+					XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&frames[f].position), XMLoadFloat3(&frames[f].target), XMVectorSet(0, 1, 0, 0));
+					XMStoreFloat4x4(&viewProjs[f], XMMatrixMultiply(view, proj));
+				}
+
+				// Checked once, then timed
+				MeshletCullStats total;
+				size_t wrong = 0;
+				for (size_t f = 0; f < frames.size(); f++) {
+					MeshletCullStats stats;
+					visible.clear();
+					MeshletBuilder::Cull(meshlets.data(), meshlets.size(), geometry.indices.data(), viewProjs[f], frames[f].position, visible, &stats);
+					total.meshletCount += stats.meshletCount;
+					total.triangleCount += stats.triangleCount;
+					total.visibleTriangles += stats.visibleTriangles;
+					total.backfaceTriangles += stats.backfaceTriangles;
+					total.frustumTriangles += stats.frustumTriangles;
+					wrong += CountWronglyCulled(meshlets.data(), meshlets.size(), geometry.indices.data(), geometry.vertices.data(), visible, viewProjs[f], frames[f].position);
+				}
+
+				double best = TimeBest(runs, [&]() {
+					for (size_t f = 0; f < frames.size(); f++) {
+						visible.clear();
+						MeshletBuilder::Cull(meshlets.data(), meshlets.size(), geometry.indices.data(), viewProjs[f], frames[f].position, visible);
+					}
+				});
+
+				printf("  %-12s %7.2f us/frame %8.1f M meshlets/s - culled %5.1f%% of triangles (%4.1f%% facing away, %4.1f%% off screen)%s\n",
+					pathNames[path],
+					best / frameCount * 1e6,
+					best > 0.0 ? total.meshletCount / best / 1e6 : 0.0,
+					100.0 * total.GetCulledRatio(),
+					100.0 * total.backfaceTriangles / total.triangleCount,
+					100.0 * total.frustumTriangles / total.triangleCount,
+					wrong > 0 ? "  VISIBLE TRIANGLES CULLED" : "");
+				if (wrong > 0)
+					return 1;
+			}
+		}
+		return 0;
+	}
+
+	int Bounds(int argc, char* argv[])
+	{
+		const int transformCount = 256;
+		printf("%d random transforms each\n", transformCount);
+
+		// Random rotations, scales and translations (the same every run)
+		std::vector<XMFLOAT4X4> transforms(transformCount);
+		srand(1);
+		auto random = [](float low, float high) { return low + (high - low) * rand() / (float)RAND_MAX; };
+		for (XMFLOAT4X4& transform : transforms) {
+			XMMATRIX world = XMMatrixScaling(random(0.1f, 2.0f), random(0.1f, 2.0f), random(0.1f, 2.0f)) *
+				XMMatrixRotationRollPitchYaw(random(-3.2f, 3.2f), random(-3.2f, 3.2f), random(-3.2f, 3.2f)) *
+				XMMatrixTranslation(random(-10.0f, 10.0f), random(-10.0f, 10.0f), random(-10.0f, 10.0f));
+			XMStoreFloat4x4(&transform, world);
+		}
+
+		for (int i = 0; i < argc; i++) {
+			MeshGeometry geometry;
+			if (!MeshBuilder::BuildFromObjFile(argv[i], geometry)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+			if (geometry.vertices.empty())
+				continue;
+
+			LocalBounds local = MeshBounds::Calculate(geometry.vertices.data(), geometry.vertices.size());
+			std::vector<XMFLOAT3> hull;
+			double start = GetSeconds();
+			MeshBounds::BuildConvexHull(geometry.vertices.data(), geometry.vertices.size(), hull);
+			double hullSeconds = GetSeconds() - start;
+
+			std::vector<XMFLOAT3> positions(geometry.vertices.size());
+			for (size_t v = 0; v < positions.size(); v++)
+				positions[v] = geometry.vertices[v].Position;
+
+			// Meshes that only keep their positions build it from streams instead, which should be no different
+			VertexStream stream;
+			VertexTransform::BuildStreams(geometry.vertices.data(), geometry.vertices.size(), &stream);
+			std::vector<XMFLOAT3> streamHull;
+			MeshBounds::BuildConvexHull(stream.x.data(), stream.y.data(), stream.z.data(), stream.GetCount(), streamHull);
+			if (!SameContents(hull, streamHull)) {
+				printf("%s: the hull of the position streams doesn't match\n", argv[i]);
+				return 1;
+			}
+
+			// Every method against every transform
+			double vertexSeconds = 0.0, hullBoxSeconds = 0.0, localSeconds = 0.0;
+			double volumeRatio = 0.0;
+			size_t hullMismatches = 0, notContained = 0;
+			for (const XMFLOAT4X4& transform : transforms) {
+				XMFLOAT3 exactCenter, exactExtents, hullCenter, hullExtents, boxCenter, boxExtents;
+
+				start = GetSeconds();
+				MeshBounds::TransformPointsBox(positions.data(), positions.size(), transform, &exactCenter, &exactExtents);
+				vertexSeconds += GetSeconds() - start;
+
+				start = GetSeconds();
+				MeshBounds::TransformPointsBox(hull.data(), hull.size(), transform, &hullCenter, &hullExtents);
+				hullBoxSeconds += GetSeconds() - start;
+
+				start = GetSeconds();
+				MeshBounds::TransformBox(local.boxCenter, local.boxExtents, transform, &boxCenter, &boxExtents);
+				localSeconds += GetSeconds() - start;
+
+				// The hull has to give the same box, the local box has to hold it
+				const float* exactC = &exactCenter.x; const float* exactE = &exactExtents.x;
+				const float* hullC = &hullCenter.x; const float* hullE = &hullExtents.x;
+				const float* boxC = &boxCenter.x; const float* boxE = &boxExtents.x;
+				float tolerance = 1e-4f * (exactE[0] + exactE[1] + exactE[2] + 1.0f);
+				for (int axis = 0; axis < 3; axis++) {
+					if (fabsf(hullC[axis] - exactC[axis]) > tolerance || fabsf(hullE[axis] - exactE[axis]) > tolerance)
+						hullMismatches++;
+					if (boxC[axis] - boxE[axis] > exactC[axis] - exactE[axis] + tolerance || boxC[axis] + boxE[axis] < exactC[axis] + exactE[axis] - tolerance)
+						notContained++;
+				}
+				double exactVolume = (double)exactE[0] * exactE[1] * exactE[2];
+				volumeRatio += (exactVolume > 0.0) ? (double)boxE[0] * boxE[1] * boxE[2] / exactVolume : 1.0;
+			}
+
+			printf("%s: %zu vertices, %zu on the hull (built in %.3f ms)\n", argv[i], positions.size(), hull.size(), hullSeconds * 1000.0);
+			printf("  Every vertex  %9.3f us\n", vertexSeconds / transformCount * 1e6);
+			printf("  Hull vertices %9.3f us%s\n", hullBoxSeconds / transformCount * 1e6, hullMismatches > 0 ? "  MISMATCH" : "  (same box)");
+			printf("  Local box     %9.3f us  (%.2fx the volume on average)%s\n",
+				localSeconds / transformCount * 1e6,
+				volumeRatio / transformCount,
+				notContained > 0 ? "  DOESN'T CONTAIN THE MESH" : "");
+			if (hullMismatches > 0 || notContained > 0)
+				return 1;
+		}
+		return 0;
+	}
+
+	// What Mesh::GetVerticesWorldSpace does, to compare against.
+	void TransformEachVertex(const std::vector<Vertex>& vertices, const XMFLOAT4X4& worldMatrix, std::vector<Vertex>& out)
+	{
+		out.clear();
+		for (Vertex vert : vertices) {
+			Vertex newVert = vert;
+			XMStoreFloat3(&newVert.Position, XMVector3Transform(XMLoadFloat3(&newVert.Position), XMLoadFloat4x4(&worldMatrix)));
+			out.push_back(newVert);
+		}
+	}
+
+	int BenchTransform(int argc, char* argv[])
+	{
+		const int runs = 20;
+		printf("%u hardware threads, best of %d runs\n", GetHardwareThreadCount(), runs);
+
+		XMFLOAT4X4 world, normalMatrix;
+		XMMATRIX worldMatrix = XMMatrixScaling(1.5f, 0.5f, 2.0f) * XMMatrixRotationRollPitchYaw(0.3f, 1.2f, -0.7f) * XMMatrixTranslation(4.0f, -2.0f, 9.0f);
+		XMStoreFloat4x4(&world, worldMatrix);
+		XMStoreFloat4x4(&normalMatrix, XMMatrixTranspose(XMMatrixInverse(nullptr, worldMatrix)));
+
+		for (int i = 0; i < argc; i++) {
+			MeshGeometry geometry;
+			if (!MeshBuilder::BuildFromObjFile(argv[i], geometry)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+			size_t count = geometry.vertices.size();
+			if (count == 0)
+				continue;
+
+			VertexStream positions, normals;
+			VertexTransform::BuildStreams(geometry.vertices.data(), count, &positions, &normals);
+			std::vector<Vertex> eachVertex;
+			std::vector<float> outX(count), outY(count), outZ(count);
+			VertexStreamTarget out = { outX.data(), outY.data(), outZ.data() };
+
+			double eachSeconds = TimeBest(runs, [&]() { TransformEachVertex(geometry.vertices, world, eachVertex); });
+			double singleSeconds = TimeBest(runs, [&]() { VertexTransform::TransformPositions(positions, world, out, 1); });
+			double normalSeconds = TimeBest(runs, [&]() { VertexTransform::TransformNormals(normals, normalMatrix, out, 1); });
+			double parallelSeconds = TimeBest(runs, [&]() { VertexTransform::TransformPositions(positions, world, out); });
+
+			// The streams should give the same positions, give or take rounding
+			float maxError = 0.0f;
+			for (size_t v = 0; v < count; v++) {
+				const XMFLOAT3& expected = eachVertex[v].Position;
+				float scale = 1.0f + fmaxf(fabsf(expected.x), fmaxf(fabsf(expected.y), fabsf(expected.z)));
+				maxError = fmaxf(maxError, fabsf(outX[v] - expected.x) / scale);
+				maxError = fmaxf(maxError, fabsf(outY[v] - expected.y) / scale);
+				maxError = fmaxf(maxError, fabsf(outZ[v] - expected.z) / scale);
+			}
+
+			auto rate = [&](double seconds) { return seconds > 0.0 ? count / seconds / 1e6 : 0.0; };
+			printf("%s: %zu vertices\n", argv[i], count);
+			printf("  Each vertex          %9.3f ms (%7.1f M vertices/s)\n", eachSeconds * 1000.0, rate(eachSeconds));
+			printf("  Streams, 1 thread    %9.3f ms (%7.1f M vertices/s, %.1fx)\n", singleSeconds * 1000.0, rate(singleSeconds), singleSeconds > 0.0 ? eachSeconds / singleSeconds : 0.0);
+			printf("  Streams, %2u threads  %9.3f ms (%7.1f M vertices/s, %.1fx)\n", GetHardwareThreadCount(), parallelSeconds * 1000.0, rate(parallelSeconds), parallelSeconds > 0.0 ? eachSeconds / parallelSeconds : 0.0);
+			printf("  Normals, 1 thread    %9.3f ms (%7.1f M vertices/s)\n", normalSeconds * 1000.0, rate(normalSeconds));
+			printf("  Max relative difference %g%s\n", maxError, maxError > 1e-5f ? "  MISMATCH" : "");
+			if (maxError > 1e-5f)
+				return 1;
+		}
+		return 0;
+	}
+
+	// Whether the live ranges of an allocator overlap each other, run off its end, or don't add up to what it says is used.
+	bool CheckAllocations(const GeometryAllocator& allocator, std::vector<std::pair<uint32_t, uint32_t>> ranges)
+	{
+		std::sort(ranges.begin(), ranges.end());
+		uint64_t used = 0;
+		for (size_t i = 0; i < ranges.size(); i++) {
+			if ((uint64_t)ranges[i].first + ranges[i].second > allocator.GetCapacity())
+				return false;
+			if (i > 0 && ranges[i - 1].first + ranges[i - 1].second > ranges[i].first)
+				return false;
+			used += ranges[i].second;
+		}
+		GeometryAllocatorStats stats = allocator.GetStats();
+		return used == stats.used && ranges.size() == stats.allocationCount;
+	}
+
+	int BenchPool(int argc, char* argv[])
+	{
+		// The same capacities as GeometryPool's
+		const uint32_t vertexCapacity = 1 << 18;
+		const uint32_t indexCapacity = 1 << 20;
+		const int churnRounds = 20000;
+
+		// The sizes of the meshes to put in it
+		std::vector<std::pair<uint32_t, uint32_t>> meshSizes;
+		for (int i = 0; i < argc; i++) {
+			MeshGeometry geometry;
+			if (!MeshBuilder::BuildFromObjFile(argv[i], geometry)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+			if (!geometry.indices.empty() && geometry.vertices.size() <= vertexCapacity && geometry.indices.size() <= indexCapacity)
+				meshSizes.push_back(std::make_pair((uint32_t)geometry.vertices.size(), (uint32_t)geometry.indices.size()));
+		}
+		if (meshSizes.empty()) {
+			printf("No models small enough for a pool of %u vertices and %u indices\n", vertexCapacity, indexCapacity);
+			return 1;
+		}
+
+		GeometryAllocator vertices(vertexCapacity), indices(indexCapacity);
+		struct Live { uint32_t baseVertex, vertexCount, firstIndex, indexCount; };
+		std::vector<Live> live;
+		srand(1);
+
+		// Add a random one of the meshes, like GeometryPool::TryAdd does
+		auto add = [&]() {
+			const std::pair<uint32_t, uint32_t>& size = meshSizes[rand() % meshSizes.size()];
+			uint32_t baseVertex = vertices.Allocate(size.first);
+			if (baseVertex == GeometryAllocator::InvalidOffset)
+				return false;
+			uint32_t firstIndex = indices.Allocate(size.second);
+			if (firstIndex == GeometryAllocator::InvalidOffset) {
+				vertices.Free(baseVertex);
+				return false;
+			}
+			live.push_back(Live{ baseVertex, size.first, firstIndex, size.second });
+			return true;
+		};
+		auto remove = [&](size_t which) {
+			vertices.Free(live[which].baseVertex);
+			indices.Free(live[which].firstIndex);
+			live[which] = live.back();
+			live.pop_back();
+		};
+		auto check = [&]() {
+			std::vector<std::pair<uint32_t, uint32_t>> vertexRanges, indexRanges;
+			for (const Live& mesh : live) {
+				vertexRanges.push_back(std::make_pair(mesh.baseVertex, mesh.vertexCount));
+				indexRanges.push_back(std::make_pair(mesh.firstIndex, mesh.indexCount));
+			}
+			return CheckAllocations(vertices, vertexRanges) && CheckAllocations(indices, indexRanges);
+		};
+		auto print = [&](const char* when) {
+			GeometryAllocatorStats vertexStats = vertices.GetStats(), indexStats = indices.GetStats();
+			printf("  %-22s %5zu meshes - vertices %5.1f%% full, %4u free blocks, %4.1f%% fragmented - indices %5.1f%% full, %4u free blocks, %4.1f%% fragmented\n",
+				when,
+				live.size(),
+				100.0 * vertexStats.GetOccupancy(), vertexStats.freeBlockCount, 100.0 * vertexStats.GetFragmentation(),
+				100.0 * indexStats.GetOccupancy(), indexStats.freeBlockCount, 100.0 * indexStats.GetFragmentation());
+		};
+
+		printf("Pool of %u vertices and %u indices, %zu mesh sizes\n", vertexCapacity, indexCapacity, meshSizes.size());
+
+		// Fill it up
+		double start = GetSeconds();
+		size_t operations = 0;
+		while (add())
+			operations++;
+		print("Filled");
+
+		// Then swap meshes in and out: free one, add until one doesn't fit
+		size_t failures = 0;
+		for (int round = 0; round < churnRounds && !live.empty(); round++) {
+			remove(rand() % live.size());
+			operations++;
+			for (int tries = 0; tries < 4; tries++) {
+				operations++;
+				if (!add()) {
+					failures++;
+					break;
+				}
+			}
+		}
+		double seconds = GetSeconds() - start;
+		print("After churn");
+
+		bool valid = check();
+
+		// Then empty it again, which should merge everything back into one block
+		while (!live.empty())
+			remove(live.size() - 1);
+		print("Emptied");
+		GeometryAllocatorStats vertexStats = vertices.GetStats(), indexStats = indices.GetStats();
+		valid = valid && vertexStats.freeBlockCount == 1 && vertexStats.largestFreeBlock == vertexCapacity &&
+			indexStats.freeBlockCount == 1 && indexStats.largestFreeBlock == indexCapacity;
+
+		printf("  %zu operations in %.3f ms (%.3f us each), %zu adds didn't fit%s\n",
+			operations,
+			seconds * 1000.0,
+			operations > 0 ? seconds / operations * 1e6 : 0.0,
+			failures,
+			valid ? "" : "  ALLOCATIONS OVERLAP OR LEAKED");
+		return valid ? 0 : 1;
+	}
+
+	int Positions(int argc, char* argv[])
+	{
+		bool valid = true;
+		for (int i = 0; i < argc; i++) {
+			MeshGeometry geometry;
+			if (!MeshBuilder::BuildFromObjFile(argv[i], geometry)) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+			if (geometry.indices.empty())
+				continue;
+
+			// Reordered first, as the game does (the stream follows the index order)
+			MeshOptimizer::Optimize(geometry);
+
+			double start = GetSeconds();
+			MeshBuilder::BuildPositionStream(geometry);
+			double seconds = GetSeconds() - start;
+
+			bool matches = MeshBuilder::ValidatePositionStream(geometry);
+			valid = valid && matches;
+
+			// What a depth pass reads: one fetch per vertex shader run (cache miss)
+			VertexCacheStats full = MeshOptimizer::AnalyzeVertexCache(geometry.indices.data(), geometry.indices.size(), geometry.vertices.size());
+			VertexCacheStats positions = MeshOptimizer::AnalyzeVertexCache(geometry.positionIndices.data(), geometry.positionIndices.size(), geometry.positions.size());
+			size_t fullBytes = full.transformCount * sizeof(Vertex);
+			size_t positionBytes = positions.transformCount * sizeof(XMFLOAT3);
+
+			printf("%s: %zu vertices share %zu positions (built in %.3f ms)%s\n",
+				argv[i],
+				geometry.vertices.size(),
+				geometry.positions.size(),
+				seconds * 1000.0,
+				matches ? "" : "  POSITIONS DON'T MATCH THE VERTICES");
+			printf("  %-10s %8zu bytes, %8zu vertex shader runs (ATVR %.3f), %9zu bytes fetched\n",
+				"Full", geometry.vertices.size() * sizeof(Vertex), full.transformCount, full.GetATVR(), fullBytes);
+			printf("  %-10s %8zu bytes, %8zu vertex shader runs (ATVR %.3f), %9zu bytes fetched (%.0f%%)\n",
+				"Positions", geometry.positions.size() * sizeof(XMFLOAT3), positions.transformCount, positions.GetATVR(), positionBytes,
+				fullBytes > 0 ? 100.0 * positionBytes / fullBytes : 0.0);
+		}
+		return valid ? 0 : 1;
+	}
+
+	int BenchImport(int argc, char* argv[])
+	{
+		const int runs = 5;
+		printf("Best of %d runs, %u hardware threads\n", runs, GetHardwareThreadCount());
+
+		bool valid = true;
+		for (int i = 0; i < argc; i++) {
+			// The parse and weld the game did before materials (one range for everything)
+			MeshGeometry plain;
+			bool opened = true;
+			double plainSeconds = TimeBest(runs, [&]() {
+				ObjData obj;
+				opened = ObjParser::ParseFile(argv[i], obj);
+				obj.materialUses.clear();
+				MeshBuilder::BuildFromObj(obj, plain);
+			});
+			if (!opened) {
+				printf("%s: couldn't open the file\n", argv[i]);
+				return 1;
+			}
+
+			// The same, plus the material libraries and grouping into submeshes
+			MeshGeometry imported;
+			std::vector<ObjMaterial> materials;
+			double importSeconds = TimeBest(runs, [&]() {
+				ObjData obj;
+				ObjParser::ParseFile(argv[i], obj);
+				materials.clear();
+				ObjParser::ParseMaterialLibraries(argv[i], obj.materialLibraries, materials);
+				MeshBuilder::BuildFromObj(obj, imported);
+			});
+
+			// tiny_obj_loader, just reading the file and its materials
+			tinyobj::attrib_t attrib;
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> tinyMaterials;
+			std::string folder = argv[i];
+			size_t slash = folder.find_last_of("/\\");
+			folder.resize(slash == std::string::npos ? 0 : slash + 1);
+			std::string warning, error;
+			double tinySeconds = TimeBest(runs,
+				[&](int) { warning.clear(); error.clear(); },
+				[&]() { tinyobj::LoadObj(&attrib, &shapes, &tinyMaterials, &warning, &error, argv[i], folder.c_str()); });
+
+			// Every material should end up with as many triangles as tiny_obj_loader gives it
+			std::map<std::string, size_t> expected, found;
+			for (const tinyobj::shape_t& shape : shapes) {
+				for (size_t face = 0; face < shape.mesh.material_ids.size(); face++) {
+					int id = shape.mesh.material_ids[face];
+					expected[(id >= 0 && id < (int)tinyMaterials.size()) ? tinyMaterials[id].name : std::string()]++;
+				}
+			}
+			for (const MeshSubmesh& submesh : imported.submeshes)
+				found[submesh.material] += submesh.indexCount / 3;
+			if (imported.submeshes.empty() && !imported.indices.empty())
+				found[std::string()] = imported.indices.size() / 3;
+			bool matches = (expected == found) && imported.indices.size() == plain.indices.size();
+			valid = valid && matches;
+
+			printf("%s: %zu triangles, %zu submeshes, %zu materials in its libraries%s\n",
+				argv[i],
+				imported.indices.size() / 3,
+				imported.submeshes.size(),
+				materials.size(),
+				matches ? "" : "  SUBMESHES DON'T MATCH TINY_OBJ_LOADER");
+			printf("  %-28s %8.2f ms\n", "Without materials", plainSeconds * 1000.0);
+			printf("  %-28s %8.2f ms (%+.1f%%)\n", "With materials (submeshes)", importSeconds * 1000.0,
+				plainSeconds > 0.0 ? 100.0 * (importSeconds - plainSeconds) / plainSeconds : 0.0);
+			printf("  %-28s %8.2f ms (%.1fx as long, no welding)\n", "tiny_obj_loader", tinySeconds * 1000.0,
+				importSeconds > 0.0 ? tinySeconds / importSeconds : 0.0);
+			for (const MeshSubmesh& submesh : imported.submeshes)
+				printf("    %-24s %7u triangles\n", submesh.material[0] != '\0' ? submesh.material : "(none)", submesh.indexCount / 3);
+		}
+		return valid ? 0 : 1;
+	}
+
+	int BenchLoad(int argc, char* argv[])
+	{
+		const int runs = 3;
+		printf("Best of %d runs, %u hardware threads\n", runs, GetHardwareThreadCount());
+
+		bool valid = true;
+		for (int i = 0; i < argc; i++) {
+			CompressedStream probe(argv[i]);
+			if (!probe.IsOpen()) {
+				printf("%s: couldn't open the file (compression: %s)\n", argv[i], GetCompressionName(probe.GetCompression()));
+				valid = false;
+				continue;
+			}
+
+			// Cooked files are inflated whole (they're used in place)
+			{
+				MeshCacheFile cache(argv[i]);
+				if (cache.IsValid()) {
+					MeshCacheReadStats best;
+					for (int run = 0; run < runs; run++) {
+						MeshCacheFile timed(argv[i]);
+						const MeshCacheReadStats& stats = timed.GetReadStats();
+						if (run == 0 || stats.stream.readSeconds + stats.stream.decompressSeconds < best.stream.readSeconds + best.stream.decompressSeconds)
+							best = stats;
+					}
+					printf("%s: cooked, compression %s\n", argv[i], GetCompressionName(best.compression));
+					if (best.compression == StreamCompression_None) {
+						printf("  %.2f MB, mapped (paged in as it's used)\n", best.stream.fileBytes / (1024.0 * 1024.0));
+						continue;
+					}
+					printf("  %.2f MB read in %.2f ms, %.2f MB inflated in %.2f ms (%.2fx)\n",
+						best.stream.fileBytes / (1024.0 * 1024.0),
+						best.stream.readSeconds * 1000.0,
+						best.stream.bytes / (1024.0 * 1024.0),
+						best.stream.decompressSeconds * 1000.0,
+						best.stream.GetRatio());
+					continue;
+				}
+			}
+
+			// Models: the usual way (mapped, or streamed if compressed), then always streamed
+			ObjData data, streamed;
+			ObjParseStats best, bestStreamed;
+			bool parsed = true;
+			for (int run = 0; run < runs && parsed; run++) {
+				ObjParseStats stats;
+				parsed = ObjParser::ParseFile(argv[i], data, &stats);
+				if (run == 0 || stats.readSeconds + stats.decompressSeconds + stats.seconds < best.readSeconds + best.decompressSeconds + best.seconds)
+					best = stats;
+
+				CompressedStream stream(argv[i]);
+				parsed = ObjParser::ParseStream(stream, streamed, &stats) && parsed;
+				if (run == 0 || stats.readSeconds + stats.decompressSeconds + stats.seconds < bestStreamed.readSeconds + bestStreamed.decompressSeconds + bestStreamed.seconds)
+					bestStreamed = stats;
+			}
+
+			if (!parsed) {
+				printf("%s: corrupt or truncated\n", argv[i]);
+				valid = false;
+				continue;
+			}
+
+			// A compressed model is checked against the plain one next to it, if there is one
+			ObjData reference;
+			std::string plainPath = argv[i];
+			if (best.compression != StreamCompression_None && plainPath.size() > 3 && plainPath.compare(plainPath.size() - 3, 3, ".gz") == 0) {
+				plainPath.resize(plainPath.size() - 3);
+				if (!ObjParser::ParseFile(plainPath.c_str(), reference))
+					plainPath.clear();
+			}
+			else {
+				plainPath.clear();
+			}
+
+			bool identical = SameContents(data.positions, streamed.positions) &&
+				SameContents(data.normals, streamed.normals) &&
+				SameContents(data.uvs, streamed.uvs) &&
+				SameContents(data.indices, streamed.indices) &&
+				SameMaterialUses(data.materialUses, streamed.materialUses);
+			if (!plainPath.empty()) {
+				identical = identical &&
+					SameContents(data.positions, reference.positions) &&
+					SameContents(data.normals, reference.normals) &&
+					SameContents(data.uvs, reference.uvs) &&
+					SameContents(data.indices, reference.indices) &&
+					SameMaterialUses(data.materialUses, reference.materialUses);
+			}
+			valid = valid && identical;
+
+			printf("%s: compression %s, %.2f MB read, %.2f MB of text (%.2fx), %zu triangles%s\n",
+				argv[i],
+				GetCompressionName(best.compression),
+				best.fileBytes / (1024.0 * 1024.0),
+				best.bytes / (1024.0 * 1024.0),
+				best.fileBytes > 0 ? (double)best.bytes / best.fileBytes : 0.0,
+				data.indices.size() / 3,
+				identical ? "" : "  MISMATCH");
+			if (!plainPath.empty())
+				printf("  Matches %s\n", plainPath.c_str());
+			printf("  %-10s %10s %10s %10s %10s\n", "", "read", "inflate", "parse", "total");
+			printf("  %-10s %7.2f ms %7.2f ms %7.2f ms %7.2f ms\n", best.compression == StreamCompression_None ? "Mapped" : "Streamed",
+				best.readSeconds * 1000.0, best.decompressSeconds * 1000.0, best.seconds * 1000.0,
+				(best.readSeconds + best.decompressSeconds + best.seconds) * 1000.0);
+			if (best.compression == StreamCompression_None) {
+				printf("  %-10s %7.2f ms %7.2f ms %7.2f ms %7.2f ms\n", "Streamed",
+					bestStreamed.readSeconds * 1000.0, bestStreamed.decompressSeconds * 1000.0, bestStreamed.seconds * 1000.0,
+					(bestStreamed.readSeconds + bestStreamed.decompressSeconds + bestStreamed.seconds) * 1000.0);
+			}
+		}
+		return valid ? 0 : 1;
+	}
+	// What's wrong with a primitive's geometry, if anything.
+	struct PrimitiveCheck
+	{
+		bool boxMatches = true;			// GetBounds' box is the vertices' box, exactly
+		bool sphereContains = true;		// and its sphere holds every vertex
+		size_t badIndices = 0;
+		size_t unusedVertices = 0;
+		size_t degenerate = 0;			// Triangles with no area
+		size_t wrongWinding = 0;		// Facing away from their vertices' normals
+		size_t badNormals = 0;			// Not unit length
+		size_t badTangents = 0;			// Not unit length, or not at right angles to the normal
+		float sphereScale = 0.0f;		// GetBounds' sphere radius over the one MeshBounds::Calculate finds
+
+		bool IsValid() const
+		{
+			return boxMatches && sphereContains && badIndices == 0 && unusedVertices == 0 && degenerate == 0 &&
+				wrongWinding == 0 && badNormals == 0 && badTangents == 0;
+		}
+	};
+
+	PrimitiveCheck CheckPrimitive(const MeshGeometry& geometry, const LocalBounds& bounds)
+	{
+		PrimitiveCheck check;
+		LocalBounds found = MeshBounds::Calculate(geometry.vertices.data(), geometry.vertices.size());
+		check.boxMatches =
+			bounds.boxCenter.x == found.boxCenter.x && bounds.boxCenter.y == found.boxCenter.y && bounds.boxCenter.z == found.boxCenter.z &&
+			bounds.boxExtents.x == found.boxExtents.x && bounds.boxExtents.y == found.boxExtents.y && bounds.boxExtents.z == found.boxExtents.z;
+		check.sphereScale = found.sphereRadius > 0.0f ? bounds.sphereRadius / found.sphereRadius : 0.0f;
+
+		XMVECTOR sphereCenter = XMLoadFloat3(&bounds.sphereCenter);
+		for (const Vertex& vertex : geometry.vertices) {
+			XMVECTOR position = XMLoadFloat3(&vertex.Position);
+			XMVECTOR normal = XMLoadFloat3(&vertex.Normal);
+			XMVECTOR tangent = XMLoadFloat3(&vertex.Tangent);
+			if (XMVectorGetX(XMVector3Length(XMVectorSubtract(position, sphereCenter))) > bounds.sphereRadius * (1.0f + 1e-6f))
+				check.sphereContains = false;
+			if (fabsf(XMVectorGetX(XMVector3Length(normal)) - 1.0f) > 1e-4f)
+				check.badNormals++;
+			if (fabsf(XMVectorGetX(XMVector3Length(tangent)) - 1.0f) > 1e-3f || fabsf(XMVectorGetX(XMVector3Dot(tangent, normal))) > 1e-3f)
+				check.badTangents++;
+		}
+
+		std::vector<bool> used(geometry.vertices.size(), false);
+		for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3) {
+			const unsigned int* triangle = &geometry.indices[i];
+			if (triangle[0] >= geometry.vertices.size() || triangle[1] >= geometry.vertices.size() || triangle[2] >= geometry.vertices.size()) {
+				check.badIndices++;
+				continue;
+			}
+
+			const Vertex& a = geometry.vertices[triangle[0]];
+			const Vertex& b = geometry.vertices[triangle[1]];
+			const Vertex& c = geometry.vertices[triangle[2]];
+			used[triangle[0]] = used[triangle[1]] = used[triangle[2]] = true;
+
+			// Clockwise from the front, so the cross product points out (left handed)
+			XMVECTOR pa = XMLoadFloat3(&a.Position);
+			XMVECTOR face = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b.Position), pa), XMVectorSubtract(XMLoadFloat3(&c.Position), pa));
+			XMVECTOR normal = XMVectorAdd(XMVectorAdd(XMLoadFloat3(&a.Normal), XMLoadFloat3(&b.Normal)), XMLoadFloat3(&c.Normal));
+			if (XMVector3Equal(face, XMVectorZero()))
+				check.degenerate++;
+			else if (XMVectorGetX(XMVector3Dot(face, normal)) <= 0.0f)
+				check.wrongWinding++;
+		}
+		for (bool isUsed : used)
+			check.unusedVertices += isUsed ? 0 : 1;
+		return check;
+	}
+
+	int Primitives(int argc, char* argv[])
+	{
+		const int runs = 100;
+		printf("Best of %d builds\n", runs);
+
+		// Every shape at its defaults, then odd and finer tessellations
+		const PrimitiveSettings shapes[] = {
+			MeshPrimitives::Cube(),
+			MeshPrimitives::Cube(2.0f, 8),
+			MeshPrimitives::Plane(),
+			MeshPrimitives::Plane(10.0f, 16),
+			MeshPrimitives::Sphere(),
+			MeshPrimitives::Sphere(0.5f, 7, 5),
+			MeshPrimitives::Sphere(1.0f, 128, 64),
+			MeshPrimitives::Cylinder(),
+			MeshPrimitives::Cylinder(0.25f, 3.0f, 7, 4),
+			MeshPrimitives::Cone(),
+			MeshPrimitives::Cone(1.0f, 0.5f, 7, 3),
+			MeshPrimitives::Torus(),
+			MeshPrimitives::Torus(1.0f, 0.25f, 9, 5),
+			MeshPrimitives::Torus(1.0f, 0.25f, 128, 64),
+		};
+
+		bool valid = true;
+		printf("  %-16s %9s %9s %10s %11s  %s\n", "", "vertices", "triangles", "build", "sphere", "");
+		for (const PrimitiveSettings& settings : shapes) {
+			MeshGeometry geometry;
+			double buildSeconds = TimeBest(runs, [&]() { MeshPrimitives::Build(settings, geometry); });
+
+			PrimitiveCheck check = CheckPrimitive(geometry, MeshPrimitives::GetBounds(settings));
+			valid = valid && check.IsValid();
+
+			printf("  %-16s %9zu %9zu %7.1f us %9.3fx  %s",
+				MeshPrimitives::GetName(settings).c_str(),
+				geometry.vertices.size(),
+				geometry.indices.size() / 3,
+				buildSeconds * 1000000.0,
+				check.sphereScale,
+				check.IsValid() ? "OK" : "");
+			if (!check.boxMatches) printf(" BOX DOESN'T MATCH");
+			if (!check.sphereContains) printf(" SPHERE DOESN'T CONTAIN IT");
+			if (check.badIndices > 0) printf(" %zu BAD INDICES", check.badIndices);
+			if (check.unusedVertices > 0) printf(" %zu UNUSED VERTICES", check.unusedVertices);
+			if (check.degenerate > 0) printf(" %zu DEGENERATE", check.degenerate);
+			if (check.wrongWinding > 0) printf(" %zu WRONG WINDING", check.wrongWinding);
+			if (check.badNormals > 0) printf(" %zu BAD NORMALS", check.badNormals);
+			if (check.badTangents > 0) printf(" %zu BAD TANGENTS", check.badTangents);
+			printf("\n");
+		}
+
+		if (argc < 1)
+			return valid ? 0 : 1;
+
+		// The models they replace, parsed and welded the way a mesh without a cooked file is
+		const struct { const char* file; PrimitiveSettings settings; } models[] = {
+			{ "cube.obj", MeshPrimitives::Cube() },
+			{ "sphere.obj", MeshPrimitives::Sphere() },
+			{ "cylinder.obj", MeshPrimitives::Cylinder() },
+			{ "cone.obj", MeshPrimitives::Cone() },
+			{ "torus.obj", MeshPrimitives::Torus() },
+		};
+
+		std::string folder = argv[0];
+		if (!folder.empty() && folder.back() != '/' && folder.back() != '\\')
+			folder += '/';
+
+		printf("\n  %-14s %10s %10s %9s   %s\n", "", "model", "primitive", "", "bounds (model vs primitive)");
+		for (const auto& model : models) {
+			std::string path = folder + model.file;
+			MeshGeometry loaded, built;
+			bool opened = true;
+			double loadSeconds = TimeBest(5, [&]() { opened = MeshBuilder::BuildFromObjFile(path.c_str(), loaded); });
+			double buildSeconds = TimeBest(5, [&]() { MeshPrimitives::Build(model.settings, built); });
+			if (!opened) {
+				printf("  %-14s couldn't open %s\n", model.file, path.c_str());
+				continue;
+			}
+
+			LocalBounds loadedBounds = MeshBounds::Calculate(loaded.vertices.data(), loaded.vertices.size());
+			LocalBounds builtBounds = MeshPrimitives::GetBounds(model.settings);
+			printf("  %-14s %7.1f us %7.1f us %8.0fx   extents (%.3f, %.3f, %.3f) vs (%.3f, %.3f, %.3f), %zu vs %zu triangles\n",
+				model.file,
+				loadSeconds * 1000000.0,
+				buildSeconds * 1000000.0,
+				buildSeconds > 0.0 ? loadSeconds / buildSeconds : 0.0,
+				loadedBounds.boxExtents.x, loadedBounds.boxExtents.y, loadedBounds.boxExtents.z,
+				builtBounds.boxExtents.x, builtBounds.boxExtents.y, builtBounds.boxExtents.z,
+				loaded.indices.size() / 3,
+				built.indices.size() / 3);
+		}
+		return valid ? 0 : 1;
+	}
+
+	// A small turn and step, different for every node (so a long chain stays in range)
+	AffineMatrix GetTestLocalMatrix(uint32_t seed)
+	{
+		uint32_t hash = seed * 2654435761u;
+		float angle = (float)(hash % 1000) * 0.00002f;
+		float step = (float)((hash >> 10) % 1000) * 0.00001f;
+		return AffineMatrix::Store(XMMatrixMultiply(
+			XMMatrixRotationRollPitchYaw(angle, angle * 2.0f, angle * 0.5f),
+			XMMatrixTranslation(step, 0.01f, -step)));
+	}
+
+	// Counts the nodes whose world matrix isn't exactly what multiplying their way down from
+	// the root gives (the same multiplications in the same order, so no tolerance)
+	size_t CheckHierarchy(const TransformHierarchy& hierarchy, const std::vector<uint32_t>& nodes)
+	{
+		uint32_t handleCount = 0;
+		for (uint32_t node : nodes)
+			handleCount = std::max(handleCount, node + 1);
+
+		std::vector<AffineMatrix> worlds(handleCount);
+		std::vector<bool> known(handleCount, false);
+		std::vector<uint32_t> path;
+		size_t wrong = 0;
+		for (uint32_t node : nodes) {
+			path.clear();
+			uint32_t above = node;
+			while (above != TransformHierarchy::NoNode && !known[above]) {
+				path.push_back(above);
+				above = hierarchy.GetParent(above);
+			}
+			for (size_t i = path.size(); i-- > 0; above = path[i]) {
+				const AffineMatrix& local = hierarchy.GetLocalMatrix(path[i]);
+				worlds[path[i]] = (above == TransformHierarchy::NoNode) ? local : AffineMatrix::Multiply(local, worlds[above]);
+				known[path[i]] = true;
+			}
+
+			if (memcmp(&worlds[node], &hierarchy.GetWorldMatrix(node), sizeof(AffineMatrix)) != 0)
+				wrong++;
+		}
+		return wrong;
+	}
+
+	int BenchHierarchy(int argc, char* argv[])
+	{
+		uint32_t nodeCount = argc >= 1 ? (uint32_t)strtoul(argv[0], nullptr, 10) : 100000;
+		if (nodeCount < 2) {
+			printf("Need at least 2 nodes\n");
+			return 1;
+		}
+
+		const int runs = 10;
+		printf("%u nodes, best of %d updates\n", nodeCount, runs);
+		printf("  %-8s %6s %10s %21s %21s %21s %21s %10s  %s\n", "", "depth", "build", "everything", "one leaf", "root", "1% random", "nothing", "");
+
+		bool valid = true;
+		const char* shapes[] = { "deep", "wide", "random" };
+		for (int shape = 0; shape < 3; shape++) {
+			// Made the way a scene would be: parents first, each child right after setting its local matrix
+			// - Random parents are any node made before, so depths go up and down and the first update sorts.
+			TransformHierarchy hierarchy;
+			std::vector<uint32_t> nodes(nodeCount);
+			double start = GetSeconds();
+			for (uint32_t i = 0; i < nodeCount; i++) {
+				uint32_t parent = TransformHierarchy::NoNode;
+				if (i > 0) {
+					if (shape == 0) parent = nodes[i - 1];
+					else if (shape == 1) parent = nodes[0];
+					else parent = nodes[(i * 2654435761u >> 8) % i];
+				}
+				nodes[i] = hierarchy.Create(parent);
+				hierarchy.SetLocalMatrix(nodes[i], GetTestLocalMatrix(i));
+			}
+			double buildSeconds = GetSeconds() - start;
+
+			start = GetSeconds();
+			uint32_t everything = hierarchy.Update();
+			double everythingSeconds = GetSeconds() - start;
+
+			// Dirtying some nodes (with the matrices they already have, so every run does the same work)
+			auto timeUpdate = [&](const std::vector<uint32_t>& dirty, uint32_t& recomputed) {
+				return TimeBest(runs,
+					[&](int) {
+						for (uint32_t node : dirty)
+							hierarchy.SetLocalMatrix(node, hierarchy.GetLocalMatrix(node));
+					},
+					[&]() { recomputed = hierarchy.Update(); });
+			};
+
+			std::vector<uint32_t> randomNodes;
+			for (uint32_t i = 0; i < nodeCount / 100; i++)
+				randomNodes.push_back(nodes[1 + (i * 2246822519u >> 4) % (nodeCount - 1)]);	// Not the root, that would be everything
+
+			uint32_t leaf = 0, root = 0, random = 0, nothing = 0;
+			double leafSeconds = timeUpdate({ nodes[nodeCount - 1] }, leaf);
+			double rootSeconds = timeUpdate({ nodes[0] }, root);
+			double randomSeconds = timeUpdate(randomNodes, random);
+			double nothingSeconds = timeUpdate({}, nothing);
+
+			uint32_t depth = 0;
+			for (uint32_t node : nodes)
+				depth = std::max(depth, hierarchy.GetDepth(node));
+
+			size_t wrong = CheckHierarchy(hierarchy, nodes);
+			valid = valid && wrong == 0;
+			printf("  %-8s %6u %7.2f ms %7.2f ms (%8u) %7.2f ms (%8u) %7.2f ms (%8u) %7.2f ms (%8u) %7.3f ms  %s",
+				shapes[shape], depth, buildSeconds * 1000.0,
+				everythingSeconds * 1000.0, everything,
+				leafSeconds * 1000.0, leaf,
+				rootSeconds * 1000.0, root,
+				randomSeconds * 1000.0, random,
+				nothingSeconds * 1000.0,
+				wrong == 0 ? "OK" : "");
+			if (wrong > 0) printf(" %zu WRONG", wrong);
+			printf("\n");
+		}
+
+		// Changing the structure: moving subtrees, refusing cycles, removing nodes and reusing their handles
+		TransformHierarchy hierarchy;
+		std::vector<uint32_t> nodes(nodeCount);
+		for (uint32_t i = 0; i < nodeCount; i++) {
+			nodes[i] = hierarchy.Create(i > 0 ? nodes[(i * 2654435761u >> 8) % i] : TransformHierarchy::NoNode);
+			hierarchy.SetLocalMatrix(nodes[i], GetTestLocalMatrix(i));
+		}
+		hierarchy.Update();
+
+		bool cycleRefused = !hierarchy.SetParent(nodes[0], nodes[nodeCount - 1]);
+		for (uint32_t i = 1; i < nodeCount; i += 97)
+			hierarchy.SetParent(nodes[i], nodes[(i * 40503u) % nodeCount]);	// Refused (and skipped) when it would be a cycle
+		for (uint32_t i = 3; i < nodeCount; i += 101) {
+			hierarchy.Destroy(nodes[i]);
+			nodes[i] = TransformHierarchy::NoNode;
+		}
+		for (uint32_t i = 5; i < nodeCount; i += 101) {
+			if (nodes[i] != TransformHierarchy::NoNode) {
+				uint32_t child = hierarchy.Create(nodes[i]);
+				hierarchy.SetLocalMatrix(child, GetTestLocalMatrix(nodeCount + i));
+				nodes.push_back(child);
+			}
+		}
+		nodes.erase(std::remove(nodes.begin(), nodes.end(), TransformHierarchy::NoNode), nodes.end());
+
+		double start = GetSeconds();
+		uint32_t recomputed = hierarchy.Update();
+		double seconds = GetSeconds() - start;
+
+		size_t wrong = CheckHierarchy(hierarchy, nodes);
+		bool countMatches = hierarchy.GetNodeCount() == nodes.size();
+		valid = valid && wrong == 0 && cycleRefused && countMatches;
+		printf("\n  Restructured: %u nodes, %u recomputed in %.2f ms  %s", hierarchy.GetNodeCount(), recomputed, seconds * 1000.0,
+			wrong == 0 && cycleRefused && countMatches ? "OK" : "");
+		if (wrong > 0) printf(" %zu WRONG", wrong);
+		if (!cycleRefused) printf(" CYCLE ALLOWED");
+		if (!countMatches) printf(" %zu NODES EXPECTED", nodes.size());
+		printf("\n");
+
+		// Removing most of a scene (every node but each tenth, children first or parents
+		// first), then the rest of it, the way a level is unloaded
+		for (int parentsFirst = 0; parentsFirst < 2; parentsFirst++) {
+			TransformHierarchy removing;
+			std::vector<uint32_t> all(nodeCount);
+			for (uint32_t i = 0; i < nodeCount; i++) {
+				all[i] = removing.Create(i > 0 ? all[(i * 2654435761u >> 8) % i] : TransformHierarchy::NoNode);
+				removing.SetLocalMatrix(all[i], GetTestLocalMatrix(i));
+			}
+			removing.Update();
+
+			std::vector<uint32_t> kept;
+			start = GetSeconds();
+			for (uint32_t n = 0; n < nodeCount; n++) {
+				uint32_t i = parentsFirst ? n : nodeCount - 1 - n;
+				if (i % 10 == 0)
+					kept.push_back(all[i]);
+				else
+					removing.Destroy(all[i]);
+			}
+			double destroySeconds = GetSeconds() - start;
+
+			start = GetSeconds();
+			recomputed = removing.Update();
+			double updateSeconds = GetSeconds() - start;
+
+			wrong = CheckHierarchy(removing, kept);
+			countMatches = removing.GetNodeCount() == kept.size();
+
+			start = GetSeconds();
+			for (uint32_t node : kept)
+				removing.Destroy(node);
+			double teardownSeconds = GetSeconds() - start;
+			bool empty = removing.GetNodeCount() == 0 && removing.Update() == 0;
+
+			valid = valid && wrong == 0 && countMatches && empty;
+			printf("  Removed %s: %u nodes in %.2f ms, %u recomputed in %.2f ms, the other %zu in %.2f ms  %s",
+				parentsFirst ? "parents first " : "children first",
+				nodeCount - (uint32_t)kept.size(), destroySeconds * 1000.0,
+				recomputed, updateSeconds * 1000.0,
+				kept.size(), teardownSeconds * 1000.0,
+				wrong == 0 && countMatches && empty ? "OK" : "");
+			if (wrong > 0) printf(" %zu WRONG", wrong);
+			if (!countMatches) printf(" %zu NODES EXPECTED", kept.size());
+			if (!empty) printf(" NOT EMPTY");
+			printf("\n");
+		}
+		return valid ? 0 : 1;
+	}
+
+	int Affine(int argc, char* argv[])
+	{
+		uint32_t count = argc >= 1 ? (uint32_t)strtoul(argv[0], nullptr, 10) : 100000;
+		if (count < 2) {
+			printf("Need at least 2 matrices\n");
+			return 1;
+		}
+		const int runs = 10;
+
+		// Scaled unevenly (and mirrored), turned every way, and moved a long way, as world matrices can be
+		std::vector<XMFLOAT4X4> full(count);
+		std::vector<AffineMatrix> affine(count);
+		for (uint32_t i = 0; i < count; i++) {
+			float f = (float)i;
+			XMMATRIX matrix =
+				XMMatrixScaling(0.01f + (i % 13) * 3.0f, 1.0f + (i % 5) * 0.1f, (i % 2) ? -0.5f : 20.0f) *
+				XMMatrixRotationRollPitchYaw(f * 0.37f, f * 1.13f, f * 0.71f) *
+				XMMatrixTranslation(f * 0.1f - 500.0f, (float)(i % 1000), -f * 0.05f);
+			XMStoreFloat4x4(&full[i], matrix);
+			affine[i] = AffineMatrix::FromFloat4x4(full[i]);
+		}
+
+		// And evenly scaled ones, which is what most things are
+		std::vector<AffineMatrix> even(count);
+		for (uint32_t i = 0; i < count; i++) {
+			float f = (float)i;
+			even[i] = AffineMatrix::Store(
+				XMMatrixScaling(0.005f + (i % 7) * 2.0f, 0.005f + (i % 7) * 2.0f, 0.005f + (i % 7) * 2.0f) *
+				XMMatrixRotationRollPitchYaw(f * 0.37f, f * 1.13f, f * 0.71f) *
+				XMMatrixTranslation(f * 0.1f - 500.0f, (float)(i % 1000), -f * 0.05f));
+		}
+
+		// Converting back has to give exactly what went in
+		size_t roundTripWrong = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			XMFLOAT4X4 back = affine[i].ToFloat4x4();
+			if (memcmp(&back, &full[i], sizeof(XMFLOAT4X4)) != 0)
+				roundTripWrong++;
+		}
+
+		// Each one times the next, and a point through each, both ways
+		float maxMultiplyError = 0.0f, maxPointError = 0.0f;
+		size_t lastColumnWrong = 0;
+		for (uint32_t i = 0; i + 1 < count; i++) {
+			XMFLOAT4X4 expected, product = AffineMatrix::Multiply(affine[i], affine[i + 1]).ToFloat4x4();
+			XMStoreFloat4x4(&expected, XMMatrixMultiply(XMLoadFloat4x4(&full[i]), XMLoadFloat4x4(&full[i + 1])));
+			float scale = 1.0f;
+			for (int row = 0; row < 4; row++) {
+				for (int column = 0; column < 3; column++)
+					scale = fmaxf(scale, fabsf(expected.m[row][column]));
+			}
+			for (int row = 0; row < 4; row++) {
+				for (int column = 0; column < 3; column++)
+					maxMultiplyError = fmaxf(maxMultiplyError, fabsf(product.m[row][column] - expected.m[row][column]) / scale);
+				if (product.m[row][3] != (row == 3 ? 1.0f : 0.0f))
+					lastColumnWrong++;
+			}
+
+			XMVECTOR point = XMVectorSet((float)(i % 7) - 3.0f, (float)(i % 11) * 0.5f, -(float)(i % 3), 1.0f);
+			XMVECTOR expectedPoint = XMVector3Transform(point, XMLoadFloat4x4(&full[i]));
+			XMVECTOR difference = XMVectorAbs(XMVectorSubtract(affine[i].TransformPoint(point), expectedPoint));
+			float pointScale = 1.0f + XMVectorGetX(XMVector3Length(expectedPoint));
+			maxPointError = fmaxf(maxPointError, fmaxf(XMVectorGetX(difference), fmaxf(XMVectorGetY(difference), XMVectorGetZ(difference))) / pointScale);
+		}
+
+		// Normal matrices against the inverse worked out in doubles, each relative to its largest element
+		// - Row i of the normal matrix is row i of the inverse of the 3x3 part (see AffineMatrix::GetNormalMatrix)
+		// - Only the evenly scaled ones should take the shortcut
+		float maxNormalError = 0.0f;
+		size_t unevenShortcuts = 0, evenShortcuts = 0, normalWWrong = 0;
+		auto checkNormal = [&](const AffineMatrix& matrix, size_t& shortcuts) {
+			bool isUniform;
+			AffineMatrix normal = matrix.GetNormalMatrix(&isUniform);
+
+			XMFLOAT4X4 m = matrix.ToFloat4x4();
+			double inverse[3][3], determinant = 0.0;
+			for (int row = 0; row < 3; row++) {
+				for (int column = 0; column < 3; column++) {
+					int r0 = (column + 1) % 3, r1 = (column + 2) % 3, c0 = (row + 1) % 3, c1 = (row + 2) % 3;
+					inverse[row][column] = (double)m.m[r0][c0] * m.m[r1][c1] - (double)m.m[r0][c1] * m.m[r1][c0];
+				}
+			}
+			for (int column = 0; column < 3; column++)
+				determinant += m.m[0][column] * inverse[column][0];
+
+			double scale = 0.0;
+			for (int row = 0; row < 3; row++) {
+				for (int column = 0; column < 3; column++) {
+					inverse[row][column] /= determinant;
+					scale = fmax(scale, fabs(inverse[row][column]));
+				}
+			}
+			for (int row = 0; row < 3; row++) {
+				const float* values = &normal.rows[row].x;
+				for (int column = 0; column < 3; column++)
+					maxNormalError = fmaxf(maxNormalError, (float)(fabs(values[column] - inverse[row][column]) / scale));
+				if (normal.rows[row].w != 0.0f)
+					normalWWrong++;
+			}
+			if (isUniform)
+				shortcuts++;
+		};
+		for (uint32_t i = 0; i < count; i++) {
+			checkNormal(affine[i], unevenShortcuts);
+			checkNormal(even[i], evenShortcuts);
+		}
+
+		// Best time of a few runs of multiplying every neighbouring pair
+		std::vector<XMFLOAT4X4> fullProducts(count - 1);
+		std::vector<AffineMatrix> affineProducts(count - 1);
+		double fullSeconds = TimeBest(runs, [&]() {
+			for (uint32_t i = 0; i + 1 < count; i++)
+				XMStoreFloat4x4(&fullProducts[i], XMMatrixMultiply(XMLoadFloat4x4(&full[i]), XMLoadFloat4x4(&full[i + 1])));
+		});
+		double affineSeconds = TimeBest(runs, [&]() {
+			for (uint32_t i = 0; i + 1 < count; i++)
+				affineProducts[i] = AffineMatrix::Multiply(affine[i], affine[i + 1]);
+		});
+
+		// And of the normal matrices: the full inverse, then the cofactors, then the shortcut
+		std::vector<AffineMatrix> normals(count);
+		double inverseSeconds = TimeBest(runs, [&]() {
+			for (uint32_t i = 0; i < count; i++)
+				normals[i] = AffineMatrix::Store(XMMatrixTranspose(XMMatrixInverse(nullptr, affine[i].Load())));
+		});
+		double unevenSeconds = TimeBest(runs, [&]() {
+			for (uint32_t i = 0; i < count; i++)
+				normals[i] = affine[i].GetNormalMatrix();
+		});
+		double evenSeconds = TimeBest(runs, [&]() {
+			for (uint32_t i = 0; i < count; i++)
+				normals[i] = even[i].GetNormalMatrix();
+		});
+
+		bool normalsValid = maxNormalError <= 1e-4f && normalWWrong == 0 && unevenShortcuts == 0 && evenShortcuts == count;
+		bool valid = roundTripWrong == 0 && lastColumnWrong == 0 && maxMultiplyError <= 1e-5f && maxPointError <= 1e-5f && normalsValid;
+		printf("%u matrices, best of %d runs\n", count, runs);
+		printf("  Size             %9zu bytes (4x4) %9zu bytes (3x4, %.0f%% smaller)\n",
+			sizeof(XMFLOAT4X4) * count, sizeof(AffineMatrix) * count, 100.0 - 100.0 * sizeof(AffineMatrix) / sizeof(XMFLOAT4X4));
+		printf("  Multiply         %9.3f ms (4x4) %9.3f ms (3x4, %.2fx)\n",
+			fullSeconds * 1000.0, affineSeconds * 1000.0, affineSeconds > 0.0 ? fullSeconds / affineSeconds : 0.0);
+		printf("  Normal matrix    %9.3f ms (inverse) %9.3f ms (uneven, %.2fx) %9.3f ms (even, %.2fx)\n",
+			inverseSeconds * 1000.0,
+			unevenSeconds * 1000.0, unevenSeconds > 0.0 ? inverseSeconds / unevenSeconds : 0.0,
+			evenSeconds * 1000.0, evenSeconds > 0.0 ? inverseSeconds / evenSeconds : 0.0);
+		printf("  Round trip %s, multiply within %g, points within %g, normals within %g (%zu of %u even)  %s",
+			roundTripWrong == 0 ? "exact" : "WRONG", maxMultiplyError, maxPointError, maxNormalError, evenShortcuts, count, valid ? "OK" : "");
+		if (roundTripWrong > 0) printf(" %zu ROUND TRIPS DIFFER", roundTripWrong);
+		if (lastColumnWrong > 0) printf(" %zu LAST COLUMNS WRONG", lastColumnWrong);
+		if (maxMultiplyError > 1e-5f) printf(" MULTIPLY MISMATCH");
+		if (maxPointError > 1e-5f) printf(" POINT MISMATCH");
+		if (maxNormalError > 1e-4f || normalWWrong > 0) printf(" NORMAL MISMATCH");
+		if (unevenShortcuts > 0 || evenShortcuts != count) printf(" %zu UNEVEN TAKEN AS EVEN, %zu EVEN MISSED", unevenShortcuts, count - evenShortcuts);
+		printf("\n");
+		return valid ? 0 : 1;
+	}
+
+	// What every entity used to be: its own object on the heap, with its own world matrix
+	struct EntityObject
+	{
+		EntityObject* parent;
+		XMFLOAT3 position;
+		XMFLOAT4 orientation;
+		XMFLOAT3 scale;
+		XMFLOAT4X4 world;
+		char mesh[64];		// Stands in for the rest of an entity, so objects aren't packed tighter than they would be
+	};
+
+	// Somewhere to put entity i, turned and scaled a little differently from the others
+	void GetTestEntity(uint32_t i, float offset, XMFLOAT3& position, XMFLOAT4& orientation, XMFLOAT3& scale)
+	{
+		float f = (float)i;
+		position = XMFLOAT3(f * 0.01f + offset, (float)(i % 100), -f * 0.02f);
+		XMStoreFloat4(&orientation, XMQuaternionRotationRollPitchYaw(f * 0.001f, f * 0.002f + offset, f * 0.0005f));
+		scale = XMFLOAT3(1.0f + (i % 7) * 0.25f, 1.0f, 0.5f + (i % 3) * 0.5f);
+	}
+
+	int BenchEntities(int argc, char* argv[])
+	{
+		uint32_t maxCount = argc >= 1 ? (uint32_t)strtoul(argv[0], nullptr, 10) : 1 << 20;
+		printf("%u hardware threads, everything moved every run (and 1%% of it, packed), 3 in 4 under the one before\n", GetHardwareThreadCount());
+		printf("  %9s %20s %20s %20s %21s %20s  %s\n", "entities", "objects", "packed, 1 thread", "packed, threads", "(local + world)", "packed, 1% moved", "");
+
+		bool valid = true;
+		for (uint32_t count = 16; count <= maxCount; count = GetNextCount(count, maxCount)) {
+			int runs = count <= 4096 ? 100 : 5;
+
+			// Allocated one at a time, the way entities are made
+			std::vector<std::unique_ptr<EntityObject>> objects(count);
+			TransformSystem system;
+			std::vector<uint32_t> transforms(count);
+			for (uint32_t i = 0; i < count; i++) {
+				objects[i] = std::make_unique<EntityObject>();
+				objects[i]->parent = (i % 4 != 0) ? objects[i - 1].get() : nullptr;
+				transforms[i] = system.Create();
+				if (i % 4 != 0)
+					system.SetParent(transforms[i], transforms[i - 1]);
+			}
+
+			// Moving everything (outside the timing), then building the matrices
+			auto moveObjects = [&](int run) {
+				for (uint32_t i = 0; i < count; i++) {
+					EntityObject& object = *objects[i];
+					GetTestEntity(i, (float)run, object.position, object.orientation, object.scale);
+				}
+			};
+			auto moveTransforms = [&](uint32_t step) {
+				return [&, step](int run) {
+					XMFLOAT3 position, scale;
+					XMFLOAT4 orientation;
+					for (uint32_t i = 0; i < count; i += step) {
+						GetTestEntity(i, (float)run, position, orientation, scale);
+						system.SetPosition(transforms[i], position);
+						system.SetOrientation(transforms[i], orientation);
+						system.SetScale(transforms[i], scale);
+					}
+				};
+			};
+
+			// Parents are made first, so they're always built first
+			auto buildObjects = [&]() {
+				for (uint32_t i = 0; i < count; i++) {
+					EntityObject& object = *objects[i];
+					XMMATRIX world =
+						XMMatrixScaling(object.scale.x, object.scale.y, object.scale.z) *
+						XMMatrixRotationQuaternion(XMLoadFloat4(&object.orientation)) *
+						XMMatrixTranslation(object.position.x, object.position.y, object.position.z);
+					if (object.parent != nullptr)
+						world = world * XMLoadFloat4x4(&object.parent->world);
+					XMStoreFloat4x4(&object.world, world);
+				}
+			};
+
+			double objectSeconds = TimeBest(runs, moveObjects, buildObjects);
+			double singleSeconds = TimeBest(runs, moveTransforms(1), [&]() { system.Update(1); });
+			double parallelSeconds = TimeBest(runs, moveTransforms(1), [&]() { system.Update(); });
+			double localSeconds = TimeBest(runs, moveTransforms(1), [&]() { system.UpdateLocalMatrices(); });
+			double worldSeconds = TimeBest(runs, [&](int run) { moveTransforms(1)(run); system.UpdateLocalMatrices(); }, [&]() { system.UpdateWorldMatrices(); });
+			double someSeconds = TimeBest(runs, moveTransforms(100), [&]() { system.Update(); });
+
+			// The packed matrices should be the object ones, give or take rounding
+			moveObjects(0);
+			buildObjects();
+			moveTransforms(1)(0);
+			system.Update();
+			float maxError = 0.0f;
+			for (uint32_t i = 0; i < count; i++) {
+				const XMFLOAT4X4& expected = objects[i]->world;
+				XMFLOAT4X4 packed = system.GetWorldMatrix(transforms[i]).ToFloat4x4();
+				float translationScale = 1.0f + fabsf(expected.m[3][0]) + fabsf(expected.m[3][1]) + fabsf(expected.m[3][2]);
+				for (int row = 0; row < 4; row++) {
+					for (int column = 0; column < 4; column++)
+						maxError = fmaxf(maxError, fabsf(packed.m[row][column] - expected.m[row][column]) / (row == 3 ? translationScale : 1.0f));
+				}
+			}
+			bool matches = maxError <= 1e-5f;
+			valid = valid && matches;
+
+			auto rate = [&](double seconds) { return seconds > 0.0 ? seconds * 1e9 / count : 0.0; };
+			printf("  %9u %8.3f ms %5.1f ns %8.3f ms %5.1f ns %8.3f ms %5.1f ns (%7.3f + %7.3f ms) %8.3f ms %5.1f ns  %s\n", count,
+				objectSeconds * 1000.0, rate(objectSeconds),
+				singleSeconds * 1000.0, rate(singleSeconds),
+				parallelSeconds * 1000.0, rate(parallelSeconds),
+				localSeconds * 1000.0, worldSeconds * 1000.0,
+				someSeconds * 1000.0, rate(someSeconds),
+				matches ? "OK" : "MISMATCH");
+			if (count == maxCount)
+				break;
+		}
+		return valid ? 0 : 1;
+	}
+
+	int BenchWorldViewProj(int argc, char* argv[])
+	{
+		uint32_t maxCount = argc >= 1 ? (uint32_t)strtoul(argv[0], nullptr, 10) : 1 << 16;
+
+		// A camera and four shadows, the way Game and Shadow add them
+		std::vector<XMFLOAT4X4> views(5), projs(5);
+		XMStoreFloat4x4(&views[0], XMMatrixLookToLH(XMVectorSet(0.0f, 5.0f, -5.0f, 0.0f), XMVectorSet(0.0f, -0.5f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		XMStoreFloat4x4(&projs[0], XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.01f, 1000.0f));
+		for (int light = 1; light < 5; light++) {
+			float angle = light * XM_PIDIV2;
+			XMStoreFloat4x4(&views[light], XMMatrixLookToLH(
+				XMVectorSet(-20.0f * sinf(angle), 20.0f, -20.0f * cosf(angle), 0.0f),
+				XMVectorSet(sinf(angle), -1.0f, cosf(angle), 0.0f),
+				XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+			XMStoreFloat4x4(&projs[light], XMMatrixOrthographicLH(10.0f, 10.0f, 0.1f, 100.0f));
+		}
+
+		printf("%zu views, every world matrix multiplied by every view\n", views.size());
+		printf("  %9s %20s %20s %9s  %s\n", "entities", "one at a time", "batched", "speedup", "");
+
+		bool valid = true;
+		for (uint32_t count = 16; count <= maxCount; count = GetNextCount(count, maxCount)) {
+			int runs = count <= 4096 ? 100 : 10;
+
+			std::vector<AffineMatrix> worlds(count);
+			for (uint32_t i = 0; i < count; i++) {
+				XMFLOAT3 position, scale;
+				XMFLOAT4 orientation;
+				GetTestEntity(i, 0.0f, position, orientation, scale);
+				worlds[i] = AffineMatrix::Store(
+					XMMatrixScaling(scale.x, scale.y, scale.z) *
+					XMMatrixRotationQuaternion(XMLoadFloat4(&orientation)) *
+					XMMatrixTranslation(position.x, position.y, position.z));
+			}
+
+			// The way it was per draw: the full world matrix times the view, times the projection
+			std::vector<XMFLOAT4X4> separate(views.size() * count);
+			double separateSeconds = TimeBest(runs, [&]() {
+				for (size_t view = 0; view < views.size(); view++) {
+					for (uint32_t i = 0; i < count; i++) {
+						XMStoreFloat4x4(&separate[view * count + i], XMMatrixMultiply(
+							XMMatrixMultiply(worlds[i].Load(), XMLoadFloat4x4(&views[view])),
+							XMLoadFloat4x4(&projs[view])));
+					}
+				}
+			});
+
+			// Everything the batch does in a frame, adding the views and worlds included
+			WorldViewProjBatch batch;
+			double batchSeconds = TimeBest(runs, [&]() {
+				batch.Clear();
+				for (size_t view = 0; view < views.size(); view++)
+					batch.AddView(views[view], projs[view]);
+				for (uint32_t i = 0; i < count; i++)
+					batch.AddWorld(worlds[i]);
+				batch.Compute();
+			});
+
+			// The same matrices, give or take rounding (relative to the largest element of each)
+			float maxError = 0.0f;
+			for (uint32_t view = 0; view < (uint32_t)views.size(); view++) {
+				for (uint32_t i = 0; i < count; i++) {
+					const XMFLOAT4X4& expected = separate[view * count + i];
+					const XMFLOAT4X4& batched = batch.Get(view, i);
+					float scale = 1.0f;
+					for (int row = 0; row < 4; row++) {
+						for (int column = 0; column < 4; column++)
+							scale = fmaxf(scale, fabsf(expected.m[row][column]));
+					}
+					for (int row = 0; row < 4; row++) {
+						for (int column = 0; column < 4; column++)
+							maxError = fmaxf(maxError, fabsf(batched.m[row][column] - expected.m[row][column]) / scale);
+					}
+				}
+			}
+			bool matches = maxError <= 1e-5f;
+			valid = valid && matches;
+
+			auto rate = [&](double seconds) { return seconds > 0.0 ? seconds * 1e9 / (count * views.size()) : 0.0; };
+			printf("  %9u %8.3f ms %5.1f ns %8.3f ms %5.1f ns %8.2fx  %s\n", count,
+				separateSeconds * 1000.0, rate(separateSeconds),
+				batchSeconds * 1000.0, rate(batchSeconds),
+				batchSeconds > 0.0 ? separateSeconds / batchSeconds : 0.0,
+				matches ? "OK" : "MISMATCH");
+			if (count == maxCount)
+				break;
+		}
+		return valid ? 0 : 1;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc >= 3 && strcmp(argv[1], "cook") == 0)
+		return Cook(argc - 2, argv + 2);
+
+	if ((argc == 3 || argc == 4) && strcmp(argv[1], "inspect") == 0)
+		return Inspect(argv[2], argc == 4 ? argv[3] : nullptr);
+
+	if (argc == 4 && strcmp(argv[1], "synth") == 0)
+		return Synth(argv[2], argv[3]);
+
+	if (argc >= 3 && strcmp(argv[1], "bench-parse") == 0)
+		return BenchParse(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "bench-tangents") == 0)
+		return BenchTangents(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "bench-optimize") == 0)
+		return BenchOptimize(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "pack") == 0)
+		return Pack(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "lod") == 0)
+		return Lod(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "bench-meshlets") == 0)
+		return BenchMeshlets(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "bounds") == 0)
+		return Bounds(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "bench-transform") == 0)
+		return BenchTransform(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "bench-pool") == 0)
+		return BenchPool(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "positions") == 0)
+		return Positions(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "bench-import") == 0)
+		return BenchImport(argc - 2, argv + 2);
+
+	if (argc >= 3 && strcmp(argv[1], "bench-load") == 0)
+		return BenchLoad(argc - 2, argv + 2);
+
+	if ((argc == 2 || argc == 3) && strcmp(argv[1], "primitives") == 0)
+		return Primitives(argc - 2, argv + 2);
+
+	if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench-hierarchy") == 0)
+		return BenchHierarchy(argc - 2, argv + 2);
+
+	if ((argc == 2 || argc == 3) && strcmp(argv[1], "affine") == 0)
+		return Affine(argc - 2, argv + 2);
+
+	if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench-entities") == 0)
+		return BenchEntities(argc - 2, argv + 2);
+
+	if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench-wvp") == 0)
+		return BenchWorldViewProj(argc - 2, argv + 2);
+
+	PrintUsage();
+	return 1;
+}
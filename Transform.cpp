@@ -3,63 +3,145 @@ using namespace DirectX;
 
 Transform::Transform()
 {
-	position = XMFLOAT3(0.0f, 0.0f, 0.0f);
-	scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
+	handle = GetSystem().Create();
 }
 
 Transform::Transform(XMFLOAT3 position, XMFLOAT3 scale, XMFLOAT4 rotation)
 {
-	this->position = position;
-	this->scale = scale;
-	this->rotation = rotation;
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
+	handle = GetSystem().Create();
+	SetPosition(position);
+	SetScale(scale);
+	SetRotation(rotation);
+}
+
+Transform::Transform(const Transform& other)
+{
+	TransformSystem& system = GetSystem();
+	handle = system.Create();
+	system.SetPosition(handle, system.GetPosition(other.handle));
+	system.SetOrientation(handle, system.GetOrientation(other.handle));
+	system.SetScale(handle, system.GetScale(other.handle));
+	system.SetParent(handle, system.GetParent(other.handle));
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+	if (this == &other)
+		return *this;
+
+	TransformSystem& system = GetSystem();
+	system.SetPosition(handle, system.GetPosition(other.handle));
+	system.SetOrientation(handle, system.GetOrientation(other.handle));
+	system.SetScale(handle, system.GetScale(other.handle));
+	system.SetParent(handle, system.GetParent(other.handle));
+	return *this;
+}
+
+Transform::~Transform()
+{
+	GetSystem().Destroy(handle);
+}
+
+// Made the first time it's needed, so it's there before any transform
+TransformSystem& Transform::GetSystem()
+{
+	static TransformSystem system;
+	return system;
 }
 
 
 #pragma region Getters/Setters
-XMFLOAT4 Transform::GetRotation() { return rotation; }
-XMFLOAT3 Transform::GetPosition() { return position; }
-XMFLOAT3 Transform::GetScale() { return scale; }
+XMFLOAT4 Transform::GetOrientation() { return GetSystem().GetOrientation(handle); }
+XMFLOAT3 Transform::GetPosition() { return GetSystem().GetPosition(handle); }
+XMFLOAT3 Transform::GetScale() { return GetSystem().GetScale(handle); }
+uint64_t Transform::GetGeneration() { UpdateHierarchy(); return GetSystem().GetGeneration(handle); }
+
+// Kept by the system, see TransformSystem::UpdateAngles
+XMFLOAT4 Transform::GetRotation() {
+	XMFLOAT3 euler = GetSystem().GetRotation(handle);
+	return XMFLOAT4(euler.x, euler.y, euler.z, 0.0f);
+}
 
-void Transform::SetRotation(XMFLOAT4 newRotation) { rotation = newRotation; }
-void Transform::SetPosition(XMFLOAT3 newPosition) { position = newPosition; }
-void Transform::SetScale(XMFLOAT3 newScale) { scale = newScale; }
+void Transform::SetRotation(XMFLOAT4 newRotation) {
+	XMFLOAT4 orientation;
+	XMStoreFloat4(&orientation, XMQuaternionRotationRollPitchYaw(newRotation.x, newRotation.y, newRotation.z));
+	GetSystem().SetOrientation(handle, orientation);
+}
+void Transform::SetOrientation(XMFLOAT4 newOrientation) {
+	XMFLOAT4 orientation;
+	XMStoreFloat4(&orientation, XMQuaternionNormalize(XMLoadFloat4(&newOrientation)));
+	GetSystem().SetOrientation(handle, orientation);
+}
+void Transform::SetPosition(XMFLOAT3 newPosition) { GetSystem().SetPosition(handle, newPosition); }
+void Transform::SetScale(XMFLOAT3 newScale) { GetSystem().SetScale(handle, newScale); }
 #pragma endregion
 
 
 #pragma region Functions
-void Transform::MoveAbsolute(float x, float y, float z) { XMStoreFloat3(&position, XMVectorAdd(XMLoadFloat3(&position), XMVectorSet(x, y, z, 0.0f))); }
+bool Transform::SetParent(Transform* parent) {
+	return GetSystem().SetParent(handle, parent ? parent->handle : TransformSystem::NoTransform);
+}
+
+void Transform::UpdateHierarchy() {
+	TransformSystem& system = GetSystem();
+	if (system.IsDirty())
+		system.Update();
+}
+
+void Transform::MoveAbsolute(float x, float y, float z) {
+	XMFLOAT3 position = GetPosition();
+	XMStoreFloat3(&position, XMVectorAdd(XMLoadFloat3(&position), XMVectorSet(x, y, z, 0.0f)));
+	SetPosition(position);
+}
 void Transform::MoveRelative(float x, float y, float z) {
+	XMFLOAT3 position = GetPosition();
+	XMFLOAT4 orientation = GetOrientation();
 	XMStoreFloat3(
 		&position,
 		XMVectorAdd(
 			XMLoadFloat3(&position),
-			XMVector3Rotate(
-				XMVectorSet(x, y, z, 0.0f),
-				XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z))));
+			XMVector3Rotate(XMVectorSet(x, y, z, 0.0f), XMLoadFloat4(&orientation))));
+	SetPosition(position);
 }
-void Transform::Rotate(float pitch, float yaw, float roll) { XMStoreFloat4(&rotation, XMVectorAdd(XMLoadFloat4(&rotation), XMVectorSet(pitch, yaw, roll, 0.0f))); }
-void Transform::Scale(float x, float y, float z) { XMStoreFloat3(&scale, XMVectorMultiply(XMLoadFloat3(&scale), XMVectorSet(x, y, z, 0.0f))); };
+void Transform::Rotate(float pitch, float yaw, float roll) {
+	// Roll and pitch first (in local space), then the current orientation, then yaw (in world space)
+	XMFLOAT4 orientation = GetOrientation();
+	XMVECTOR local = XMQuaternionRotationRollPitchYaw(pitch, 0.0f, roll);
+	XMVECTOR world = XMQuaternionRotationRollPitchYaw(0.0f, yaw, 0.0f);
+	XMVECTOR rotated = XMQuaternionMultiply(XMQuaternionMultiply(local, XMLoadFloat4(&orientation)), world);
 
+	// Normalized every time, so rounding can't build up over many small turns
+	XMStoreFloat4(&orientation, XMQuaternionNormalize(rotated));
+	GetSystem().SetOrientation(handle, orientation);
+}
+void Transform::Scale(float x, float y, float z) {
+	XMFLOAT3 scale = GetScale();
+	XMStoreFloat3(&scale, XMVectorMultiply(XMLoadFloat3(&scale), XMVectorSet(x, y, z, 0.0f)));
+	SetScale(scale);
+}
+
+XMFLOAT4X4 Transform::GetLocalMatrix() {
+	UpdateHierarchy();
+	return GetSystem().GetLocalMatrix(handle).ToFloat4x4();
+}
 XMFLOAT4X4 Transform::GetWorldMatrix() {
-	// Get the quats for position, rotation, and scale.
-	XMMATRIX translationMatrix = XMMatrixTranslation(position.x, position.y, position.z);
-	XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-	XMMATRIX scalingMatrix = XMMatrixScaling(scale.x, scale.y, scale.z);
-	
-	// Store the world matrix and return it.
-	XMStoreFloat4x4(&worldMatrix, scalingMatrix * rotationMatrix * translationMatrix);
-	return worldMatrix;
-}
-XMFLOAT3 Transform::GetForwardVector() {
-	XMFLOAT3 forwardVec = XMFLOAT3(0, 0, 0);
-	XMStoreFloat3(
-		&forwardVec,
-		XMVector3Rotate(
-			XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f),
-			XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z)));
-	return forwardVec;
+	return GetWorldAffine().ToFloat4x4();
+}
+AffineMatrix Transform::GetWorldAffine() {
+	// Nothing to do unless something changed since the last time
+	UpdateHierarchy();
+	return GetSystem().GetWorldMatrix(handle);
 }
+AffineMatrix Transform::GetNormalMatrix() {
+	UpdateHierarchy();
+	return GetSystem().GetNormalMatrix(handle);
+}
+XMFLOAT3 Transform::GetWorldPosition() {
+	AffineMatrix world = GetWorldAffine();
+	return XMFLOAT3(world.rows[0].w, world.rows[1].w, world.rows[2].w);
+}
+
+XMFLOAT3 Transform::GetForwardVector() { return GetSystem().GetForward(handle); }
+XMFLOAT3 Transform::GetRightVector() { return GetSystem().GetRight(handle); }
+XMFLOAT3 Transform::GetUpVector() { return GetSystem().GetUp(handle); }
 #pragma endregion
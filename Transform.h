@@ -1,21 +1,40 @@
 #pragma once
 
 #include "StandardIncludes.h"
+#include "TransformSystem.h"
+#include <cstdint>
 
 
+// --------------------------------------------------------
+// Position, orientation and scale, relative to a parent
+// transform (if it has one)
+//
+// - Only a handle: the values and matrices live in one shared
+//   TransformSystem, packed with every other transform's, so
+//   building them all doesn't go from object to object.
+// - Changes are only built into matrices (and passed on to
+//   the children) when a world matrix or generation is next
+//   asked for, or at UpdateHierarchy.
+// - A copy gets a transform of its own, with the same parent.
+// --------------------------------------------------------
 class Transform
 {
 public:
 	Transform();
-	Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, DirectX::XMFLOAT4 rotation);
+	Transform(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 scale, DirectX::XMFLOAT4 rotation);	// rotation as Euler angles, see SetRotation
+	Transform(const Transform& other);
+	Transform& operator=(const Transform& other);
+	~Transform();	// Its children move up to its parent
 
-	// Getters
-	DirectX::XMFLOAT4 GetRotation();
+	// Getters (all relative to the parent)
+	DirectX::XMFLOAT4 GetRotation();		// Euler angles (pitch, yaw, roll, 0), worked out once per change of orientation
+	DirectX::XMFLOAT4 GetOrientation();		// Unit quaternion
 	DirectX::XMFLOAT3 GetPosition();
 	DirectX::XMFLOAT3 GetScale();
 
 	// Setters
-	void SetRotation(DirectX::XMFLOAT4 newRotation);
+	void SetRotation(DirectX::XMFLOAT4 newRotation);		// Euler angles (pitch, yaw, roll), w is ignored
+	void SetOrientation(DirectX::XMFLOAT4 newOrientation);	// Normalized here
 	void SetPosition(DirectX::XMFLOAT3 newPosition);
 	void SetScale(DirectX::XMFLOAT3 newScale);
 
@@ -24,18 +43,44 @@ public:
 	void MoveAbsolute(float x, float y, float z);
 	// Move position using current orientation
 	void MoveRelative(float x, float y, float z);
+	// Pitch and roll turn around the transform's own axes, yaw around the world's up
+	// (the same as adding to each Euler angle, for anything that doesn't roll).
 	void Rotate(float pitch, float yaw, float roll);
 	void Scale(float x, float y, float z);
 
-	DirectX::XMFLOAT4X4 GetWorldMatrix();
+	// Attach to another transform (nullptr for none). Everything set on this one is then
+	// relative to the parent, and it moves with it.
+	// - Returns false (and changes nothing) if the parent is this one or one of its children.
+	bool SetParent(Transform* parent);
+
+	// Built only when something changed since it was last asked for.
+	DirectX::XMFLOAT4X4 GetLocalMatrix();
+	DirectX::XMFLOAT4X4 GetWorldMatrix();	// Local, then the parent's world matrix
+	AffineMatrix GetWorldAffine();			// The same, as it's stored (and uploaded to shaders)
+	AffineMatrix GetNormalMatrix();			// Inverse transpose of the world matrix, for normals (kept until the rotation or scale changes)
+	DirectX::XMFLOAT3 GetWorldPosition();
+
+	// The orientation's axes (relative to the parent), worked out once per change of it.
 	DirectX::XMFLOAT3 GetForwardVector();
+	DirectX::XMFLOAT3 GetRightVector();
+	DirectX::XMFLOAT3 GetUpVector();
 
-private:
-	DirectX::XMFLOAT4X4 worldMatrix;
+	// Goes up every time the world matrix changes (never 0), so anything
+	// worked out from it can keep the generation it used and check that
+	// instead of comparing matrices.
+	// - Moving a parent changes the generation of everything under it.
+	uint64_t GetGeneration();
 
-	DirectX::XMFLOAT4 rotation;
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 scale;
+	// Build the matrices of every transform that changed since the last update
+	// (all at once, see TransformSystem::Update), and of their children.
+	// - Once a frame, after everything has moved, so drawing doesn't have to.
+	static void UpdateHierarchy();
+
+	// The store every transform lives in.
+	static TransformSystem& GetSystem();
+
+private:
+	uint32_t handle;		// In GetSystem()
 };
 
 
@@ -0,0 +1,346 @@
+#include "TransformHierarchy.h"
+#include "ParallelFor.h"
+#include <atomic>
+
+namespace
+{
+	const AffineMatrix Identity = AffineMatrix::Identity();
+
+	// Nodes per item handed to a thread.
+	const uint32_t BlockSize = 4096;
+
+	// Move everything in "values" to where "order" says (order[new slot] = old slot).
+	template<typename T>
+	void Gather(std::vector<T>& values, const std::vector<uint32_t>& order)
+	{
+		std::vector<T> sorted(order.size());
+		for (size_t i = 0; i < order.size(); i++)
+			sorted[i] = values[order[i]];
+		values.swap(sorted);
+	}
+
+	// Whether everything but the translation is the same
+	bool SameRotationAndScale(const AffineMatrix& a, const AffineMatrix& b)
+	{
+		for (int i = 0; i < 3; i++) {
+			if (a.rows[i].x != b.rows[i].x || a.rows[i].y != b.rows[i].y || a.rows[i].z != b.rows[i].z)
+				return false;
+		}
+		return true;
+	}
+}
+
+const uint32_t TransformHierarchy::NoNode;	// Passed by reference (std::max, ?:), so it needs a definition
+const size_t TransformHierarchy::DefaultParallelThreshold;
+
+
+uint32_t TransformHierarchy::Create(uint32_t parent)
+{
+	uint32_t node;
+	if (!m_freeHandles.empty()) {
+		node = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else {
+		node = (uint32_t)m_slots.size();
+		m_slots.push_back(NoNode);
+		m_parents.push_back(NoNode);
+		m_firstChildren.push_back(NoNode);
+		m_nextSiblings.push_back(NoNode);
+		m_prevSiblings.push_back(NoNode);
+	}
+
+	uint32_t slot = (uint32_t)m_handles.size();
+	uint32_t parentSlot = (parent == NoNode) ? NoNode : m_slots[parent];
+	uint32_t depth = (parent == NoNode) ? 0 : m_depths[parentSlot] + 1;
+	m_slots[node] = slot;
+	Link(node, parent);
+
+	m_handles.push_back(node);
+	m_parentSlots.push_back(parentSlot);
+	m_depths.push_back(depth);
+	m_locals.push_back(Identity);
+	m_worlds.push_back(Identity);
+	m_normals.push_back(Identity);
+	m_generations.push_back(1);
+	m_changed.push_back(0);
+	m_dirty.push_back(0);
+	m_nodeCount++;
+
+	// Still sorted if it's no shallower than the last one
+	if (slot > 0 && depth < m_depths[slot - 1])
+		m_orderDirty = true;
+
+	MarkDirty(slot);
+	return node;
+}
+
+void TransformHierarchy::Destroy(uint32_t node)
+{
+	// Its children move up a level
+	uint32_t parent = m_parents[node];
+	for (uint32_t child = m_firstChildren[node]; child != NoNode; ) {
+		uint32_t next = m_nextSiblings[child];
+		Link(child, parent);
+		MarkDirty(m_slots[child]);
+		child = next;
+	}
+	m_firstChildren[node] = NoNode;
+	Unlink(node);
+
+	// Its slot is dropped on the next sort
+	uint32_t slot = m_slots[node];
+	m_handles[slot] = NoNode;
+	m_dirty[slot] = 0;
+	m_slots[node] = NoNode;
+	m_freeHandles.push_back(node);
+	m_nodeCount--;
+	m_orderDirty = true;
+}
+
+bool TransformHierarchy::SetParent(uint32_t node, uint32_t parent)
+{
+	if (m_parents[node] == parent)
+		return true;
+
+	// Would it end up under itself?
+	for (uint32_t above = parent; above != NoNode; above = m_parents[above]) {
+		if (above == node)
+			return false;
+	}
+
+	Unlink(node);
+	Link(node, parent);
+	m_orderDirty = true;
+	MarkDirty(m_slots[node]);
+	return true;
+}
+
+uint32_t TransformHierarchy::GetParent(uint32_t node) const { return m_parents[node]; }
+
+void TransformHierarchy::SetLocalMatrix(uint32_t node, const AffineMatrix& local)
+{
+	uint32_t slot = m_slots[node];
+	m_locals[slot] = local;
+	MarkDirty(slot);
+}
+
+// Each block of nodes writes only its own slots, and works out the lowest one
+// it dirtied, so the only thing left to do here is pick the lowest of those
+// - Roots are stamped with the next update, so their children are recomputed then
+//   (they only count towards the first dirty slot if they have children at all).
+void TransformHierarchy::SetLocalMatrices(const uint32_t* nodes, const AffineMatrix* locals, uint8_t* changed, uint32_t count, unsigned int threadCount)
+{
+	uint32_t blockCount = (count + BlockSize - 1) / BlockSize;
+	std::vector<uint32_t> firstDirty(blockCount, NoNode);
+
+	ParallelFor(blockCount, threadCount, [&](size_t block) {
+		uint32_t begin = (uint32_t)block * BlockSize;
+		uint32_t end = begin + BlockSize < count ? begin + BlockSize : count;
+		uint32_t lowest = NoNode;
+		for (uint32_t i = begin; i < end; i++) {
+			if (!changed[i])
+				continue;
+			changed[i] = 0;
+
+			uint32_t node = nodes[i];
+			uint32_t slot = m_slots[node];
+			m_locals[slot] = locals[i];
+			if (m_parents[node] == NoNode) {
+				SetWorldMatrix(slot, locals[i]);
+				m_dirty[slot] = 0;
+				m_changed[slot] = m_update + 1;
+				if (m_firstChildren[node] == NoNode)
+					continue;
+			}
+			else {
+				m_dirty[slot] = 1;
+			}
+			if (lowest == NoNode || slot < lowest)
+				lowest = slot;
+		}
+		firstDirty[block] = lowest;
+	});
+
+	for (uint32_t slot : firstDirty) {
+		if (slot != NoNode && (m_firstDirty == NoNode || slot < m_firstDirty))
+			m_firstDirty = slot;
+	}
+}
+
+const AffineMatrix& TransformHierarchy::GetLocalMatrix(uint32_t node) const { return m_locals[m_slots[node]]; }
+const AffineMatrix& TransformHierarchy::GetWorldMatrix(uint32_t node) const { return m_worlds[m_slots[node]]; }
+const AffineMatrix& TransformHierarchy::GetNormalMatrix(uint32_t node) const { return m_normals[m_slots[node]]; }
+uint64_t TransformHierarchy::GetGeneration(uint32_t node) const { return m_generations[m_slots[node]]; }
+bool TransformHierarchy::IsDirty() const { return m_firstDirty != NoNode || m_orderDirty; }
+uint32_t TransformHierarchy::GetNodeCount() const { return m_nodeCount; }
+uint32_t TransformHierarchy::GetDepth(uint32_t node) const { return m_depths[m_slots[node]]; }
+
+// A depth at a time, so every node's parent is up to date (and has been
+// stamped with this update if it changed) before the node is reached
+// - Nodes at the same depth are next to each other, and only read their
+//   parents' slots, so a depth can be split across threads.
+uint32_t TransformHierarchy::Update(unsigned int threadCount, size_t parallelThreshold)
+{
+	// Always counted, so stamps from SetLocalMatrices are only ever seen by this update
+	m_update++;
+	if (m_orderDirty)
+		Sort();
+	if (m_firstDirty == NoNode)
+		return 0;
+
+	std::atomic<uint32_t> recomputed(0);
+	uint32_t slotCount = (uint32_t)m_handles.size();
+	for (uint32_t begin = m_firstDirty; begin < slotCount; ) {
+		uint32_t end = begin + 1;
+		while (end < slotCount && m_depths[end] == m_depths[begin])
+			end++;
+
+		uint32_t count = end - begin;
+		if (count < parallelThreshold || threadCount == 1)
+			recomputed += UpdateSlots(begin, end);
+		else {
+			ParallelFor((count + BlockSize - 1) / BlockSize, threadCount, [&](size_t block) {
+				uint32_t blockBegin = begin + (uint32_t)block * BlockSize;
+				recomputed += UpdateSlots(blockBegin, blockBegin + BlockSize < end ? blockBegin + BlockSize : end);
+			});
+		}
+		begin = end;
+	}
+
+	m_firstDirty = NoNode;
+	return recomputed;
+}
+
+// Recomputes the slots in [begin, end) that are dirty or whose parent changed.
+uint32_t TransformHierarchy::UpdateSlots(uint32_t begin, uint32_t end)
+{
+	uint32_t recomputed = 0;
+	for (uint32_t slot = begin; slot < end; slot++) {
+		uint32_t parentSlot = m_parentSlots[slot];
+		bool parentChanged = (parentSlot != NoNode && m_changed[parentSlot] == m_update);
+		if (!m_dirty[slot] && !parentChanged)
+			continue;
+
+		SetWorldMatrix(slot, (parentSlot == NoNode) ? m_locals[slot] : AffineMatrix::Multiply(m_locals[slot], m_worlds[parentSlot]));
+		m_dirty[slot] = 0;
+		m_changed[slot] = m_update;
+		recomputed++;
+	}
+	return recomputed;
+}
+
+// Also rebuilds the normal matrix, if it changed.
+void TransformHierarchy::SetWorldMatrix(uint32_t slot, const AffineMatrix& world)
+{
+	if (!SameRotationAndScale(world, m_worlds[slot]))
+		m_normals[slot] = world.GetNormalMatrix();
+	m_worlds[slot] = world;
+	m_generations[slot]++;
+}
+
+// Puts a node (that isn't under anything) at the front of its parent's children.
+void TransformHierarchy::Link(uint32_t node, uint32_t parent)
+{
+	m_parents[node] = parent;
+	m_prevSiblings[node] = NoNode;
+	m_nextSiblings[node] = NoNode;
+	if (parent == NoNode)
+		return;
+
+	uint32_t next = m_firstChildren[parent];
+	m_nextSiblings[node] = next;
+	if (next != NoNode)
+		m_prevSiblings[next] = node;
+	m_firstChildren[parent] = node;
+}
+
+// Takes a node out of its parent's children, leaving it a root.
+void TransformHierarchy::Unlink(uint32_t node)
+{
+	uint32_t prev = m_prevSiblings[node];
+	uint32_t next = m_nextSiblings[node];
+	if (prev != NoNode)
+		m_nextSiblings[prev] = next;
+	else if (m_parents[node] != NoNode)
+		m_firstChildren[m_parents[node]] = next;
+	if (next != NoNode)
+		m_prevSiblings[next] = prev;
+
+	m_parents[node] = NoNode;
+	m_prevSiblings[node] = NoNode;
+	m_nextSiblings[node] = NoNode;
+}
+
+void TransformHierarchy::MarkDirty(uint32_t slot)
+{
+	m_dirty[slot] = 1;
+	if (m_firstDirty == NoNode || slot < m_firstDirty)
+		m_firstDirty = slot;
+}
+
+// Re-sorts the nodes by depth (keeping their order within each depth, so
+// siblings made together stay together), dropping removed ones
+void TransformHierarchy::Sort()
+{
+	// Depth of every node, walking up to the nearest one that's known
+	std::vector<uint32_t> depths(m_parents.size(), NoNode);
+	std::vector<uint32_t> path;
+	uint32_t maxDepth = 0;
+	for (uint32_t node : m_handles) {
+		if (node == NoNode)
+			continue;
+
+		path.clear();
+		uint32_t above = node;
+		while (above != NoNode && depths[above] == NoNode) {
+			path.push_back(above);
+			above = m_parents[above];
+		}
+		uint32_t depth = (above == NoNode) ? 0 : depths[above] + 1;
+		for (size_t i = path.size(); i-- > 0; depth++)
+			depths[path[i]] = depth;
+		if (depth - 1 > maxDepth)
+			maxDepth = depth - 1;
+	}
+
+	// Counting sort of the slots by depth
+	std::vector<uint32_t> starts(maxDepth + 2, 0);
+	for (uint32_t node : m_handles) {
+		if (node != NoNode)
+			starts[depths[node] + 1]++;
+	}
+	for (uint32_t depth = 1; depth < starts.size(); depth++)
+		starts[depth] += starts[depth - 1];
+
+	std::vector<uint32_t> order(m_nodeCount);
+	for (uint32_t slot = 0; slot < m_handles.size(); slot++) {
+		uint32_t node = m_handles[slot];
+		if (node != NoNode)
+			order[starts[depths[node]]++] = slot;
+	}
+
+	Gather(m_handles, order);
+	Gather(m_locals, order);
+	Gather(m_worlds, order);
+	Gather(m_normals, order);
+	Gather(m_generations, order);
+	Gather(m_changed, order);
+	Gather(m_dirty, order);
+
+	// Roots SetLocalMatrices stamped with this update count too, for their children's sake
+	m_firstDirty = NoNode;
+	for (uint32_t slot = 0; slot < m_handles.size(); slot++) {
+		m_slots[m_handles[slot]] = slot;
+		if ((m_dirty[slot] || m_changed[slot] == m_update) && m_firstDirty == NoNode)
+			m_firstDirty = slot;
+	}
+	m_depths.resize(m_handles.size());
+	m_parentSlots.resize(m_handles.size());
+	for (uint32_t slot = 0; slot < m_handles.size(); slot++) {
+		uint32_t node = m_handles[slot];
+		m_depths[slot] = depths[node];
+		m_parentSlots[slot] = (m_parents[node] == NoNode) ? NoNode : m_slots[m_parents[node]];
+	}
+	m_orderDirty = false;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "AffineMatrix.h"
+
+// --------------------------------------------------------
+// Parent/child links between transforms, and the world
+// matrices they add up to
+//
+// - Nodes are handles; what they point at is kept in flat
+//   arrays sorted by depth, so every parent comes before its
+//   children and a whole update is one pass from the front.
+// - Changing a node's local matrix (or parent) only marks it
+//   dirty. Update then starts from the first dirty node and
+//   recomputes it and everything under it, and nothing else,
+//   a depth at a time (split across threads when a depth has
+//   enough nodes, since they don't depend on each other).
+// - Adding or removing nodes, or changing parents, re-sorts
+//   the arrays on the next Update (not adding leaves, which
+//   stay in order as long as they're no shallower than the
+//   last node).
+// --------------------------------------------------------
+class TransformHierarchy
+{
+public:
+	static const uint32_t NoNode = 0xFFFFFFFF;
+
+	// Depths with fewer nodes than this stay on the calling thread.
+	static const size_t DefaultParallelThreshold = 16384;
+
+	// A new node with an identity local matrix, under "parent" (or a root, if NoNode).
+	uint32_t Create(uint32_t parent = NoNode);
+
+	// Remove a node. Its children move up to its parent, keeping their local matrices.
+	// - Only touches its own children, however many nodes there are.
+	void Destroy(uint32_t node);
+
+	// Move a node (and everything under it) under another one, or make it a root with NoNode.
+	// - Its local matrix stays the same, so it moves with its new parent.
+	// - Returns false (and changes nothing) if "parent" is under "node".
+	bool SetParent(uint32_t node, uint32_t parent);
+	uint32_t GetParent(uint32_t node) const;
+
+	void SetLocalMatrix(uint32_t node, const AffineMatrix& local);
+
+	// SetLocalMatrix for many nodes at once: nodes[i] gets locals[i] wherever changed[i]
+	// is set (and changed[i] is cleared), split across threads like Update.
+	// - A root's world matrix is its local one, so roots get theirs here rather than
+	//   in Update, which is left with just what's under them.
+	void SetLocalMatrices(const uint32_t* nodes, const AffineMatrix* locals, uint8_t* changed, uint32_t count, unsigned int threadCount = 0);
+	const AffineMatrix& GetLocalMatrix(uint32_t node) const;
+
+	// As of the last Update.
+	const AffineMatrix& GetWorldMatrix(uint32_t node) const;
+
+	// The world matrix's normal matrix (see AffineMatrix::GetNormalMatrix), as of the last Update.
+	// - Only rebuilt when the rotation or scale part of the world matrix changes, so
+	//   moving something (or its parent) around doesn't touch it.
+	const AffineMatrix& GetNormalMatrix(uint32_t node) const;
+
+	// Goes up every time Update recomputes the node's world matrix (never 0).
+	uint64_t GetGeneration(uint32_t node) const;
+
+	// True if Update has anything to do.
+	bool IsDirty() const;
+
+	// Bring every dirty node's world matrix (and its descendants') up to date.
+	// - threadCount of 0 means one per hardware thread; 1 keeps it on this thread.
+	// - Returns how many were recomputed.
+	uint32_t Update(unsigned int threadCount = 0, size_t parallelThreshold = DefaultParallelThreshold);
+
+	uint32_t GetNodeCount() const;
+	uint32_t GetDepth(uint32_t node) const;		// 0 for roots (only right after an Update, if parents changed)
+
+private:
+	// By handle
+	std::vector<uint32_t> m_slots;				// Where each node is in the sorted arrays (NoNode if free)
+	std::vector<uint32_t> m_parents;			// Parent handles
+	std::vector<uint32_t> m_firstChildren;		// Children (in no particular order) as a linked list of handles
+	std::vector<uint32_t> m_nextSiblings;
+	std::vector<uint32_t> m_prevSiblings;
+	std::vector<uint32_t> m_freeHandles;
+
+	// By slot, sorted by depth
+	std::vector<uint32_t> m_handles;			// NoNode for removed nodes, until the next sort
+	std::vector<uint32_t> m_parentSlots;
+	std::vector<uint32_t> m_depths;
+	std::vector<AffineMatrix> m_locals;
+	std::vector<AffineMatrix> m_worlds;
+	std::vector<AffineMatrix> m_normals;
+	std::vector<uint64_t> m_generations;
+	std::vector<uint32_t> m_changed;			// The update that last recomputed it
+	std::vector<uint8_t> m_dirty;
+
+	uint32_t m_firstDirty = NoNode;				// Lowest dirty slot
+	uint32_t m_update = 0;
+	uint32_t m_nodeCount = 0;
+	bool m_orderDirty = false;
+
+	void Link(uint32_t node, uint32_t parent);
+	void Unlink(uint32_t node);
+	void MarkDirty(uint32_t slot);
+	void SetWorldMatrix(uint32_t slot, const AffineMatrix& world);
+	uint32_t UpdateSlots(uint32_t begin, uint32_t end);
+	void Sort();
+};
@@ -0,0 +1,388 @@
+#include "TransformSystem.h"
+#include "ParallelFor.h"
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Transforms per item handed to a thread (a multiple of 4).
+	const uint32_t BlockSize = 4096;
+
+	template<typename T>
+	void MoveLast(std::vector<T>& values, uint32_t index)
+	{
+		values[index] = values.back();
+		values.pop_back();
+	}
+}
+
+const uint32_t TransformSystem::NoTransform;	// Passed by reference, so it needs a definition
+
+
+uint32_t TransformSystem::Create()
+{
+	uint32_t transform;
+	if (!m_freeHandles.empty()) {
+		transform = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else {
+		transform = (uint32_t)m_indices.size();
+		m_indices.push_back(NoTransform);
+	}
+
+	// The hierarchy starts it off with identity matrices, which is what these make
+	m_indices[transform] = (uint32_t)m_handles.size();
+	m_handles.push_back(transform);
+	m_nodes.push_back(m_hierarchy.Create());
+	if (m_nodes.back() >= m_nodeHandles.size())
+		m_nodeHandles.resize(m_nodes.back() + 1);
+	m_nodeHandles[m_nodes.back()] = transform;
+	m_positionX.push_back(0.0f);
+	m_positionY.push_back(0.0f);
+	m_positionZ.push_back(0.0f);
+	m_orientationX.push_back(0.0f);
+	m_orientationY.push_back(0.0f);
+	m_orientationZ.push_back(0.0f);
+	m_orientationW.push_back(1.0f);
+	m_scaleX.push_back(1.0f);
+	m_scaleY.push_back(1.0f);
+	m_scaleZ.push_back(1.0f);
+	m_rightX.push_back(1.0f);
+	m_rightY.push_back(0.0f);
+	m_rightZ.push_back(0.0f);
+	m_upX.push_back(0.0f);
+	m_upY.push_back(1.0f);
+	m_upZ.push_back(0.0f);
+	m_forwardX.push_back(0.0f);
+	m_forwardY.push_back(0.0f);
+	m_forwardZ.push_back(1.0f);
+	m_pitch.push_back(0.0f);
+	m_yaw.push_back(0.0f);
+	m_roll.push_back(0.0f);
+	m_axesDirty.push_back(0);
+	m_locals.push_back(m_hierarchy.GetLocalMatrix(m_nodes.back()));
+	m_dirty.push_back(0);
+	return transform;
+}
+
+void TransformSystem::Destroy(uint32_t transform)
+{
+	uint32_t index = m_indices[transform];
+	if (m_dirty[index])
+		m_dirtyCount--;
+	m_hierarchy.Destroy(m_nodes[index]);
+
+	// The last one moves into the gap, so the arrays stay packed
+	m_indices[m_handles.back()] = index;
+	MoveLast(m_handles, index);
+	MoveLast(m_nodes, index);
+	MoveLast(m_positionX, index);
+	MoveLast(m_positionY, index);
+	MoveLast(m_positionZ, index);
+	MoveLast(m_orientationX, index);
+	MoveLast(m_orientationY, index);
+	MoveLast(m_orientationZ, index);
+	MoveLast(m_orientationW, index);
+	MoveLast(m_scaleX, index);
+	MoveLast(m_scaleY, index);
+	MoveLast(m_scaleZ, index);
+	MoveLast(m_rightX, index);
+	MoveLast(m_rightY, index);
+	MoveLast(m_rightZ, index);
+	MoveLast(m_upX, index);
+	MoveLast(m_upY, index);
+	MoveLast(m_upZ, index);
+	MoveLast(m_forwardX, index);
+	MoveLast(m_forwardY, index);
+	MoveLast(m_forwardZ, index);
+	MoveLast(m_pitch, index);
+	MoveLast(m_yaw, index);
+	MoveLast(m_roll, index);
+	MoveLast(m_axesDirty, index);
+	MoveLast(m_locals, index);
+	MoveLast(m_dirty, index);
+
+	m_indices[transform] = NoTransform;
+	m_freeHandles.push_back(transform);
+}
+
+XMFLOAT3 TransformSystem::GetPosition(uint32_t transform) const
+{
+	uint32_t i = m_indices[transform];
+	return XMFLOAT3(m_positionX[i], m_positionY[i], m_positionZ[i]);
+}
+
+XMFLOAT4 TransformSystem::GetOrientation(uint32_t transform) const
+{
+	uint32_t i = m_indices[transform];
+	return XMFLOAT4(m_orientationX[i], m_orientationY[i], m_orientationZ[i], m_orientationW[i]);
+}
+
+XMFLOAT3 TransformSystem::GetScale(uint32_t transform) const
+{
+	uint32_t i = m_indices[transform];
+	return XMFLOAT3(m_scaleX[i], m_scaleY[i], m_scaleZ[i]);
+}
+
+void TransformSystem::SetPosition(uint32_t transform, const XMFLOAT3& position)
+{
+	uint32_t i = m_indices[transform];
+	m_positionX[i] = position.x;
+	m_positionY[i] = position.y;
+	m_positionZ[i] = position.z;
+	MarkDirty(i);
+}
+
+void TransformSystem::SetOrientation(uint32_t transform, const XMFLOAT4& orientation)
+{
+	uint32_t i = m_indices[transform];
+	m_orientationX[i] = orientation.x;
+	m_orientationY[i] = orientation.y;
+	m_orientationZ[i] = orientation.z;
+	m_orientationW[i] = orientation.w;
+	m_axesDirty[i] = 1;
+	MarkDirty(i);
+}
+
+void TransformSystem::SetScale(uint32_t transform, const XMFLOAT3& scale)
+{
+	uint32_t i = m_indices[transform];
+	m_scaleX[i] = scale.x;
+	m_scaleY[i] = scale.y;
+	m_scaleZ[i] = scale.z;
+	MarkDirty(i);
+}
+
+XMFLOAT3 TransformSystem::GetRight(uint32_t transform)
+{
+	uint32_t i = m_indices[transform];
+	if (m_axesDirty[i])
+		UpdateAxes(i);
+	return XMFLOAT3(m_rightX[i], m_rightY[i], m_rightZ[i]);
+}
+
+XMFLOAT3 TransformSystem::GetUp(uint32_t transform)
+{
+	uint32_t i = m_indices[transform];
+	if (m_axesDirty[i])
+		UpdateAxes(i);
+	return XMFLOAT3(m_upX[i], m_upY[i], m_upZ[i]);
+}
+
+XMFLOAT3 TransformSystem::GetForward(uint32_t transform)
+{
+	uint32_t i = m_indices[transform];
+	if (m_axesDirty[i])
+		UpdateAxes(i);
+	return XMFLOAT3(m_forwardX[i], m_forwardY[i], m_forwardZ[i]);
+}
+
+XMFLOAT3 TransformSystem::GetRotation(uint32_t transform)
+{
+	uint32_t i = m_indices[transform];
+	if (m_axesDirty[i])
+		UpdateAxes(i);
+	return XMFLOAT3(m_pitch[i], m_yaw[i], m_roll[i]);
+}
+
+bool TransformSystem::SetParent(uint32_t transform, uint32_t parent)
+{
+	return m_hierarchy.SetParent(m_nodes[m_indices[transform]], parent == NoTransform ? TransformHierarchy::NoNode : m_nodes[m_indices[parent]]);
+}
+
+uint32_t TransformSystem::GetParent(uint32_t transform) const
+{
+	uint32_t parent = m_hierarchy.GetParent(m_nodes[m_indices[transform]]);
+	return parent == TransformHierarchy::NoNode ? NoTransform : m_nodeHandles[parent];
+}
+
+const AffineMatrix& TransformSystem::GetLocalMatrix(uint32_t transform) const { return m_hierarchy.GetLocalMatrix(m_nodes[m_indices[transform]]); }
+const AffineMatrix& TransformSystem::GetWorldMatrix(uint32_t transform) const { return m_hierarchy.GetWorldMatrix(m_nodes[m_indices[transform]]); }
+const AffineMatrix& TransformSystem::GetNormalMatrix(uint32_t transform) const { return m_hierarchy.GetNormalMatrix(m_nodes[m_indices[transform]]); }
+uint64_t TransformSystem::GetGeneration(uint32_t transform) const { return m_hierarchy.GetGeneration(m_nodes[m_indices[transform]]); }
+bool TransformSystem::IsDirty() const { return m_dirtyCount > 0 || m_hierarchy.IsDirty(); }
+uint32_t TransformSystem::GetCount() const { return (uint32_t)m_handles.size(); }
+
+uint32_t TransformSystem::Update(unsigned int threadCount, size_t parallelThreshold)
+{
+	uint32_t built = UpdateLocalMatrices(threadCount, parallelThreshold);
+	UpdateWorldMatrices(threadCount, parallelThreshold);
+	return built;
+}
+
+uint32_t TransformSystem::UpdateLocalMatrices(unsigned int threadCount, size_t parallelThreshold)
+{
+	uint32_t built = m_dirtyCount;
+	if (m_dirtyCount == 0)
+		return 0;
+
+	uint32_t count = (uint32_t)m_handles.size();
+	if (m_dirtyCount < parallelThreshold)
+		threadCount = 1;
+	if (threadCount == 1)
+		BuildLocalMatrices(0, count);
+	else {
+		ParallelFor((count + BlockSize - 1) / BlockSize, threadCount, [&](size_t block) {
+			uint32_t begin = (uint32_t)block * BlockSize;
+			BuildLocalMatrices(begin, begin + BlockSize < count ? begin + BlockSize : count);
+		});
+	}
+
+	// Clears the dirty flags as it goes
+	m_hierarchy.SetLocalMatrices(m_nodes.data(), m_locals.data(), m_dirty.data(), count, threadCount);
+	m_dirtyCount = 0;
+	return built;
+}
+
+uint32_t TransformSystem::UpdateWorldMatrices(unsigned int threadCount, size_t parallelThreshold)
+{
+	return m_hierarchy.Update(threadCount, parallelThreshold);
+}
+
+void TransformSystem::MarkDirty(uint32_t index)
+{
+	if (m_dirty[index])
+		return;
+	m_dirty[index] = 1;
+	m_dirtyCount++;
+}
+
+// The axes are the rows of the rotation matrix
+void TransformSystem::UpdateAxes(uint32_t index)
+{
+	XMFLOAT4X4 rotation;
+	XMStoreFloat4x4(&rotation, XMMatrixRotationQuaternion(XMVectorSet(m_orientationX[index], m_orientationY[index], m_orientationZ[index], m_orientationW[index])));
+	m_rightX[index] = rotation.m[0][0];
+	m_rightY[index] = rotation.m[0][1];
+	m_rightZ[index] = rotation.m[0][2];
+	m_upX[index] = rotation.m[1][0];
+	m_upY[index] = rotation.m[1][1];
+	m_upZ[index] = rotation.m[1][2];
+	m_forwardX[index] = rotation.m[2][0];
+	m_forwardY[index] = rotation.m[2][1];
+	m_forwardZ[index] = rotation.m[2][2];
+	UpdateAngles(index);
+}
+
+// From the axes, rotation = roll * pitch * yaw
+// - At straight up or down (pitch of +-90 degrees) yaw and roll turn around
+//   the same axis, so all of the turn is given to yaw.
+void TransformSystem::UpdateAngles(uint32_t index)
+{
+	// cos(pitch) from the rest of the row, since asin loses most of its precision near +-90 degrees
+	float sinPitch = -m_forwardY[index];
+	float cosPitch = sqrtf(m_forwardX[index] * m_forwardX[index] + m_forwardZ[index] * m_forwardZ[index]);
+	m_pitch[index] = atan2f(sinPitch, cosPitch);
+	if (cosPitch > 1e-6f) {
+		m_yaw[index] = atan2f(m_forwardX[index], m_forwardZ[index]);
+		m_roll[index] = atan2f(m_rightY[index], m_upY[index]);
+	}
+	else {
+		m_yaw[index] = atan2f(-m_rightZ[index], m_rightX[index]);
+		m_roll[index] = 0.0f;
+	}
+	m_axesDirty[index] = 0;
+}
+
+// Scale, then rotate, then translate, for [begin, end) four at a time
+// - Groups of four with none dirty are skipped. The ones that aren't dirty in a
+//   group that is come out the same as they were, so they're just rewritten.
+// - The matrices come out a component at a time across the four (structure of
+//   arrays), then each column is transposed into place as a row of an AffineMatrix.
+// - The unscaled rotation is the axes, so a group with any new orientation has them
+//   stored as they are (the angles are then only worked out for the ones that changed).
+void TransformSystem::BuildLocalMatrices(uint32_t begin, uint32_t end)
+{
+	const XMVECTOR one = XMVectorReplicate(1.0f);
+	const XMVECTOR two = XMVectorReplicate(2.0f);
+
+	uint32_t groupEnd = begin + (end - begin) / 4 * 4;
+	for (uint32_t i = begin; i < groupEnd; i += 4) {
+		uint32_t anyDirty;
+		memcpy(&anyDirty, &m_dirty[i], sizeof(anyDirty));
+		if (anyDirty == 0)
+			continue;
+
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)(m_orientationX.data() + i));
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)(m_orientationY.data() + i));
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)(m_orientationZ.data() + i));
+		XMVECTOR w = XMLoadFloat4((const XMFLOAT4*)(m_orientationW.data() + i));
+		XMVECTOR sx = XMLoadFloat4((const XMFLOAT4*)(m_scaleX.data() + i));
+		XMVECTOR sy = XMLoadFloat4((const XMFLOAT4*)(m_scaleY.data() + i));
+		XMVECTOR sz = XMLoadFloat4((const XMFLOAT4*)(m_scaleZ.data() + i));
+
+		// The same rotation XMMatrixRotationQuaternion makes
+		XMVECTOR x2 = XMVectorMultiply(x, two), y2 = XMVectorMultiply(y, two), z2 = XMVectorMultiply(z, two);
+		XMVECTOR xx = XMVectorMultiply(x, x2), yy = XMVectorMultiply(y, y2), zz = XMVectorMultiply(z, z2);
+		XMVECTOR xy = XMVectorMultiply(x, y2), xz = XMVectorMultiply(x, z2), yz = XMVectorMultiply(y, z2);
+		XMVECTOR wx = XMVectorMultiply(w, x2), wy = XMVectorMultiply(w, y2), wz = XMVectorMultiply(w, z2);
+
+		// Each element of the rotation (rIJ is row I, column J), across the four
+		XMVECTOR r00 = XMVectorSubtract(one, XMVectorAdd(yy, zz));
+		XMVECTOR r01 = XMVectorAdd(xy, wz);
+		XMVECTOR r02 = XMVectorSubtract(xz, wy);
+		XMVECTOR r10 = XMVectorSubtract(xy, wz);
+		XMVECTOR r11 = XMVectorSubtract(one, XMVectorAdd(xx, zz));
+		XMVECTOR r12 = XMVectorAdd(yz, wx);
+		XMVECTOR r20 = XMVectorAdd(xz, wy);
+		XMVECTOR r21 = XMVectorSubtract(yz, wx);
+		XMVECTOR r22 = XMVectorSubtract(one, XMVectorAdd(xx, yy));
+
+		uint32_t anyAxesDirty;
+		memcpy(&anyAxesDirty, &m_axesDirty[i], sizeof(anyAxesDirty));
+		if (anyAxesDirty != 0) {
+			XMStoreFloat4((XMFLOAT4*)(m_rightX.data() + i), r00);
+			XMStoreFloat4((XMFLOAT4*)(m_rightY.data() + i), r01);
+			XMStoreFloat4((XMFLOAT4*)(m_rightZ.data() + i), r02);
+			XMStoreFloat4((XMFLOAT4*)(m_upX.data() + i), r10);
+			XMStoreFloat4((XMFLOAT4*)(m_upY.data() + i), r11);
+			XMStoreFloat4((XMFLOAT4*)(m_upZ.data() + i), r12);
+			XMStoreFloat4((XMFLOAT4*)(m_forwardX.data() + i), r20);
+			XMStoreFloat4((XMFLOAT4*)(m_forwardY.data() + i), r21);
+			XMStoreFloat4((XMFLOAT4*)(m_forwardZ.data() + i), r22);
+			for (uint32_t t = 0; t < 4; t++) {
+				if (m_axesDirty[i + t])
+					UpdateAngles(i + t);
+			}
+		}
+
+		// Scaled
+		r00 = XMVectorMultiply(r00, sx);
+		r01 = XMVectorMultiply(r01, sx);
+		r02 = XMVectorMultiply(r02, sx);
+		r10 = XMVectorMultiply(r10, sy);
+		r11 = XMVectorMultiply(r11, sy);
+		r12 = XMVectorMultiply(r12, sy);
+		r20 = XMVectorMultiply(r20, sz);
+		r21 = XMVectorMultiply(r21, sz);
+		r22 = XMVectorMultiply(r22, sz);
+		// Then the first three columns with the translation under them (the last, 0, 0, 0, 1, isn't stored)
+		XMMATRIX columns[3] = {
+			XMMATRIX(r00, r10, r20, XMLoadFloat4((const XMFLOAT4*)(m_positionX.data() + i))),
+			XMMATRIX(r01, r11, r21, XMLoadFloat4((const XMFLOAT4*)(m_positionY.data() + i))),
+			XMMATRIX(r02, r12, r22, XMLoadFloat4((const XMFLOAT4*)(m_positionZ.data() + i))),
+		};
+
+		for (int column = 0; column < 3; column++) {
+			XMMATRIX transposed = XMMatrixTranspose(columns[column]);
+			for (int t = 0; t < 4; t++)
+				XMStoreFloat4(&m_locals[i + t].rows[column], transposed.r[t]);
+		}
+	}
+
+	// One at a time, for what's left past the last group of four
+	for (uint32_t i = groupEnd; i < end; i++) {
+		if (!m_dirty[i])
+			continue;
+		if (m_axesDirty[i])
+			UpdateAxes(i);
+		m_locals[i] = AffineMatrix::Store(XMMatrixMultiply(
+			XMMatrixMultiply(
+				XMMatrixScaling(m_scaleX[i], m_scaleY[i], m_scaleZ[i]),
+				XMMatrixRotationQuaternion(XMVectorSet(m_orientationX[i], m_orientationY[i], m_orientationZ[i], m_orientationW[i]))),
+			XMMatrixTranslation(m_positionX[i], m_positionY[i], m_positionZ[i])));
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "TransformHierarchy.h"
+
+// --------------------------------------------------------
+// Position, orientation and scale of every transform, kept
+// together in flat arrays (one per component), and the
+// matrices they make
+//
+// - Transforms are handles that stay the same for as long as
+//   they live; what they point at is packed, so removing one
+//   moves the last into its place.
+// - Setting anything only marks the transform dirty. Update
+//   then builds the local matrices of the dirty ones four at
+//   a time (each component of four transforms loads as one
+//   register), split across threads when there are enough,
+//   and passes them to a TransformHierarchy for the world
+//   matrices (also split across threads, a depth at a time).
+// - The rotation's axes (right, up, forward) and Euler angles
+//   are kept too, in arrays of their own. They're worked out
+//   with the local matrices of the ones whose orientation
+//   changed, or when asked for before that.
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	static const uint32_t NoTransform = 0xFFFFFFFF;
+
+	// Fewer dirty transforms than this stay on the calling thread.
+	static const size_t DefaultParallelThreshold = 16384;
+
+	// A new transform at the origin, unrotated and unscaled, with no parent.
+	uint32_t Create();
+
+	// Remove a transform. Its children move up to its parent.
+	void Destroy(uint32_t transform);
+
+	DirectX::XMFLOAT3 GetPosition(uint32_t transform) const;
+	DirectX::XMFLOAT4 GetOrientation(uint32_t transform) const;	// Unit quaternion
+	DirectX::XMFLOAT3 GetScale(uint32_t transform) const;
+	void SetPosition(uint32_t transform, const DirectX::XMFLOAT3& position);
+	void SetOrientation(uint32_t transform, const DirectX::XMFLOAT4& orientation);	// Already normalized
+	void SetScale(uint32_t transform, const DirectX::XMFLOAT3& scale);
+
+	// Worked out from the orientation once per change (here, if Update hasn't yet).
+	DirectX::XMFLOAT3 GetRight(uint32_t transform);
+	DirectX::XMFLOAT3 GetUp(uint32_t transform);
+	DirectX::XMFLOAT3 GetForward(uint32_t transform);
+	DirectX::XMFLOAT3 GetRotation(uint32_t transform);	// Euler angles (pitch, yaw, roll)
+
+	// See TransformHierarchy::SetParent (NoTransform for none).
+	bool SetParent(uint32_t transform, uint32_t parent);
+	uint32_t GetParent(uint32_t transform) const;
+
+	// As of the last Update.
+	const AffineMatrix& GetLocalMatrix(uint32_t transform) const;
+	const AffineMatrix& GetWorldMatrix(uint32_t transform) const;
+	const AffineMatrix& GetNormalMatrix(uint32_t transform) const;	// See TransformHierarchy::GetNormalMatrix
+	uint64_t GetGeneration(uint32_t transform) const;	// See TransformHierarchy::GetGeneration
+
+	// True if Update has anything to do.
+	bool IsDirty() const;
+
+	// Build the local matrix of every transform that changed, then update the world matrices
+	// of those and everything under them.
+	// - threadCount of 0 means one per hardware thread; 1 keeps it on this thread.
+	// - Returns how many local matrices were built.
+	uint32_t Update(unsigned int threadCount = 0, size_t parallelThreshold = DefaultParallelThreshold);
+
+	// The two halves of Update, for timing them on their own.
+	// - Transforms without a parent get their world matrix with their local one.
+	// - UpdateWorldMatrices returns how many world matrices it recomputed.
+	uint32_t UpdateLocalMatrices(unsigned int threadCount = 0, size_t parallelThreshold = DefaultParallelThreshold);
+	uint32_t UpdateWorldMatrices(unsigned int threadCount = 0, size_t parallelThreshold = DefaultParallelThreshold);
+
+	uint32_t GetCount() const;
+
+private:
+	// By handle
+	std::vector<uint32_t> m_indices;	// Where each transform is in the packed arrays (NoTransform if free)
+	std::vector<uint32_t> m_freeHandles;
+	std::vector<uint32_t> m_nodeHandles;	// The transform each hierarchy node belongs to
+
+	// Packed
+	std::vector<uint32_t> m_handles;
+	std::vector<uint32_t> m_nodes;		// In m_hierarchy
+	std::vector<float> m_positionX, m_positionY, m_positionZ;
+	std::vector<float> m_orientationX, m_orientationY, m_orientationZ, m_orientationW;
+	std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+	std::vector<float> m_rightX, m_rightY, m_rightZ;
+	std::vector<float> m_upX, m_upY, m_upZ;
+	std::vector<float> m_forwardX, m_forwardY, m_forwardZ;
+	std::vector<float> m_pitch, m_yaw, m_roll;
+	std::vector<uint8_t> m_axesDirty;	// The orientation changed since the axes and angles were worked out
+	std::vector<AffineMatrix> m_locals;
+	std::vector<uint8_t> m_dirty;
+
+	uint32_t m_dirtyCount = 0;
+	TransformHierarchy m_hierarchy;
+
+	void MarkDirty(uint32_t index);
+	void UpdateAxes(uint32_t index);
+	void UpdateAngles(uint32_t index);
+	void BuildLocalMatrices(uint32_t begin, uint32_t end);
+};
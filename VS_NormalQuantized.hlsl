@@ -0,0 +1,19 @@
+#define NORMAL_MAP_VERTEX_SHADER
+#include "ShaderIncludes.hlsli"
+
+
+// --------------------------------------------------------
+// The entry point (main method) for our vertex shader
+// - Same as VS_Normal, for meshes with QuantizedVertex data
+// 
+// - Input is exactly one vertex worth of data (defined by a struct)
+// - Output is a single struct of data to pass down the pipeline
+// - Named "main" because that's the default the shader compiler looks for
+// - The constant buffer and the rest of the work are in ShaderIncludes
+//   (see TransformVertex), shared with the other vertex formats
+// --------------------------------------------------------
+VertexToPixelNormalMap main(VertexShaderInputQuantized packed)
+{
+	// Unpack the vertex (see VertexPacker)
+	return TransformVertex(UnpackVertex(packed, positionMin, positionScale));
+}
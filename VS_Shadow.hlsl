@@ -5,9 +5,7 @@
 // Constant buffer for matrix information (from the light)
 cbuffer ExternalData : register(b0)
 {
-	matrix worldMatrix;	// The world matrix of the ENTITY
-	matrix viewMatrix;	// The view matrix of the LIGHT
-	matrix projMatrix;	// The projection matrix of the LIGHT
+	matrix worldViewProj;	// The world matrix of the ENTITY, then the view and projection of the LIGHT (see WorldViewProjBatch)
 }
 
 // This output gets used directly, no pixel shader involved.
@@ -23,7 +21,7 @@ struct VertexShadowOutput
 // - Output is a single struct of data to pass down the pipeline
 // - Named "main" because that's the default the shader compiler looks for
 // --------------------------------------------------------
-VertexShadowOutput main(VertexShaderInput input)
+VertexShadowOutput main(VertexShaderInputPosition input)
 {
 	// Set up output struct
 	VertexShadowOutput output;
@@ -36,8 +34,7 @@ VertexShadowOutput main(VertexShaderInput input)
 	// - Each of these components is then automatically divided by the W component, 
 	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
 	//   a perspective projection matrix, which we'll get to in future assignments).
-	matrix wvp = mul(projMatrix, mul(viewMatrix, worldMatrix));
-	output.position = mul(wvp, float4(input.position, 1.0f));
+	output.position = mul(worldViewProj, float4(input.position, 1.0f));
 
 	// Nothing else is needed for the shadows.
 	//// Calculate the world position of the vertex.
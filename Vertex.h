@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <cstdint>
 
 // --------------------------------------------------------
 // A custom vertex definition
@@ -13,4 +14,38 @@ struct Vertex
 	DirectX::XMFLOAT3 Normal;       // The normal of the vertex
 	DirectX::XMFLOAT2 UV;
 	DirectX::XMFLOAT3 Tangent;		// The tangent to the UV.
-};
\ No newline at end of file
+};
+
+// --------------------------------------------------------
+// Smaller versions of Vertex for the GPU (see VertexPacker)
+//
+// - Same members in the same order, so the shader input
+//   structs in ShaderIncludes.hlsli can mirror them.
+// - Normals and tangents are octahedral encoded into two
+//   16 bit snorms, UVs are two halfs.
+// --------------------------------------------------------
+struct PackedVertex
+{
+	DirectX::XMFLOAT3 Position;
+	uint32_t Normal;
+	uint32_t UV;
+	uint32_t Tangent;
+};
+
+// Like PackedVertex, but with the position as 16 bit unorms
+// across the bounds of the mesh (the 4th one is unused).
+struct QuantizedVertex
+{
+	uint16_t Position[4];
+	uint32_t Normal;
+	uint32_t UV;
+	uint32_t Tangent;
+};
+
+// Which of the above a vertex buffer holds.
+enum VertexFormat
+{
+	VertexFormat_Full,			// Vertex (44 bytes)
+	VertexFormat_Packed,		// PackedVertex (24 bytes)
+	VertexFormat_Quantized,		// QuantizedVertex (20 bytes)
+};
@@ -0,0 +1,221 @@
+#include "VertexPacker.h"
+#include <DirectXPackedVector.h>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	const float Snorm16Max = 32767.0f;
+	const float Unorm16Max = 65535.0f;
+	const float RadiansToDegrees = 57.2957795f;
+
+	inline float SignNotZero(float f) { return (f >= 0.0f) ? 1.0f : -1.0f; }
+
+	inline float Clamp(float f, float low, float high) { return (f < low) ? low : (f > high) ? high : f; }
+
+	// Two 16 bit snorms, x in the low half.
+	inline uint32_t PackSnorm16x2(int x, int y) { return (uint32_t)(uint16_t)(int16_t)x | ((uint32_t)(uint16_t)(int16_t)y << 16); }
+
+	inline float UnpackSnorm16(uint16_t bits)
+	{
+		float f = (float)(int16_t)bits / Snorm16Max;
+		return (f < -1.0f) ? -1.0f : f;
+	}
+
+	// Unfolds a direction (with |x| + |y| + |z| == 1) onto the octahedron square.
+	inline void ToOctahedron(float x, float y, float z, float* u, float* v)
+	{
+		if (z < 0.0f) {
+			float folded = (1.0f - fabsf(y)) * SignNotZero(x);
+			y = (1.0f - fabsf(x)) * SignNotZero(y);
+			x = folded;
+		}
+		*u = x;
+		*v = y;
+	}
+
+	// Angle between two (unit) directions, in degrees.
+	inline float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		float dot = Clamp(a.x * b.x + a.y * b.y + a.z * b.z, -1.0f, 1.0f);
+		return acosf(dot) * RadiansToDegrees;
+	}
+
+	inline XMFLOAT3 Normalized(const XMFLOAT3& v)
+	{
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVector3Normalize(XMLoadFloat3(&v)));
+		return result;
+	}
+
+	// Packs everything but the position, and adds to the error.
+	template<typename PackedType>
+	void PackAttributes(const Vertex& in, PackedType& out, VertexPackError& error)
+	{
+		out.Normal = VertexPacker::EncodeOctahedral(in.Normal);
+		out.UV = VertexPacker::EncodeHalf2(in.UV);
+		out.Tangent = VertexPacker::EncodeOctahedral(in.Tangent);
+
+		// Directions that can't be normalized (zero normals, etc) don't count
+		XMFLOAT3 normal = Normalized(in.Normal);
+		XMFLOAT3 tangent = Normalized(in.Tangent);
+		if (normal.x == normal.x && (normal.x != 0.0f || normal.y != 0.0f || normal.z != 0.0f))
+			error.normalDegrees = fmaxf(error.normalDegrees, AngleDegrees(normal, VertexPacker::DecodeOctahedral(out.Normal)));
+		if (tangent.x == tangent.x && (tangent.x != 0.0f || tangent.y != 0.0f || tangent.z != 0.0f))
+			error.tangentDegrees = fmaxf(error.tangentDegrees, AngleDegrees(tangent, VertexPacker::DecodeOctahedral(out.Tangent)));
+
+		XMFLOAT2 uv = VertexPacker::DecodeHalf2(out.UV);
+		error.uv = fmaxf(error.uv, fmaxf(fabsf(uv.x - in.UV.x), fabsf(uv.y - in.UV.y)));
+	}
+}
+
+
+unsigned int VertexPacker::GetStride(VertexFormat format)
+{
+	switch (format) {
+	case VertexFormat_Packed: return sizeof(PackedVertex);
+	case VertexFormat_Quantized: return sizeof(QuantizedVertex);
+	default: return sizeof(Vertex);
+	}
+}
+
+void VertexPacker::Pack(const Vertex* vertices, size_t count, std::vector<PackedVertex>& out, VertexPackError* error)
+{
+	VertexPackError result;
+	out.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		out[i].Position = vertices[i].Position;
+		PackAttributes(vertices[i], out[i], result);
+	}
+
+	if (error != nullptr) *error = result;
+}
+
+void VertexPacker::Quantize(const Vertex* vertices, size_t count, std::vector<QuantizedVertex>& out, PositionQuantization* quantization, VertexPackError* error)
+{
+	// Bounds of the positions
+	XMVECTOR boundsMin = XMVectorReplicate(count == 0 ? 0.0f : FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(count == 0 ? 0.0f : -FLT_MAX);
+	for (size_t i = 0; i < count; i++) {
+		XMVECTOR pos = XMLoadFloat3(&vertices[i].Position);
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+
+	// One step of each axis (flat axes all quantize to zero)
+	XMFLOAT3 min, extent;
+	XMStoreFloat3(&min, boundsMin);
+	XMStoreFloat3(&extent, XMVectorSubtract(boundsMax, boundsMin));
+	PositionQuantization result;
+	result.min = min;
+	result.scale = XMFLOAT3(extent.x / Unorm16Max, extent.y / Unorm16Max, extent.z / Unorm16Max);
+	const float* minAxes = &result.min.x;
+	const float* scaleAxes = &result.scale.x;
+
+	VertexPackError packError;
+	out.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		const float* position = &vertices[i].Position.x;
+		float unpacked[3];
+		for (int axis = 0; axis < 3; axis++) {
+			float steps = (scaleAxes[axis] > 0.0f) ? (position[axis] - minAxes[axis]) / scaleAxes[axis] : 0.0f;
+			out[i].Position[axis] = (uint16_t)Clamp(floorf(steps + 0.5f), 0.0f, Unorm16Max);
+			unpacked[axis] = minAxes[axis] + out[i].Position[axis] * scaleAxes[axis];
+		}
+		out[i].Position[3] = 0;
+
+		float dx = unpacked[0] - position[0];
+		float dy = unpacked[1] - position[1];
+		float dz = unpacked[2] - position[2];
+		packError.position = fmaxf(packError.position, sqrtf(dx * dx + dy * dy + dz * dz));
+
+		PackAttributes(vertices[i], out[i], packError);
+	}
+
+	if (quantization != nullptr) *quantization = result;
+	if (error != nullptr) *error = packError;
+}
+
+void VertexPacker::PackAs(VertexFormat format, const Vertex* vertices, size_t count, std::vector<unsigned char>& out, PositionQuantization* quantization, VertexPackError* error)
+{
+	if (format == VertexFormat_Packed) {
+		std::vector<PackedVertex> packed;
+		Pack(vertices, count, packed, error);
+		out.resize(packed.size() * sizeof(PackedVertex));
+		if (!packed.empty()) memcpy(&out[0], packed.data(), out.size());
+	}
+	else if (format == VertexFormat_Quantized) {
+		std::vector<QuantizedVertex> quantized;
+		Quantize(vertices, count, quantized, quantization, error);
+		out.resize(quantized.size() * sizeof(QuantizedVertex));
+		if (!quantized.empty()) memcpy(&out[0], quantized.data(), out.size());
+	}
+	else {
+		out.resize(count * sizeof(Vertex));
+		if (count > 0) memcpy(&out[0], vertices, out.size());
+		if (error != nullptr) *error = VertexPackError();
+	}
+}
+
+// Octahedral encoding of a direction into two 16 bit snorms
+// - See "A Survey of Efficient Representations for Independent Unit Vectors"
+//   (Cigolle et al. 2014).  Rounding each axis separately isn't always the
+//   closest code, so all 4 neighbours are decoded and the best one is kept.
+uint32_t VertexPacker::EncodeOctahedral(const XMFLOAT3& direction)
+{
+	float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if (!(length > 0.0f) || length > FLT_MAX)
+		return PackSnorm16x2(0, 0);
+
+	float u, v;
+	ToOctahedron(direction.x / length, direction.y / length, direction.z / length, &u, &v);
+	u = Clamp(u, -1.0f, 1.0f) * Snorm16Max;
+	v = Clamp(v, -1.0f, 1.0f) * Snorm16Max;
+
+	XMFLOAT3 target = Normalized(direction);
+	uint32_t best = 0;
+	float bestDot = -2.0f;
+	for (int candidate = 0; candidate < 4; candidate++) {
+		int x = (int)((candidate & 1) ? ceilf(u) : floorf(u));
+		int y = (int)((candidate & 2) ? ceilf(v) : floorf(v));
+		uint32_t packed = PackSnorm16x2(x, y);
+
+		XMFLOAT3 decoded = DecodeOctahedral(packed);
+		float dot = decoded.x * target.x + decoded.y * target.y + decoded.z * target.z;
+		if (dot > bestDot) {
+			bestDot = dot;
+			best = packed;
+		}
+	}
+	return best;
+}
+
+XMFLOAT3 VertexPacker::DecodeOctahedral(uint32_t packed)
+{
+	float x = UnpackSnorm16((uint16_t)(packed & 0xFFFF));
+	float y = UnpackSnorm16((uint16_t)(packed >> 16));
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower half of the octahedron
+	float t = Clamp(-z, 0.0f, 1.0f);
+	x += (x >= 0.0f) ? -t : t;
+	y += (y >= 0.0f) ? -t : t;
+
+	return Normalized(XMFLOAT3(x, y, z));
+}
+
+uint32_t VertexPacker::EncodeHalf2(const XMFLOAT2& value)
+{
+	return (uint32_t)XMConvertFloatToHalf(value.x) | ((uint32_t)XMConvertFloatToHalf(value.y) << 16);
+}
+
+XMFLOAT2 VertexPacker::DecodeHalf2(uint32_t packed)
+{
+	return XMFLOAT2(
+		XMConvertHalfToFloat((HALF)(packed & 0xFFFF)),
+		XMConvertHalfToFloat((HALF)(packed >> 16)));
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// Dequantization of QuantizedVertex positions: position = min + quantized * scale.
+struct PositionQuantization
+{
+	DirectX::XMFLOAT3 min = DirectX::XMFLOAT3(0, 0, 0);
+	DirectX::XMFLOAT3 scale = DirectX::XMFLOAT3(0, 0, 0);
+};
+
+// The largest error packing introduced, measured by unpacking every vertex again.
+struct VertexPackError
+{
+	float normalDegrees = 0.0f;		// Angle between the original and unpacked normal
+	float tangentDegrees = 0.0f;	// Same for the tangent
+	float position = 0.0f;			// Distance between the original and unpacked position
+	float uv = 0.0f;				// Largest difference in either uv coordinate
+};
+
+// --------------------------------------------------------
+// Converts Vertex data into the smaller GPU formats
+//
+// - Normals and tangents are octahedral encoded: the unit
+//   vector is projected onto an octahedron, which is unfolded
+//   into a square and stored as two 16 bit snorms.  Each code
+//   is picked from its 4 nearest candidates to be as close as
+//   possible once decoded.
+// - UVs become halfs and, for QuantizedVertex, positions become
+//   16 bit unorms across the mesh bounds.
+// - The decoders are the CPU versions of the ones in
+//   ShaderIncludes.hlsli and must give the same results.
+// --------------------------------------------------------
+class VertexPacker
+{
+public:
+	// Size of a vertex in each format.
+	static unsigned int GetStride(VertexFormat format);
+
+	// Pack vertices into PackedVertex (24 bytes) or QuantizedVertex (20 bytes).
+	static void Pack(const Vertex* vertices, size_t count, std::vector<PackedVertex>& out, VertexPackError* error = nullptr);
+	static void Quantize(const Vertex* vertices, size_t count, std::vector<QuantizedVertex>& out, PositionQuantization* quantization, VertexPackError* error = nullptr);
+
+	// Pack vertices into either format (as raw bytes), for uploading.
+	static void PackAs(VertexFormat format, const Vertex* vertices, size_t count, std::vector<unsigned char>& out, PositionQuantization* quantization, VertexPackError* error = nullptr);
+
+	// The individual encodings.
+	static uint32_t EncodeOctahedral(const DirectX::XMFLOAT3& direction);
+	static DirectX::XMFLOAT3 DecodeOctahedral(uint32_t packed);
+	static uint32_t EncodeHalf2(const DirectX::XMFLOAT2& value);
+	static DirectX::XMFLOAT2 DecodeHalf2(uint32_t packed);
+};
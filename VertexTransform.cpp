@@ -0,0 +1,122 @@
+#include "VertexTransform.h"
+#include "ParallelFor.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Vertices per item handed to a thread (a multiple of 4).
+	const size_t BlockSize = 4096;
+
+	// One vertex at a time, for what's left past the last group of four.
+	void TransformTail(const VertexStream& in, const XMFLOAT4X4& m, float w, bool normalize, VertexStreamTarget out, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++) {
+			float x = in.x[i], y = in.y[i], z = in.z[i];
+			float tx = x * m.m[0][0] + y * m.m[1][0] + z * m.m[2][0] + w * m.m[3][0];
+			float ty = x * m.m[0][1] + y * m.m[1][1] + z * m.m[2][1] + w * m.m[3][1];
+			float tz = x * m.m[0][2] + y * m.m[1][2] + z * m.m[2][2] + w * m.m[3][2];
+			if (normalize) {
+				float lengthSq = tx * tx + ty * ty + tz * tz;
+				float scale = (lengthSq > 0.0f) ? 1.0f / sqrtf(lengthSq) : 0.0f;
+				tx *= scale; ty *= scale; tz *= scale;
+			}
+			out.x[i] = tx;
+			out.y[i] = ty;
+			out.z[i] = tz;
+		}
+	}
+
+	// Transforms [begin, end) four vertices at a time.
+	// - Points get the translation, directions don't (and are renormalized).
+	void TransformRange(const VertexStream& in, const XMFLOAT4X4& matrix, bool isPoint, VertexStreamTarget out, size_t begin, size_t end)
+	{
+		// Each matrix element across a whole register
+		XMVECTOR m[4][3];
+		for (int row = 0; row < 4; row++) {
+			for (int column = 0; column < 3; column++)
+				m[row][column] = XMVectorReplicate(matrix.m[row][column]);
+		}
+		if (!isPoint) {
+			for (int column = 0; column < 3; column++)
+				m[3][column] = XMVectorZero();
+		}
+
+		const float* inX = in.x.data();
+		const float* inY = in.y.data();
+		const float* inZ = in.z.data();
+		size_t groupEnd = begin + (end - begin) / 4 * 4;
+		for (size_t i = begin; i < groupEnd; i += 4) {
+			XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)(inX + i));
+			XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)(inY + i));
+			XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)(inZ + i));
+
+			XMVECTOR tx = XMVectorMultiplyAdd(z, m[2][0], XMVectorMultiplyAdd(y, m[1][0], XMVectorMultiplyAdd(x, m[0][0], m[3][0])));
+			XMVECTOR ty = XMVectorMultiplyAdd(z, m[2][1], XMVectorMultiplyAdd(y, m[1][1], XMVectorMultiplyAdd(x, m[0][1], m[3][1])));
+			XMVECTOR tz = XMVectorMultiplyAdd(z, m[2][2], XMVectorMultiplyAdd(y, m[1][2], XMVectorMultiplyAdd(x, m[0][2], m[3][2])));
+
+			if (!isPoint) {
+				XMVECTOR lengthSq = XMVectorMultiplyAdd(tz, tz, XMVectorMultiplyAdd(ty, ty, XMVectorMultiply(tx, tx)));
+				XMVECTOR scale = XMVectorReciprocalSqrt(XMVectorMax(lengthSq, XMVectorReplicate(1e-30f)));
+				tx = XMVectorMultiply(tx, scale);
+				ty = XMVectorMultiply(ty, scale);
+				tz = XMVectorMultiply(tz, scale);
+			}
+
+			XMStoreFloat4((XMFLOAT4*)(out.x + i), tx);
+			XMStoreFloat4((XMFLOAT4*)(out.y + i), ty);
+			XMStoreFloat4((XMFLOAT4*)(out.z + i), tz);
+		}
+		TransformTail(in, matrix, isPoint ? 1.0f : 0.0f, !isPoint, out, groupEnd, end);
+	}
+
+	void Transform(const VertexStream& in, const XMFLOAT4X4& matrix, bool isPoint, VertexStreamTarget out, unsigned int threadCount, size_t parallelThreshold)
+	{
+		size_t count = in.GetCount();
+		if (count < parallelThreshold || threadCount == 1) {
+			TransformRange(in, matrix, isPoint, out, 0, count);
+			return;
+		}
+
+		ParallelFor((count + BlockSize - 1) / BlockSize, threadCount, [&](size_t block) {
+			size_t begin = block * BlockSize;
+			TransformRange(in, matrix, isPoint, out, begin, begin + BlockSize < count ? begin + BlockSize : count);
+		});
+	}
+}
+
+
+void VertexTransform::BuildStreams(const Vertex* vertices, size_t count, VertexStream* positions, VertexStream* normals)
+{
+	if (positions) {
+		positions->x.resize(count);
+		positions->y.resize(count);
+		positions->z.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			positions->x[i] = vertices[i].Position.x;
+			positions->y[i] = vertices[i].Position.y;
+			positions->z[i] = vertices[i].Position.z;
+		}
+	}
+	if (normals) {
+		normals->x.resize(count);
+		normals->y.resize(count);
+		normals->z.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			normals->x[i] = vertices[i].Normal.x;
+			normals->y[i] = vertices[i].Normal.y;
+			normals->z[i] = vertices[i].Normal.z;
+		}
+	}
+}
+
+void VertexTransform::TransformPositions(const VertexStream& positions, const XMFLOAT4X4& matrix, VertexStreamTarget out, unsigned int threadCount, size_t parallelThreshold)
+{
+	Transform(positions, matrix, true, out, threadCount, parallelThreshold);
+}
+
+void VertexTransform::TransformNormals(const VertexStream& normals, const XMFLOAT4X4& matrix, VertexStreamTarget out, unsigned int threadCount, size_t parallelThreshold)
+{
+	Transform(normals, matrix, false, out, threadCount, parallelThreshold);
+}
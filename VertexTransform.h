@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+
+// x, y and z of a set of vertices in three separate arrays (structure of
+// arrays), so four vertices' worth of one component load as one register.
+struct VertexStream
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+
+	size_t GetCount() const { return x.size(); }
+};
+
+// Where transformed vertices go: caller owned arrays, at least count long.
+struct VertexStreamTarget
+{
+	float* x;
+	float* y;
+	float* z;
+};
+
+// --------------------------------------------------------
+// Transforms whole streams of positions or normals at once
+//
+// - Works on four vertices at a time: the matrix is splatted
+//   into registers once, then each output component is three
+//   multiply-adds across four vertices, with nothing to
+//   shuffle (unlike transforming one XMFLOAT3 at a time).
+// - Nothing is allocated and nothing is shared, so any number
+//   of threads can transform the same stream at once.
+// - Big streams are split into blocks across threads.
+// --------------------------------------------------------
+class VertexTransform
+{
+public:
+	// Streams shorter than this stay on the calling thread.
+	static const size_t DefaultParallelThreshold = 32768;
+
+	// Split the positions (and normals) of some vertices into streams.
+	static void BuildStreams(const Vertex* vertices, size_t count, VertexStream* positions, VertexStream* normals = nullptr);
+
+	// Transform positions (as points, with translation) into "out".
+	// - threadCount of 0 means one per hardware thread; 1 keeps it on this thread.
+	static void TransformPositions(const VertexStream& positions, const DirectX::XMFLOAT4X4& matrix, VertexStreamTarget out,
+		unsigned int threadCount = 0, size_t parallelThreshold = DefaultParallelThreshold);
+
+	// Transform normals (as directions, without translation) into "out", renormalized.
+	// - Pass the inverse transpose of the world matrix if it scales unevenly.
+	static void TransformNormals(const VertexStream& normals, const DirectX::XMFLOAT4X4& matrix, VertexStreamTarget out,
+		unsigned int threadCount = 0, size_t parallelThreshold = DefaultParallelThreshold);
+};
@@ -0,0 +1,62 @@
+#include "WorldViewProjBatch.h"
+
+using namespace DirectX;
+
+void WorldViewProjBatch::Clear()
+{
+	m_viewProjs.clear();
+	m_worlds.clear();
+}
+
+uint32_t WorldViewProjBatch::AddView(const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+{
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&proj)));
+	m_viewProjs.push_back(viewProj);
+	return (uint32_t)m_viewProjs.size() - 1;
+}
+
+uint32_t WorldViewProjBatch::AddWorld(const AffineMatrix& world)
+{
+	m_worlds.push_back(world);
+	return (uint32_t)m_worlds.size() - 1;
+}
+
+// A view at a time, so its view * projection stays in registers while the world matrices go past
+// - Row r of world * viewProj is viewProj's first three rows weighted by row r of the world
+//   matrix (which is element r of each stored row), plus its last row for the translation.
+void WorldViewProjBatch::Compute()
+{
+	uint32_t worldCount = (uint32_t)m_worlds.size();
+	m_results.resize(m_viewProjs.size() * worldCount);
+
+	for (size_t view = 0; view < m_viewProjs.size(); view++) {
+		XMMATRIX viewProj = XMLoadFloat4x4(&m_viewProjs[view]);
+		XMFLOAT4X4* results = m_results.data() + view * worldCount;
+
+		for (uint32_t i = 0; i < worldCount; i++) {
+			XMVECTOR a0 = XMLoadFloat4(&m_worlds[i].rows[0]);
+			XMVECTOR a1 = XMLoadFloat4(&m_worlds[i].rows[1]);
+			XMVECTOR a2 = XMLoadFloat4(&m_worlds[i].rows[2]);
+
+			XMMATRIX result;
+			result.r[0] = XMVectorMultiply(XMVectorSplatX(a0), viewProj.r[0]);
+			result.r[0] = XMVectorMultiplyAdd(XMVectorSplatX(a1), viewProj.r[1], result.r[0]);
+			result.r[0] = XMVectorMultiplyAdd(XMVectorSplatX(a2), viewProj.r[2], result.r[0]);
+			result.r[1] = XMVectorMultiply(XMVectorSplatY(a0), viewProj.r[0]);
+			result.r[1] = XMVectorMultiplyAdd(XMVectorSplatY(a1), viewProj.r[1], result.r[1]);
+			result.r[1] = XMVectorMultiplyAdd(XMVectorSplatY(a2), viewProj.r[2], result.r[1]);
+			result.r[2] = XMVectorMultiply(XMVectorSplatZ(a0), viewProj.r[0]);
+			result.r[2] = XMVectorMultiplyAdd(XMVectorSplatZ(a1), viewProj.r[1], result.r[2]);
+			result.r[2] = XMVectorMultiplyAdd(XMVectorSplatZ(a2), viewProj.r[2], result.r[2]);
+			result.r[3] = XMVectorMultiplyAdd(XMVectorSplatW(a0), viewProj.r[0], viewProj.r[3]);
+			result.r[3] = XMVectorMultiplyAdd(XMVectorSplatW(a1), viewProj.r[1], result.r[3]);
+			result.r[3] = XMVectorMultiplyAdd(XMVectorSplatW(a2), viewProj.r[2], result.r[3]);
+			XMStoreFloat4x4(&results[i], result);
+		}
+	}
+}
+
+const XMFLOAT4X4& WorldViewProjBatch::Get(uint32_t view, uint32_t world) const { return m_results[view * m_worlds.size() + world]; }
+uint32_t WorldViewProjBatch::GetViewCount() const { return (uint32_t)m_viewProjs.size(); }
+uint32_t WorldViewProjBatch::GetWorldCount() const { return (uint32_t)m_worlds.size(); }
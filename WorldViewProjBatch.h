@@ -0,0 +1,47 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "AffineMatrix.h"
+
+// --------------------------------------------------------
+// World * view * projection of every entity drawn this frame,
+// for every view it's drawn from (the camera, each shadow),
+// worked out together so the vertex shaders only get one
+// matrix instead of multiplying three for every vertex
+//
+// - Each view's view * projection is multiplied once, when
+//   it's added. Compute then goes through the world matrices
+//   once, multiplying each by every view.
+// - The world matrices are affine (see AffineMatrix), so
+//   each product takes three rows of three multiply-adds and
+//   a copy of the last row, instead of four rows of four.
+// - Results are XMFLOAT4X4s the way SimpleShader uploads
+//   every other matrix, so shaders use them as a "matrix"
+//   with mul(worldViewProj, position).
+// --------------------------------------------------------
+class WorldViewProjBatch
+{
+public:
+	// Forget the views and world matrices of the last frame (keeping the memory).
+	void Clear();
+
+	// Returns the index to pass to Get.
+	uint32_t AddView(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+	uint32_t AddWorld(const AffineMatrix& world);
+
+	// Every world matrix times every view's view * projection.
+	void Compute();
+
+	// As of the last Compute.
+	const DirectX::XMFLOAT4X4& Get(uint32_t view, uint32_t world) const;
+
+	uint32_t GetViewCount() const;
+	uint32_t GetWorldCount() const;
+
+private:
+	std::vector<DirectX::XMFLOAT4X4> m_viewProjs;
+	std::vector<AffineMatrix> m_worlds;
+	std::vector<DirectX::XMFLOAT4X4> m_results;	// By view, then world
+};